@@ -3,679 +3,7043 @@
 #include <filesystem>
 #include <stack>
 #include <functional>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <shared_mutex>
+#include <memory>
+#include <thread>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <bit>
+#include <string_view>
+#include <cstdlib>
+#include <climits>
+#include <new>
+#include <memory_resource>
+#include <sstream>
+#include <random>
+#include <cmath>
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <intrin.h>
+#define NOMINMAX //інакше макроси min та max з windows.h ламають std::min та std::max
+#include <winsock2.h>
+#include <afunix.h>
 #include <windows.h>
+#include <psapi.h>
 
-class Command;
+#pragma comment(lib, "Ws2_32.lib")
+#pragma comment(lib, "Psapi.lib")
 
-class Session {
+class Profiler {
 private:
-	std::stack<Command*> commandsHistory; //історія команд
-	std::stack<std::string> clipboard; //буфер обміну
-	int currentCommandIndexInHistory; //індекс на команді, на якій знаходиться користувач, бо, можливо, він скасував декілька команд або повторив,
-	//і це потрібно відслідковвувати
-	std::string name; //ім'я сеансу
+	static const int COUNT_OF_SUB_BUCKETS = 128, //кількість комірок гістограми на кожний степінь двійки (точність ~1.6%)
+		COUNT_OF_HISTOGRAM_BUCKETS = COUNT_OF_SUB_BUCKETS + 40 * COUNT_OF_SUB_BUCKETS / 2;
+	static const size_t MAX_COUNT_OF_TRACE_EVENTS = 1000000; //обмеження на кількість подій для Chrome trace
+
+	struct OperationStatistics {
+		long long count = 0, totalNs = 0, minNs = LLONG_MAX, maxNs = 0; //кількість викликів та час їх виконання
+		long long countOfAllocations = 0, allocatedBytes = 0; //виділення пам'яті під час виконання операції
+		std::vector<long long> histogram = std::vector<long long>(COUNT_OF_HISTOGRAM_BUCKETS); //HDR-гістограма затримок
+	};
+	struct TraceEvent {
+		const char* name; //ім'я операції
+		double startUs, durationUs; //початок відносно запуску програми та тривалість у мікросекундах
+		size_t threadId; //ідентифікатор потоку
+	};
+
+	static std::atomic<bool> isEnabled; //чи збирається статистика
+	static std::mutex statisticsMutex; //захищає статистику та події
+	static std::map<std::string, OperationStatistics, std::less<>> statistics; //статистика за іменами операцій
+	static std::vector<TraceEvent> traceEvents; //події для експорту в Chrome trace
+	static const std::chrono::steady_clock::time_point startTime; //час запуску, від якого рахуються події
+	static thread_local long long countOfAllocationsInThread, allocatedBytesInThread; //лічильники виділень пам'яті поточного потоку
+	static thread_local bool isRecordingInThread; //чи поточний потік саме записує подію (її власні виділення пам'яті не рахуються)
+
+	static int getBucketIndex(long long valueNs) {
+		unsigned long long value = valueNs > 0 ? valueNs : 0;
+		if (value < COUNT_OF_SUB_BUCKETS)
+			return (int)value;
+
+		int shift = std::bit_width(value) - std::bit_width((unsigned long long)COUNT_OF_SUB_BUCKETS - 1);
+		int index = COUNT_OF_SUB_BUCKETS + (shift - 1) * COUNT_OF_SUB_BUCKETS / 2 + (int)(value >> shift) - COUNT_OF_SUB_BUCKETS / 2;
+		return std::min(index, COUNT_OF_HISTOGRAM_BUCKETS - 1);
+	}
+	static long long getValueOfBucket(int index) {
+		if (index < COUNT_OF_SUB_BUCKETS)
+			return index;
 
-public:
-	Session() { currentCommandIndexInHistory = -1; }
-	Session(std::string filename) : Session() { name = filename; }
-	~Session() {
-		while (!commandsHistory.empty()) {
-			if (commandsHistory.top())
-				delete commandsHistory.top();
-			commandsHistory.pop();
+		int shift = (index - COUNT_OF_SUB_BUCKETS) / (COUNT_OF_SUB_BUCKETS / 2) + 1;
+		long long subBucket = (index - COUNT_OF_SUB_BUCKETS) % (COUNT_OF_SUB_BUCKETS / 2) + COUNT_OF_SUB_BUCKETS / 2;
+		return subBucket << shift;
+	}
+	static long long getPercentile(const OperationStatistics& operationStatistics, double percentile) {
+		long long countBelow = 0, requiredCount = (long long)(operationStatistics.count * percentile / 100.0 + 0.5);
+		requiredCount = std::max(requiredCount, 1LL);
+
+		for (int i = 0; i < COUNT_OF_HISTOGRAM_BUCKETS; i++) {
+			countBelow += operationStatistics.histogram[i];
+			if (countBelow >= requiredCount)
+				return std::min(getValueOfBucket(i), operationStatistics.maxNs);
 		}
+		return operationStatistics.maxNs;
 	}
 
-	void addCommandAsLast(Command* command) { commandsHistory.push(command); }
-	void addDataToClipboard(std::string data) { clipboard.push(data); }
-	void deleteLastCommand() {
-		delete commandsHistory.top();
-		commandsHistory.pop();
-	}
+public:
+	static void setEnabled(bool isEnabled) { Profiler::isEnabled = isEnabled; }
+	static bool isProfilingEnabled() { return isEnabled.load(std::memory_order_relaxed); }
 
-	int sizeOfCommandsHistory() { return commandsHistory.size(); }
-	int sizeOfClipboard() { return clipboard.size(); }
+	static void noteAllocation(size_t size) {
+		if (!isEnabled.load(std::memory_order_relaxed) || isRecordingInThread)
+			return;
+		countOfAllocationsInThread++;
+		allocatedBytesInThread += size;
+	}
+	static long long getCountOfAllocationsInThread() { return countOfAllocationsInThread; }
+	static long long getAllocatedBytesInThread() { return allocatedBytesInThread; }
 
-	bool setName(std::string filename) {
-		std::string forbiddenCharacters = "/\\\":?*|<>";
+	static void record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end,
+		long long countOfAllocations, long long allocatedBytes) {
+		long long durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+		isRecordingInThread = true; //виділення пам'яті самим профайлером не рахуються, а інші потоки рахують свої далі
+		{
+			std::lock_guard<std::mutex> lock(statisticsMutex);
+
+			auto statisticsIter = statistics.find(std::string_view(name));
+			if (statisticsIter == statistics.end())
+				statisticsIter = statistics.emplace(name, OperationStatistics()).first;
+
+			OperationStatistics& operationStatistics = statisticsIter->second;
+			operationStatistics.count++;
+			operationStatistics.totalNs += durationNs;
+			operationStatistics.minNs = std::min(operationStatistics.minNs, durationNs);
+			operationStatistics.maxNs = std::max(operationStatistics.maxNs, durationNs);
+			operationStatistics.countOfAllocations += countOfAllocations;
+			operationStatistics.allocatedBytes += allocatedBytes;
+			operationStatistics.histogram[getBucketIndex(durationNs)]++;
+
+			if (traceEvents.size() < MAX_COUNT_OF_TRACE_EVENTS)
+				traceEvents.push_back({ name,
+					std::chrono::duration_cast<std::chrono::nanoseconds>(start - startTime).count() / 1000.0,
+					durationNs / 1000.0,
+					std::hash<std::thread::id>()(std::this_thread::get_id()) });
+		}
+		isRecordingInThread = false;
+	}
 
-		for (char ch : forbiddenCharacters)
-			if (filename.find(ch) != std::string::npos)
-				return false;
+	static void reset() {
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+		statistics.clear();
+		traceEvents.clear();
+	}
 
-		name = filename + ".txt";
-		return true;
+	static long long getPercentileOf(std::string name, double percentile) {
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+		auto statisticsIter = statistics.find(name);
+		return statisticsIter != statistics.end() ? getPercentile(statisticsIter->second, percentile) : 0;
 	}
-	void setCurIndexInCommHistory(int currentCommandIndexInHistory) {
-		this->currentCommandIndexInHistory = currentCommandIndexInHistory;
+	static long long getCountOf(std::string name) {
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+		auto statisticsIter = statistics.find(name);
+		return statisticsIter != statistics.end() ? statisticsIter->second.count : 0;
 	}
 
-	std::string getName() { return name; }
-	Command* getCommandByIndex(int index) { return commandsHistory._Get_container()[index]; }
-	int getCurIndexInCommHistory() { return currentCommandIndexInHistory; }
-	std::string getDataFromClipboardByIndex(int index) { return clipboard._Get_container()[index]; }
-
-	void printClipboard() {
+	static void printSummary() {
+		std::lock_guard<std::mutex> lock(statisticsMutex);
 		system("cls");
-		for (int i = 0; i < clipboard.size(); i++)
-			std::cout << "\n" << i + 1 << ") \"" << clipboard._Get_container()[i] << "\"";
+		std::cout << "\nСтатистика операцій (час у мікросекундах):\n";
+		for (auto& [name, operationStatistics] : statistics)
+			std::cout << "\n" << name << ": викликів " << operationStatistics.count
+			<< ", середнє " << operationStatistics.totalNs / operationStatistics.count / 1000.0
+			<< ", p50 " << getPercentile(operationStatistics, 50) / 1000.0
+			<< ", p99 " << getPercentile(operationStatistics, 99) / 1000.0
+			<< ", макс. " << operationStatistics.maxNs / 1000.0
+			<< ", виділень пам'яті " << operationStatistics.countOfAllocations
+			<< " (" << operationStatistics.allocatedBytes << " байт)";
+		if (statistics.empty())
+			std::cout << "\nСтатистика ще не зібрана!";
 		std::cout << std::endl;
 	}
-};
 
-class SessionsHistory {
-private:
-	std::stack<Session*> sessions; //історія сеансів
+	static bool exportToJson(std::string filepath) {
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+		std::ofstream file(filepath);
 
-public:
-	~SessionsHistory() {
-		while (!sessions.empty()) {
-			delete sessions.top();
-			sessions.pop();
-		}
-	}
+		if (!file.is_open())
+			return false;
 
-	void addSessionToEnd(Session* session) { sessions.push(session); }
-	Session* getSessionByIndex(int index) { return sessions._Get_container()[index]; }
-	Session* getSessionByName(std::string name) {
-		auto sessionsIter = std::find_if(sessions._Get_container().begin(), sessions._Get_container().end(), [name](Session* session) {
-			return session->getName() == name + ".txt" || session->getName() == name;
-			});
+		file << "{\"operations\":[";
+		bool isFirst = true;
+		for (auto& [name, operationStatistics] : statistics) {
+			file << (isFirst ? "" : ",") << "\n{\"name\":\"" << name << "\""
+				<< ",\"count\":" << operationStatistics.count
+				<< ",\"totalNs\":" << operationStatistics.totalNs
+				<< ",\"minNs\":" << operationStatistics.minNs
+				<< ",\"maxNs\":" << operationStatistics.maxNs
+				<< ",\"meanNs\":" << operationStatistics.totalNs / operationStatistics.count
+				<< ",\"p50Ns\":" << getPercentile(operationStatistics, 50)
+				<< ",\"p90Ns\":" << getPercentile(operationStatistics, 90)
+				<< ",\"p99Ns\":" << getPercentile(operationStatistics, 99)
+				<< ",\"p999Ns\":" << getPercentile(operationStatistics, 99.9)
+				<< ",\"allocations\":" << operationStatistics.countOfAllocations
+				<< ",\"allocatedBytes\":" << operationStatistics.allocatedBytes << "}";
+			isFirst = false;
+		}
+		file << "\n]}\n";
 
-		if (sessionsIter != sessions._Get_container().end())
-			return *sessionsIter;
-		else
-			return nullptr;
+		file.close();
+		return true;
 	}
-	std::string deleteSessionByIndex(int index) {
-		auto ptrOnUnderlyingContainer = &sessions._Get_container();
-		auto ptrOnRetiringSession = (*ptrOnUnderlyingContainer)[index];
+	static bool exportToChromeTrace(std::string filepath) {
+		//формат Trace Event, який відкривається в chrome://tracing та Perfetto
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+		std::ofstream file(filepath);
 
-		std::string filename = ptrOnRetiringSession->getName();
+		if (!file.is_open())
+			return false;
 
-		std::deque<Session*> notRetiringElements;
+		file << "{\"traceEvents\":[";
+		for (size_t i = 0; i < traceEvents.size(); i++)
+			file << (i ? "," : "") << "\n{\"name\":\"" << traceEvents[i].name << "\",\"cat\":\"editor\",\"ph\":\"X\""
+			<< ",\"ts\":" << traceEvents[i].startUs << ",\"dur\":" << traceEvents[i].durationUs
+			<< ",\"pid\":1,\"tid\":" << traceEvents[i].threadId % 100000 << "}";
+		file << "\n],\"displayTimeUnit\":\"ns\"}\n";
 
-		remove_copy(ptrOnUnderlyingContainer->begin(),
-			ptrOnUnderlyingContainer->end(),
-			back_inserter(notRetiringElements),
-			ptrOnRetiringSession);
+		file.close();
+		return true;
+	}
+};
 
-		sessions = std::stack<Session*>(notRetiringElements);
+std::atomic<bool> Profiler::isEnabled = false;
+std::mutex Profiler::statisticsMutex;
+std::map<std::string, Profiler::OperationStatistics, std::less<>> Profiler::statistics;
+std::vector<Profiler::TraceEvent> Profiler::traceEvents;
+const std::chrono::steady_clock::time_point Profiler::startTime = std::chrono::steady_clock::now();
+thread_local long long Profiler::countOfAllocationsInThread = 0, Profiler::allocatedBytesInThread = 0;
+thread_local bool Profiler::isRecordingInThread = false;
 
-		delete ptrOnRetiringSession;
+class ProfilerScope {
+private:
+	const char* name; //ім'я операції, яку вимірюємо
+	bool isActive; //чи був профайлер увімкнений на початку вимірювання
+	std::chrono::steady_clock::time_point start; //час початку операції
+	long long countOfAllocationsAtStart, allocatedBytesAtStart; //лічильники виділень пам'яті на початку операції
 
-		return filename;
+public:
+	ProfilerScope(const char* name) : name(name), isActive(Profiler::isProfilingEnabled()) {
+		if (!isActive)
+			return;
+		countOfAllocationsAtStart = Profiler::getCountOfAllocationsInThread();
+		allocatedBytesAtStart = Profiler::getAllocatedBytesInThread();
+		start = std::chrono::steady_clock::now();
 	}
-	std::string deleteSessionByName(std::string name) {
-		auto sessionToDelete = getSessionByName(name);
-		if (!sessionToDelete)
-			return "";
-
-		Session* topSession;
-		std::string filename = sessionToDelete->getName();
-		std::stack<Session*> tempStack;
+	~ProfilerScope() {
+		if (!isActive)
+			return;
+		auto end = std::chrono::steady_clock::now();
+		Profiler::record(name, start, end,
+			Profiler::getCountOfAllocationsInThread() - countOfAllocationsAtStart,
+			Profiler::getAllocatedBytesInThread() - allocatedBytesAtStart);
+	}
+};
 
+void* operator new(size_t size) {
+	Profiler::noteAllocation(size);
+	if (void* memory = std::malloc(size ? size : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
 
-		while (!sessions.empty()) {
-			topSession = sessions.top();
-			sessions.pop();
+class SessionArena : public std::pmr::memory_resource {
+private:
+	static constexpr size_t SIZE_OF_BLOCK = 64 * 1024, //розмір звичайного блоку арени
+		MAX_COUNT_OF_FREE_BLOCKS = 4; //скільки звільнених блоків тримати для повторного використання
+
+	struct Block {
+		char* memory; //пам'ять блоку
+		size_t size; //розмір блоку
+	};
+
+	std::vector<Block> blocks; //блоки арени; блоки після поточного вільні та чекають повторного використання
+	size_t indexOfCurrentBlock, offsetInCurrentBlock; //блок, з якого зараз виділяється пам'ять, і зміщення в ньому
+	size_t countOfAllocations, usedBytes, peakUsedBytes, reservedBytes; //статистика для налаштування розміру блоків
+
+	void moveToNextBlock(size_t minSize) {
+		size_t indexOfNextBlock = blocks.empty() ? 0 : indexOfCurrentBlock + 1, indexOfFreeBlock = indexOfNextBlock;
+		while (indexOfFreeBlock < blocks.size() && blocks[indexOfFreeBlock].size < minSize)
+			indexOfFreeBlock++;
+
+		if (indexOfFreeBlock == blocks.size()) {
+			size_t sizeOfBlock = std::max(SIZE_OF_BLOCK, minSize);
+			char* memory = static_cast<char*>(std::malloc(sizeOfBlock));
+			if (!memory)
+				throw std::bad_alloc();
+			blocks.push_back({ memory, sizeOfBlock });
+			reservedBytes += sizeOfBlock;
+		}
 
-			if (topSession->getName() == name || topSession->getName() == name + ".txt") {
-				delete topSession;
-				continue;
+		std::swap(blocks[indexOfNextBlock], blocks[indexOfFreeBlock]);
+		indexOfCurrentBlock = indexOfNextBlock;
+		offsetInCurrentBlock = 0;
+	}
+	void releaseFreeBlocks() {
+		//великі та зайві вільні блоки повертаються системі, щоб обрізаний хвіст історії не тримав пам'ять
+		size_t countOfKeptBlocks = 0;
+		for (size_t i = indexOfCurrentBlock + 1; i < blocks.size();) {
+			if (blocks[i].size > SIZE_OF_BLOCK || countOfKeptBlocks == MAX_COUNT_OF_FREE_BLOCKS) {
+				reservedBytes -= blocks[i].size;
+				std::free(blocks[i].memory);
+				blocks.erase(blocks.begin() + i);
+			}
+			else {
+				countOfKeptBlocks++;
+				i++;
 			}
-
-			tempStack.push(topSession);
 		}
+	}
 
-		while (!tempStack.empty()) {
-			sessions.push(tempStack.top());
-			tempStack.pop();
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override {
+		size_t alignedOffset = (offsetInCurrentBlock + alignment - 1) & ~(alignment - 1);
+		if (blocks.empty() || alignedOffset + bytes > blocks[indexOfCurrentBlock].size) {
+			moveToNextBlock(bytes + alignment);
+			alignedOffset = 0;
 		}
 
-		return filename;
+		offsetInCurrentBlock = alignedOffset + bytes;
+		countOfAllocations++;
+		usedBytes += bytes;
+		peakUsedBytes = std::max(peakUsedBytes, usedBytes);
+
+		return blocks[indexOfCurrentBlock].memory + alignedOffset;
 	}
+	void do_deallocate(void* memory, size_t bytes, size_t alignment) override { } //пам'ять звільняється лише відкатом або release()
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
 
-	bool isEmpty() { return sessions.size() == 0; }
-	int size() { return sessions.size(); }
+public:
+	struct Mark {
+		size_t indexOfBlock, offsetInBlock; //позиція арени
+		size_t countOfAllocations, usedBytes; //статистика на момент позначки
+	};
+	struct Statistics {
+		size_t countOfAllocations, usedBytes, peakUsedBytes, reservedBytes, countOfBlocks;
+	};
+
+	SessionArena() {
+		indexOfCurrentBlock = 0;
+		offsetInCurrentBlock = 0;
+		countOfAllocations = 0;
+		usedBytes = 0;
+		peakUsedBytes = 0;
+		reservedBytes = 0;
+	}
+	SessionArena(const SessionArena&) = delete;
+	SessionArena& operator=(const SessionArena&) = delete;
+	~SessionArena() { release(); }
+
+	template <class T, class... Args>
+	T* create(Args&&... args) {
+		void* memory = allocate(sizeof(T), alignof(T));
+		return new (memory) T(std::forward<Args>(args)...);
+	}
 
-	void printSessionsHistory() {
-		system("cls");
-		for (int i = 0; i < sessions.size(); i++)
-			std::cout << "\nСеанс #" << i + 1 << ": " << sessions._Get_container()[i]->getName();
-		std::cout << std::endl;
+	Mark getMark() { return { indexOfCurrentBlock, offsetInCurrentBlock, countOfAllocations, usedBytes }; }
+	void rewindTo(Mark mark) {
+		//усе, що виділено після позначки, звільняється одразу, без обходу окремих об'єктів
+		indexOfCurrentBlock = mark.indexOfBlock;
+		offsetInCurrentBlock = mark.offsetInBlock;
+		countOfAllocations = mark.countOfAllocations;
+		usedBytes = mark.usedBytes;
+		releaseFreeBlocks();
+	}
+	void release() {
+		for (Block& block : blocks)
+			std::free(block.memory);
+		blocks.clear();
+		indexOfCurrentBlock = 0;
+		offsetInCurrentBlock = 0;
+		countOfAllocations = 0;
+		usedBytes = 0;
+		reservedBytes = 0;
 	}
 
-	void sortByName() {
-		std::deque<Session*> tempSessions;
+	Statistics getStatistics() { return { countOfAllocations, usedBytes, peakUsedBytes, reservedBytes, blocks.size() }; }
+};
 
-		while (!sessions.empty()) {
-			tempSessions.push_back(sessions.top());
-			sessions.pop();
-		}
+class Utf8Index {
+public:
+	struct Splice {
+		size_t position; //з якого байта змінено текст
+		size_t removedLength, insertedLength; //скільки байтів прибрано та вставлено
+		bool isWholeText; //текст замінено повністю (скасування, повторення, пакет)
+	};
 
-		std::sort(tempSessions.begin(), tempSessions.end(), [](Session* a, Session* b) {
-			return a->getName() < b->getName();
+private:
+	static constexpr size_t INTERVAL_OF_CHECKPOINTS = 1024; //через скільки символів запам'ятовується їхнє зміщення в байтах
+
+	std::vector<std::pair<size_t, size_t>> checkpoints; //(номер символу, зміщення в байтах), перша завжди (0, 0)
+	size_t countOfCodePoints; //скільки символів у тексті
+	size_t sizeOfText; //скільки байтів у тексті
+
+	static bool isContinuationByte(unsigned char byte) { return (byte & 0xC0) == 0x80; }
+	size_t findCheckpoint(size_t value, bool isByteOffset) {
+		//номер останньої контрольної точки, яка не далі за value
+		auto checkpointsIter = std::upper_bound(checkpoints.begin(), checkpoints.end(), value,
+			[isByteOffset](size_t value, const std::pair<size_t, size_t>& checkpoint) {
+				return value < (isByteOffset ? checkpoint.second : checkpoint.first);
 			});
+		return checkpointsIter - checkpoints.begin() - 1;
+	}
+	void addCheckpoints(std::string_view text, size_t indexOfCheckpoint, size_t endOfRange) {
+		//розставляє контрольні точки після indexOfCheckpoint до байта endOfRange, не переходячи наступну існуючу
+		std::vector<std::pair<size_t, size_t>> newCheckpoints;
+		auto [codePoint, byteOffset] = checkpoints[indexOfCheckpoint];
+		size_t countSinceCheckpoint = 0;
+
+		for (; byteOffset < endOfRange; byteOffset++) {
+			if (isContinuationByte(text[byteOffset]))
+				continue;
+			if (countSinceCheckpoint == INTERVAL_OF_CHECKPOINTS) {
+				newCheckpoints.push_back({ codePoint, byteOffset });
+				countSinceCheckpoint = 0;
+			}
+			codePoint++;
+			countSinceCheckpoint++;
+		}
+		checkpoints.insert(checkpoints.begin() + indexOfCheckpoint + 1, newCheckpoints.begin(), newCheckpoints.end());
+	}
 
-		for (Session* session : tempSessions)
-			sessions.push(session);
+public:
+	Utf8Index() {
+		checkpoints.push_back({ 0, 0 });
+		countOfCodePoints = sizeOfText = 0;
 	}
-};
 
-class Editor {
-private:
-	static SessionsHistory* sessionsHistory; //історія сеансів
-	static Session* currentSession; //сеанс, з яким користувач працює в даний момент
-	static std::string* currentText; //текст, який користувач редагує в даний момент
+	static size_t countCodePoints(const char* data, size_t size) {
+		//символ - кожен байт, що не є продовженням (0x80-0xBF); по 16 байтів за раз через SSE2
+		size_t count = 0, i = 0;
+		const __m128i maxContinuationByte = _mm_set1_epi8((char)0xBF);
+		for (; i + 16 <= size; i += 16) {
+			__m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+			count += std::popcount((unsigned int)_mm_movemask_epi8(_mm_cmpgt_epi8(bytes, maxContinuationByte)));
+		}
+		for (; i < size; i++)
+			count += !isContinuationByte(data[i]);
+		return count;
+	}
+	static bool isValid(std::string_view text) {
+		//ASCII-блоки по 16 байтів пропускаються однією перевіркою, решта розбирається за правилами UTF-8
+		//(без надлишкових кодувань, сурогатів та символів за U+10FFFF)
+		size_t i = 0;
+		while (i < text.size()) {
+			if (i + 16 <= text.size() && !_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(text.data() + i)))) {
+				i += 16;
+				continue;
+			}
 
-public:
-	Editor();
+			unsigned char byte = text[i];
+			size_t length = byte < 0x80 ? 1 : byte >= 0xC2 && byte <= 0xDF ? 2 : byte >= 0xE0 && byte <= 0xEF ? 3 :
+				byte >= 0xF0 && byte <= 0xF4 ? 4 : 0;
+			if (length == 0 || i + length > text.size())
+				return false;
 
-	~Editor() {
-		delete sessionsHistory;
-		if(currentText)
-			delete (currentText);
+			unsigned char second = length > 1 ? text[i + 1] : 0x80;
+			if ((byte == 0xE0 && second < 0xA0) || (byte == 0xED && second > 0x9F) ||
+				(byte == 0xF0 && second < 0x90) || (byte == 0xF4 && second > 0x8F))
+				return false;
+			for (size_t j = 1; j < length; j++)
+				if (!isContinuationByte(text[i + j]))
+					return false;
+			i += length;
+		}
+		return true;
+	}
+	static size_t getLengthOfCharacterAt(std::string_view text, size_t position) {
+		//для байта-продовження повертає 1, тому позиції, отримані пошуком байтів, теж лишаються правильними
+		if (position >= text.size() || isContinuationByte(text[position]))
+			return 1;
+		size_t length = 1;
+		while (position + length < text.size() && isContinuationByte(text[position + length]))
+			length++;
+		return length;
+	}
+	static size_t getStartOfLastCharacter(std::string_view text) {
+		size_t position = text.empty() ? 0 : text.size() - 1;
+		while (position > 0 && isContinuationByte(text[position]))
+			position--;
+		return position;
 	}
 
-	void tryToLoadSessions();
-	void tryToUnloadSessions();
+	void rebuild(std::string_view text) {
+		checkpoints.assign(1, { 0, 0 });
+		sizeOfText = text.size();
+		countOfCodePoints = countCodePoints(text.data(), text.size());
+		addCheckpoints(text, 0, text.size());
+	}
+	void applySplice(std::string_view newText, const Splice& splice) {
+		//контрольні точки до зміни лишаються, після неї зсуваються, а перераховуються лише байти самої зміни
+		if (splice.isWholeText || splice.position > sizeOfText || splice.position + splice.removedLength > sizeOfText) {
+			rebuild(newText);
+			return;
+		}
 
-	void copy(std::string textToProcess, int startPosition, int endPosition);
-	void paste(std::string* textToProcess, int startPosition, int endPosition, std::string textToPaste);
-	void cut(std::string* textToProcess, int startPosition, int endPosition);
-	void remove(std::string* textToProcess, int startPosition, int endPosition);
+		size_t endOfRemoved = splice.position + splice.removedLength;
+		long long shiftInBytes = (long long)splice.insertedLength - (long long)splice.removedLength;
+
+		size_t indexBefore = findCheckpoint(splice.position, true);
+		size_t codePointOfSplice = checkpoints[indexBefore].first +
+			countCodePoints(newText.data() + checkpoints[indexBefore].second, splice.position - checkpoints[indexBefore].second);
+
+		//перша стара контрольна точка не раніше кінця прибраного фрагмента (або кінець старого тексту)
+		size_t indexAfter = indexBefore + 1;
+		while (indexAfter < checkpoints.size() && checkpoints[indexAfter].second < endOfRemoved)
+			indexAfter++;
+		std::pair<size_t, size_t> checkpointAfter = indexAfter < checkpoints.size() ? checkpoints[indexAfter] : std::pair(countOfCodePoints, sizeOfText);
+
+		size_t endOfInserted = splice.position + splice.insertedLength;
+		size_t removedCodePoints = checkpointAfter.first - codePointOfSplice -
+			countCodePoints(newText.data() + endOfInserted, checkpointAfter.second + shiftInBytes - endOfInserted);
+		size_t insertedCodePoints = countCodePoints(newText.data() + splice.position, splice.insertedLength);
+		long long shiftInCodePoints = (long long)insertedCodePoints - (long long)removedCodePoints;
+
+		checkpoints.erase(checkpoints.begin() + indexBefore + 1, checkpoints.begin() + indexAfter);
+		for (size_t i = indexBefore + 1; i < checkpoints.size(); i++) {
+			checkpoints[i].first += shiftInCodePoints;
+			checkpoints[i].second += shiftInBytes;
+		}
+		countOfCodePoints += shiftInCodePoints;
+		sizeOfText = newText.size();
 
-	static Session* getCurrentSession();
-	static SessionsHistory* getSessionsHistory();
-	static std::string* getCurrentText();
-	static void setCurrentSession(Session* session);
-	static void setCurrentText(std::string* text);
+		size_t endOfGap = indexBefore + 1 < checkpoints.size() ? checkpoints[indexBefore + 1].second : sizeOfText;
+		addCheckpoints(newText, indexBefore, endOfGap);
+	}
 
-	static void printCurrentText();
-};
+	size_t getByteOffset(std::string_view text, size_t codePoint) {
+		//номер символу -> зміщення його першого байта (кількість символів -> розмір тексту)
+		if (codePoint >= countOfCodePoints)
+			return sizeOfText;
 
-class Command {
-protected:
-	Editor* editor; //редактор, в якому відбувається редагування тексту за допомогою команд
-	int startPosition, endPosition; //початкова та кінцева позиції для вставки, заміни, видалення, копіювання, вирізання
-	std::string textToProcess, textToPaste; //поля для тексту, який обробляємо і для тексту, який вставляємо 
-	Command* previousCommand, * commandToUndoOrRedo; //вказівник на попередню команду (в історії команд щось по типу однонапрямленого списка),
-	//далі - вказівник на команду, яку збираємось скасувати або повторити
+		auto [codePointOfCheckpoint, byteOffset] = checkpoints[findCheckpoint(codePoint, false)];
+		for (; byteOffset < text.size(); byteOffset++)
+			if (!isContinuationByte(text[byteOffset]) && codePointOfCheckpoint++ == codePoint)
+				break;
+		return byteOffset;
+	}
+	size_t getCodePointOffset(std::string_view text, size_t byteOffset) {
+		byteOffset = std::min(byteOffset, text.size());
+		auto [codePoint, byteOffsetOfCheckpoint] = checkpoints[findCheckpoint(byteOffset, true)];
+		return codePoint + countCodePoints(text.data() + byteOffsetOfCheckpoint, byteOffset - byteOffsetOfCheckpoint);
+	}
+	size_t getCountOfCodePoints() { return countOfCodePoints; }
+};
 
+class TextTransforms {
 public:
-	virtual void execute() = 0;
-	virtual void undo() = 0;
-	virtual Command* copy() = 0;
+	enum Transform { TO_UPPER_CASE, TO_LOWER_CASE, TRIM_TRAILING_WHITESPACE, CRLF_TO_LF, LF_TO_CRLF, EXPAND_TABS, COLLAPSE_TABS };
+	enum InstructionSet { SCALAR, SSE2, AVX2 };
+	static constexpr int COUNT_OF_TRANSFORMS = 7; //скільки є перетворень
+	static const char* const NAMES[COUNT_OF_TRANSFORMS]; //імена перетворень (вони ж імена команд)
+	static const size_t TAB_WIDTH; //через скільки символів стоїть наступна позиція табуляції
 
-	void setParameters(std::string typeOfCommand, Command* previousCommand, Command* commandToUndoOrRedo, int startPosition, int endPosition, std::string textToPaste) {
-		if (typeOfCommand == "Undo" || typeOfCommand == "Redo")
-		{
-			this->commandToUndoOrRedo = commandToUndoOrRedo;
-			return;
+private:
+	struct UndoWriter {
+		//дані для скасування перетворень, які змінюють довжину тексту, - послідовність правок:
+		//відстань від кінця попередньої правки, довжина нового фрагмента, довжина та байти старого (числа - LEB128)
+		std::string* undoData; //куди записуються правки (nullptr - не записуються)
+		size_t endOfLastEdit; //де в новому тексті закінчилась попередня правка
+
+		void writeNumber(size_t number) {
+			do {
+				undoData->push_back((char)(number & 0x7F | (number > 0x7F ? 0x80 : 0)));
+				number >>= 7;
+			} while (number);
+		}
+		void addEdit(size_t positionInResult, size_t lengthInResult, std::string_view removed) {
+			if (!undoData)
+				return;
+			writeNumber(positionInResult - endOfLastEdit);
+			writeNumber(lengthInResult);
+			writeNumber(removed.size());
+			undoData->append(removed);
+			endOfLastEdit = positionInResult + lengthInResult;
 		}
+	};
+
+	static size_t readNumber(std::string_view data, size_t& position) {
+		size_t number = 0;
+		for (int shift = 0; position < data.size(); shift += 7) {
+			unsigned char byte = data[position++];
+			number |= (size_t)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				break;
+		}
+		return number;
+	}
 
-		if (startPosition > endPosition && endPosition > -1 && startPosition < Editor::getCurrentText()->size())
-			std::swap(startPosition, endPosition);
+	static size_t findNextOf(std::string_view text, size_t from, char first, char second, InstructionSet instructionSet) {
+		//позиція першого з двох байтів, починаючи з from (або розмір тексту)
+		size_t i = from;
+		if (instructionSet == AVX2) {
+			const __m256i firstBytes = _mm256_set1_epi8(first), secondBytes = _mm256_set1_epi8(second);
+			for (; i + 32 <= text.size(); i += 32) {
+				__m256i bytes = _mm256_loadu_si256((const __m256i*)(text.data() + i));
+				unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, firstBytes), _mm256_cmpeq_epi8(bytes, secondBytes)));
+				if (mask)
+					return i + std::countr_zero(mask);
+			}
+		}
+		if (instructionSet != SCALAR) {
+			const __m128i firstBytes = _mm_set1_epi8(first), secondBytes = _mm_set1_epi8(second);
+			for (; i + 16 <= text.size(); i += 16) {
+				__m128i bytes = _mm_loadu_si128((const __m128i*)(text.data() + i));
+				unsigned int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, firstBytes), _mm_cmpeq_epi8(bytes, secondBytes)));
+				if (mask)
+					return i + std::countr_zero(mask);
+			}
+		}
+		for (; i < text.size(); i++)
+			if (text[i] == first || text[i] == second)
+				return i;
+		return text.size();
+	}
 
-		if (startPosition == -1 && endPosition == -1) {
-			startPosition = 0;
-			endPosition = 0;
+	static void changeCase(std::string& text, bool isToUpperCase, std::string* undoData, InstructionSet instructionSet) {
+		//змінюються лише латинські літери ASCII, тому текст UTF-8 лишається правильним;
+		//дані для скасування - біт на кожен байт тексту: чи була змінена літера (маска порівняння SIMD і є цими бітами)
+		char firstLetter = isToUpperCase ? 'a' : 'A';
+		std::string bitmap(undoData ? (text.size() + 7) / 8 : 0, '\0');
+		char* data = text.data();
+		size_t i = 0;
+
+		if (instructionSet == AVX2) {
+			const __m256i shift = _mm256_set1_epi8((char)(firstLetter + 128)), limit = _mm256_set1_epi8(-128 + 26), caseBit = _mm256_set1_epi8(0x20);
+			for (; i + 32 <= text.size(); i += 32) {
+				__m256i bytes = _mm256_loadu_si256((const __m256i*)(data + i));
+				__m256i isLetter = _mm256_cmpgt_epi8(limit, _mm256_sub_epi8(bytes, shift));
+				_mm256_storeu_si256((__m256i*)(data + i), _mm256_xor_si256(bytes, _mm256_and_si256(isLetter, caseBit)));
+				if (undoData) {
+					unsigned int mask = _mm256_movemask_epi8(isLetter);
+					memcpy(bitmap.data() + i / 8, &mask, 4);
+				}
+			}
+		}
+		if (instructionSet != SCALAR) {
+			const __m128i shift = _mm_set1_epi8((char)(firstLetter + 128)), limit = _mm_set1_epi8(-128 + 26), caseBit = _mm_set1_epi8(0x20);
+			for (; i + 16 <= text.size(); i += 16) {
+				__m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+				__m128i isLetter = _mm_cmplt_epi8(_mm_sub_epi8(bytes, shift), limit);
+				_mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(bytes, _mm_and_si128(isLetter, caseBit)));
+				if (undoData) {
+					unsigned short mask = _mm_movemask_epi8(isLetter);
+					memcpy(bitmap.data() + i / 8, &mask, 2);
+				}
+			}
 		}
+		for (; i < text.size(); i++)
+			if ((unsigned char)(data[i] - firstLetter) < 26) {
+				data[i] ^= 0x20;
+				if (undoData)
+					bitmap[i / 8] |= 1 << (i % 8);
+			}
 
-		this->startPosition = startPosition;
-		this->endPosition = endPosition;
-		this->textToProcess = *(Editor::getCurrentText());
-		this->previousCommand = previousCommand;
+		if (undoData)
+			*undoData = bitmap.find_first_not_of('\0') == std::string::npos ? "" : std::move(bitmap);
+	}
+	static void revertCase(std::string& text, std::string_view bitmap) {
+		//заміна регістру симетрична, тому скасування - повторна заміна позначених байтів
+		for (size_t i = 0; i < bitmap.size(); i += 8) {
+			unsigned long long bits = 0;
+			memcpy(&bits, bitmap.data() + i, std::min<size_t>(8, bitmap.size() - i));
+			for (; bits; bits &= bits - 1)
+				text[i * 8 + std::countr_zero(bits)] ^= 0x20;
+		}
+	}
 
-		if (typeOfCommand == "Paste")
-			this->textToPaste = textToPaste;
+	static void convertCrlfToLf(std::string& text, UndoWriter& undoWriter, InstructionSet instructionSet) {
+		//текст лише коротшає, тому фрагменти між правками зсуваються на місці
+		size_t read = 0, write = 0;
+		while (read < text.size()) {
+			size_t position = findNextOf(text, read, '\r', '\r', instructionSet);
+			bool isCrlf = position + 1 < text.size() && text[position + 1] == '\n';
+			size_t end = isCrlf ? position : std::min(position + 1, text.size());
+			memmove(text.data() + write, text.data() + read, end - read);
+			write += end - read;
+			if (isCrlf)
+				undoWriter.addEdit(write, 0, "\r");
+			read = isCrlf ? position + 1 : end;
+		}
+		text.resize(write);
 	}
+	static void convertLfToCrlf(std::string& text, UndoWriter& undoWriter, InstructionSet instructionSet) {
+		std::string result;
+		result.reserve(text.size() + text.size() / 32);
+		size_t read = 0;
+		while (read < text.size()) {
+			size_t position = findNextOf(text, read, '\n', '\n', instructionSet);
+			result.append(text, read, position - read);
+			if (position == text.size())
+				break;
+			if (position == 0 || text[position - 1] != '\r') {
+				undoWriter.addEdit(result.size(), 1, "");
+				result += '\r';
+			}
+			result += '\n';
+			read = position + 1;
+		}
+		text = std::move(result);
+	}
+	static void trimTrailingWhitespace(std::string& text, UndoWriter& undoWriter, InstructionSet instructionSet) {
+		//кінець рядка CRLF лишається, прибираються пробіли та табуляції перед ним
+		size_t read = 0, write = 0;
+		while (read < text.size()) {
+			size_t endOfLine = findNextOf(text, read, '\n', '\n', instructionSet);
+			bool hasCarriageReturn = endOfLine < text.size() && endOfLine > read && text[endOfLine - 1] == '\r';
+			size_t endOfWhitespace = endOfLine - hasCarriageReturn, endOfContent = endOfWhitespace;
+			while (endOfContent > read && (text[endOfContent - 1] == ' ' || text[endOfContent - 1] == '\t'))
+				endOfContent--;
+
+			if (endOfContent < endOfWhitespace)
+				undoWriter.addEdit(write + endOfContent - read, 0, std::string_view(text).substr(endOfContent, endOfWhitespace - endOfContent));
+			memmove(text.data() + write, text.data() + read, endOfContent - read);
+			write += endOfContent - read;
+			if (hasCarriageReturn)
+				text[write++] = '\r';
+			if (endOfLine < text.size())
+				text[write++] = '\n';
+			read = endOfLine + 1;
+		}
+		text.resize(write);
+	}
+	static void expandTabs(std::string& text, bool isUtf8, UndoWriter& undoWriter, InstructionSet instructionSet) {
+		//стовпчик рахується в символах, тому в UTF-8 байти-продовження його не збільшують
+		std::string result;
+		result.reserve(text.size());
+		size_t read = 0, column = 0;
+		while (read < text.size()) {
+			size_t position = findNextOf(text, read, '\t', '\n', instructionSet);
+			result.append(text, read, position - read);
+			column += isUtf8 ? Utf8Index::countCodePoints(text.data() + read, position - read) : position - read;
+			if (position == text.size())
+				break;
 
-	std::string getTextToProcess() { return textToProcess; }
-	void setTextToProcess(std::string textToProcess) { this->textToProcess = textToProcess; }
-	void setPreviousCommand(Command* previousCommand) { this->previousCommand = previousCommand; }
-};
+			if (text[position] == '\n') {
+				result += '\n';
+				column = 0;
+			}
+			else {
+				size_t width = TAB_WIDTH - column % TAB_WIDTH;
+				undoWriter.addEdit(result.size(), width, "\t");
+				result.append(width, ' ');
+				column += width;
+			}
+			read = position + 1;
+		}
+		text = std::move(result);
+	}
+	static void collapseTabs(std::string& text, UndoWriter& undoWriter, InstructionSet instructionSet) {
+		//у відступах на початку рядків кожні TAB_WIDTH пробілів, що закінчуються на позиції табуляції, стають табуляцією
+		size_t read = 0, write = 0;
+		while (read < text.size()) {
+			size_t column = 0;
+			while (read < text.size() && (text[read] == ' ' || text[read] == '\t')) {
+				bool isFullTab = text[read] == ' ' && column % TAB_WIDTH == 0 && read + TAB_WIDTH <= text.size() &&
+					std::string_view(text).substr(read, TAB_WIDTH).find_first_not_of(' ') == std::string_view::npos;
+				if (isFullTab) {
+					undoWriter.addEdit(write, 1, std::string_view(text).substr(read, TAB_WIDTH));
+					text[write++] = '\t';
+					read += TAB_WIDTH;
+					column += TAB_WIDTH;
+				}
+				else {
+					column = text[read] == '\t' ? column + TAB_WIDTH - column % TAB_WIDTH : column + 1;
+					text[write++] = text[read++];
+				}
+			}
+
+			size_t endOfLine = std::min(findNextOf(text, read, '\n', '\n', instructionSet) + 1, text.size());
+			memmove(text.data() + write, text.data() + read, endOfLine - read);
+			write += endOfLine - read;
+			read = endOfLine;
+		}
+		text.resize(write);
+	}
+	static void revertEdits(std::string& text, std::string_view undoData) {
+		std::string original;
+		size_t position = 0, positionInUndoData = 0;
+		while (positionInUndoData < undoData.size()) {
+			size_t start = position + readNumber(undoData, positionInUndoData);
+			size_t lengthInResult = readNumber(undoData, positionInUndoData);
+			size_t lengthOfRemoved = readNumber(undoData, positionInUndoData);
+			original.append(text, position, start - position);
+			original.append(undoData.substr(positionInUndoData, lengthOfRemoved));
+			positionInUndoData += lengthOfRemoved;
+			position = start + lengthInResult;
+		}
+		original.append(text, std::min(position, text.size()));
+		text = std::move(original);
+	}
 
-class CopyCommand : public Command {
 public:
-	CopyCommand(Editor* editor);
+	static InstructionSet getBestInstructionSet() {
+		//AVX2 потрібна підтримка і процесора (CPUID), і системи (збереження регістрів YMM, XGETBV)
+		static const InstructionSet bestInstructionSet = []() {
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return SSE2;
+			__cpuid(info, 1);
+			bool isAvxEnabledBySystem = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+			__cpuidex(info, 7, 0);
+			return isAvxEnabledBySystem && (info[1] & (1 << 5)) ? AVX2 : SSE2;
+		}();
+		return bestInstructionSet;
+	}
+	static int findTransform(std::string name) {
+		//імена порівнюються без урахування регістру, бо в записах запитів вони великими літерами
+		for (int i = 0; i < COUNT_OF_TRANSFORMS; i++)
+			if (std::equal(name.begin(), name.end(), NAMES[i], NAMES[i] + strlen(NAMES[i]),
+				[](char first, char second) { return toupper((unsigned char)first) == toupper((unsigned char)second); }))
+				return i;
+		return -1;
+	}
 
-	void execute() override;
-	void undo() override;
-	Command* copy() override;
+	static void apply(Transform transform, std::string& text, bool isUtf8, std::string* undoData,
+		InstructionSet instructionSet = getBestInstructionSet()) {
+		//undoData - куди записати дані для скасування (nullptr - не потрібні, наприклад при повторенні)
+		UndoWriter undoWriter = { undoData, 0 };
+		if (undoData)
+			undoData->clear();
+
+		switch (transform) {
+		case TO_UPPER_CASE:
+		case TO_LOWER_CASE:
+			changeCase(text, transform == TO_UPPER_CASE, undoData, instructionSet);
+			break;
+		case TRIM_TRAILING_WHITESPACE:
+			trimTrailingWhitespace(text, undoWriter, instructionSet);
+			break;
+		case CRLF_TO_LF:
+			convertCrlfToLf(text, undoWriter, instructionSet);
+			break;
+		case LF_TO_CRLF:
+			convertLfToCrlf(text, undoWriter, instructionSet);
+			break;
+		case EXPAND_TABS:
+			expandTabs(text, isUtf8, undoWriter, instructionSet);
+			break;
+		case COLLAPSE_TABS:
+			collapseTabs(text, undoWriter, instructionSet);
+		}
+	}
+	static void revert(Transform transform, std::string& text, std::string_view undoData) {
+		if (transform == TO_UPPER_CASE || transform == TO_LOWER_CASE)
+			revertCase(text, undoData);
+		else
+			revertEdits(text, undoData);
+	}
 };
 
-class DeleteCommand : public Command {
-public:
-	DeleteCommand(Editor* editor);
+const char* const TextTransforms::NAMES[TextTransforms::COUNT_OF_TRANSFORMS] = {
+	"ToUpperCase", "ToLowerCase", "TrimTrailingWhitespace", "CrlfToLf", "LfToCrlf", "ExpandTabs", "CollapseTabs" };
+const size_t TextTransforms::TAB_WIDTH = 4;
 
-	void execute() override;
-	void undo() override;
-	Command* copy() override;
-};
+class Command;
+class Editor;
 
-class CutCommand : public Command {
-public:
-	CutCommand(Editor* editor);
+class HistorySpillFile {
+	//знімки тексту найстаріших записів історії, витіснені з пам'яті; файл лише дописується, переписується заново,
+	//коли мертвих байтів (знімків злитих або видалених записів) у ньому стає більше, ніж живих,
+	//а очищується, коли в історії не лишається витіснених записів
+private:
+	static const std::string DIRECTORY; //директорія файлів витіснення
+	static const unsigned long long MIN_SIZE_TO_REWRITE; //менші файли не переписуються, навіть якщо більшість байтів у них мертві
 
-	void execute() override;
-	void undo() override;
-	Command* copy() override;
-};
+	std::string filepath; //файл витіснення сеансу ("" - ще не створений)
+	std::fstream file; //файл, відкритий для запису та читання
+	std::mutex fileMutex; //читання при скасуванні та дописування з фонового потоку йдуть по одному
+	unsigned long long sizeOfFile; //скільки байтів уже записано
 
-class PasteCommand : public Command {
 public:
-	PasteCommand(Editor* editor);
+	HistorySpillFile() { sizeOfFile = 0; }
+	HistorySpillFile(const HistorySpillFile&) = delete;
+	HistorySpillFile& operator=(const HistorySpillFile&) = delete;
+	~HistorySpillFile() { clear(); }
+
+	bool write(std::string nameOfSession, std::string_view text, unsigned long long& offset) {
+		std::lock_guard<std::mutex> lock(fileMutex);
+		if (!file.is_open()) {
+			std::error_code errorCode;
+			std::filesystem::create_directories(DIRECTORY, errorCode);
+			filepath = DIRECTORY + nameOfSession + ".spill";
+			file.open(filepath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+			sizeOfFile = 0;
+			if (!file.is_open())
+				return false;
+		}
+
+		file.seekp(sizeOfFile);
+		if (!file.write(text.data(), text.size()).flush())
+			return false;
+		offset = sizeOfFile;
+		sizeOfFile += text.size();
+		return true;
+	}
+	std::string read(unsigned long long offset, size_t size) {
+		//порожній рядок замість знімка зіпсував би текст при скасуванні чи історію при збереженні,
+		//тому помилка читання передається тому, хто скасовує чи зберігає, і він відмовляється від дії
+		std::lock_guard<std::mutex> lock(fileMutex);
+		std::string text(size, '\0');
+		file.seekg(offset);
+		if (size > 0 && !file.read(text.data(), size)) {
+			file.clear();
+			throw std::ios_base::failure("не вдалося прочитати витіснений знімок історії з " + filepath);
+		}
+		return text;
+	}
+	void clear() {
+		std::lock_guard<std::mutex> lock(fileMutex);
+		if (!file.is_open())
+			return;
+		file.close();
+		std::filesystem::remove(filepath);
+		sizeOfFile = 0;
+	}
+	bool isWorthRewriting(unsigned long long sizeOfLiveTexts) {
+		return sizeOfFile >= MIN_SIZE_TO_REWRITE && sizeOfFile - std::min(sizeOfFile, sizeOfLiveTexts) > sizeOfLiveTexts;
+	}
+	bool rewrite(std::vector<std::pair<unsigned long long, size_t>>& liveTexts) {
+		//живі знімки (зміщення та розмір) по черзі копіюються в новий файл, який потім замінює старий;
+		//при помилці старий файл і зміщення лишаються як були, а при успіху зміщення замінюються новими
+		std::lock_guard<std::mutex> lock(fileMutex);
+		if (!file.is_open())
+			return false;
+
+		std::string newFilepath = filepath + ".new";
+		std::ofstream newFile(newFilepath, std::ios::binary | std::ios::trunc);
+		std::vector<unsigned long long> newOffsets;
+		unsigned long long sizeOfNewFile = 0;
+		std::string text;
+		for (int i = 0; i < liveTexts.size(); i++) {
+			text.resize(liveTexts[i].second);
+			file.seekg(liveTexts[i].first);
+			if (!newFile || (text.size() > 0 && !file.read(text.data(), text.size())) || !newFile.write(text.data(), text.size())) {
+				file.clear();
+				newFile.close();
+				std::filesystem::remove(newFilepath);
+				return false;
+			}
+			newOffsets.push_back(sizeOfNewFile);
+			sizeOfNewFile += text.size();
+		}
+		if (!newFile.flush()) {
+			newFile.close();
+			std::filesystem::remove(newFilepath);
+			return false;
+		}
+		newFile.close();
+
+		file.close();
+		std::error_code errorCode;
+		std::filesystem::rename(newFilepath, filepath, errorCode);
+		file.open(filepath, std::ios::in | std::ios::out | std::ios::binary);
+		if (errorCode) {
+			std::filesystem::remove(newFilepath);
+			return false;
+		}
+
+		sizeOfFile = sizeOfNewFile;
+		for (int i = 0; i < liveTexts.size(); i++)
+			liveTexts[i].first = newOffsets[i];
+		return true;
+	}
+	unsigned long long getSizeOfFile() { return sizeOfFile; }
+};
+
+const std::string HistorySpillFile::DIRECTORY = "Spill\\";
+const unsigned long long HistorySpillFile::MIN_SIZE_TO_REWRITE = 4 * 1024 * 1024;
+
+class Session {
+public:
+	struct RetentionPolicy {
+		int maxCountOfCommands; //скільки записів залишати в історії (0 - без обмеження)
+		unsigned long long maxSizeInBytes; //скільки байтів арени може займати історія (0 - без обмеження)
+		long long maxAgeInSeconds; //записи, старші за цей вік, зливаються в базовий знімок (0 - без обмеження)
+
+		bool isUnlimited() const { return maxCountOfCommands == 0 && maxSizeInBytes == 0 && maxAgeInSeconds == 0; }
+	};
+	struct HistoryStatistics {
+		int countOfCommands; //скільки записів в історії
+		SessionArena::Statistics arena; //пам'ять, яку займають записи
+		unsigned long long sizeOfSpilledHistory; //скільки байтів знімків витіснено на диск
+	};
+
+private:
+	static RetentionPolicy defaultRetentionPolicy; //політика для сеансів, яким не задана власна
+	static const int COUNT_OF_RESIDENT_COMMANDS; //скільки записів перед поточним не витісняються, щоб скасування не читало диск
+	static const int PERCENT_OF_LIMIT_AFTER_COMPACTION; //до скількох відсотків межі політики стискається історія, яка її перевищила
+	static std::atomic<unsigned long long> historyMemoryBudget; //скільки байтів можуть займати історії всіх сеансів (0 - без обмеження)
+
+	std::stack<Command*> commandsHistory; //історія команд
+	SessionArena commandsArena; //арена, в якій живуть команди історії разом з їхніми текстами
+	std::stack<SessionArena::Mark> commandsMarks; //позиції арени перед кожною командою історії
+	std::stack<long long> commandsTimes; //коли кожен запис потрапив в історію (секунди від епохи)
+	bool hasBaseSnapshot; //чи перший запис історії - базовий знімок, в який злиті старіші записи (його не можна скасувати)
+	bool hasOwnRetentionPolicy; //чи задана сеансу власна політика зберігання історії
+	RetentionPolicy retentionPolicy; //власна політика зберігання історії
+	HistorySpillFile spillFile; //знімки тексту найстаріших записів, витіснені з пам'яті
+	std::atomic<unsigned long long> sizeOfSpilledHistory; //скільки байтів знімків зараз витіснено у файл
+	std::stack<std::string> clipboard; //буфер обміну
+	std::mutex clipboardMutex; //захищає буфер обміну, в який пишуть і читачі (копіювання)
+	std::mutex writerMutex; //по черзі пропускає команди, які змінюють текст або історію сеансу
+	std::atomic<std::shared_ptr<const std::string>> publishedText; //остання опублікована незмінна версія тексту для читачів
+	int currentCommandIndexInHistory; //індекс на команді, на якій знаходиться користувач, бо, можливо, він скасував декілька команд або повторив,
+	//і це потрібно відслідковвувати
+	std::string name; //ім'я сеансу
+	bool isTransactionActive; //чи виконується зараз пакет команд, який буде записаний в історію одним записом
+	std::string textBeforeTransaction; //текст на момент початку пакета команд, щоб його можна було відкотити
+	std::atomic<bool> isHistoryLoaded; //чи прочитана історія команд з метаданих (з каталогу сеанси завантажуються без неї)
+	Utf8Index utf8Index; //відповідність номерів символів та байтів тексту в режимі UTF-8
+	unsigned long long sizeOfData; //розмір тексту сеансу на диску
+	int lengthOfHistory; //скільки команд в історії (відомо й тоді, коли історія ще не прочитана)
+	long long modificationTime; //коли текст сеансу востаннє записувався (секунди від епохи)
+
+	unsigned long long getSizeOfCommand(int index) {
+		//запис займає в арені все, що виділено між його позначкою та позначкою наступного
+		unsigned long long endOfCommand = index + 1 < sizeOfCommandsHistory() ?
+			commandsMarks._Get_container()[index + 1].usedBytes : commandsArena.getStatistics().usedBytes;
+		return endOfCommand - commandsMarks._Get_container()[index].usedBytes;
+	}
+	int getCountOfCommandsToSquash(long long currentTime);
+	void reallocateCommands(int indexOfFirstCommand, Command* baseCommand, long long timeOfBase);
+	void rewriteSpillFileIfNeeded();
+
+public:
+	Session() {
+		currentCommandIndexInHistory = -1;
+		isTransactionActive = false;
+		isHistoryLoaded = true;
+		hasBaseSnapshot = false;
+		hasOwnRetentionPolicy = false;
+		retentionPolicy = { 0, 0, 0 };
+		sizeOfSpilledHistory = 0;
+		sizeOfData = 0;
+		lengthOfHistory = 0;
+		modificationTime = std::chrono::duration_cast<std::chrono::seconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+	Session(std::string filename) : Session() { name = filename; }
+
+	Command* addCommandAsLast(Command* command);
+	void addDataToClipboard(std::string data) {
+		std::lock_guard<std::mutex> lock(clipboardMutex);
+		clipboard.push(std::move(data));
+	}
+	void deleteLastCommand();
+
+	int sizeOfCommandsHistory() { return commandsHistory.size(); }
+	int sizeOfClipboard() {
+		std::lock_guard<std::mutex> lock(clipboardMutex);
+		return clipboard.size();
+	}
+
+	bool setName(std::string filename) {
+		std::string forbiddenCharacters = "/\\\":?*|<>";
+
+		for (char ch : forbiddenCharacters)
+			if (filename.find(ch) != std::string::npos)
+				return false;
+
+		name = filename + ".txt";
+		return true;
+	}
+	void setCurIndexInCommHistory(int currentCommandIndexInHistory) {
+		this->currentCommandIndexInHistory = currentCommandIndexInHistory;
+	}
+
+	std::string getName() { return name; }
+	Command* getCommandByIndex(int index) { return commandsHistory._Get_container()[index]; }
+	int getCurIndexInCommHistory() { return currentCommandIndexInHistory; }
+	bool canUndo() { return currentCommandIndexInHistory > (hasBaseSnapshot ? 0 : -1); }
+	std::string getDataFromClipboardByIndex(int index) {
+		std::lock_guard<std::mutex> lock(clipboardMutex);
+		return clipboard._Get_container()[index];
+	}
+
+	std::mutex& getWriterMutex() { return writerMutex; }
+	void publishText(const std::string& text) {
+		//кожна зміна публікує нову незмінну версію; читачі, які вже взяли попередню, продовжують працювати з нею
+		publishedText.store(std::make_shared<const std::string>(text));
+	}
+	std::shared_ptr<const std::string> getTextSnapshot() {
+		std::shared_ptr<const std::string> snapshot = publishedText.load();
+		return snapshot ? snapshot : std::make_shared<const std::string>();
+	}
+
+	SessionArena::Statistics getArenaStatistics() { return commandsArena.getStatistics(); }
+	Utf8Index* getUtf8Index() { return &utf8Index; }
+
+	//за цими властивостями впорядковані перегляди сеансів, тому після додавання сеансу в історію
+	//їх змінює лише SessionsHistory::updateSession
+	unsigned long long getSizeOfData() { return sizeOfData; }
+	int getLengthOfHistory() { return lengthOfHistory; }
+	long long getModificationTime() { return modificationTime; }
+	void setAttributes(unsigned long long sizeOfData, int lengthOfHistory, long long modificationTime) {
+		this->sizeOfData = sizeOfData;
+		this->lengthOfHistory = lengthOfHistory;
+		this->modificationTime = modificationTime;
+	}
+
+	//записи, прочитані з метаданих, не старші за останній запис тексту, тому отримують його час
+	void setTimeOfCommands(long long time) { commandsTimes = std::stack<long long>(std::deque<long long>(commandsTimes.size(), time)); }
+	bool hasBaseSnapshotInHistory() { return hasBaseSnapshot; }
+	void setBaseSnapshotInHistory(bool hasBaseSnapshot) { this->hasBaseSnapshot = hasBaseSnapshot; }
+
+	static RetentionPolicy getDefaultRetentionPolicy() { return defaultRetentionPolicy; }
+	static void setDefaultRetentionPolicy(RetentionPolicy policy) { defaultRetentionPolicy = policy; }
+	bool isRetentionPolicyOwn() { return hasOwnRetentionPolicy; }
+	RetentionPolicy getRetentionPolicy() { return hasOwnRetentionPolicy ? retentionPolicy : defaultRetentionPolicy; }
+	void setRetentionPolicy(RetentionPolicy policy) {
+		std::lock_guard<std::mutex> writerLock(writerMutex);
+		retentionPolicy = policy;
+		hasOwnRetentionPolicy = true;
+	}
+	void resetRetentionPolicy() {
+		std::lock_guard<std::mutex> writerLock(writerMutex);
+		hasOwnRetentionPolicy = false;
+	}
+	int compactHistory(Editor* editor); //повертає, скільки записів історії було злито
+	int compactLockedHistory(Editor* editor); //те саме, коли викликач уже тримає writerMutex
+
+	static unsigned long long getHistoryMemoryBudget() { return historyMemoryBudget; }
+	static void setHistoryMemoryBudget(unsigned long long budgetInBytes) { historyMemoryBudget = budgetInBytes; }
+	unsigned long long getSizeOfSpilledHistory() { return sizeOfSpilledHistory; }
+	HistoryStatistics getHistoryStatistics() {
+		//історію змінюють команди та фонове стискання під writerMutex, тому інші потоки читають її теж під ним
+		std::lock_guard<std::mutex> writerLock(writerMutex);
+		return { sizeOfCommandsHistory(), commandsArena.getStatistics(), sizeOfSpilledHistory };
+	}
+	unsigned long long spillHistory(unsigned long long bytesToFree); //викликач тримає writerMutex; повертає, скільки байтів пам'яті звільнено
+
+	bool isInTransaction() { return isTransactionActive; }
+	bool wasHistoryLoaded() { return isHistoryLoaded; }
+	void setHistoryLoaded(bool isHistoryLoaded) { this->isHistoryLoaded = isHistoryLoaded; }
+	bool beginTransaction();
+	bool commitTransaction(Editor* editor, bool isDataWritten = true); //isDataWritten - чи переписати файл сеансу
+	bool rollbackTransaction();
+
+	void printClipboard() {
+		std::lock_guard<std::mutex> lock(clipboardMutex);
+		system("cls");
+		for (int i = 0; i < clipboard.size(); i++)
+			std::cout << "\n" << i + 1 << ") \"" << clipboard._Get_container()[i] << "\"";
+		std::cout << std::endl;
+	}
+};
+
+Session::RetentionPolicy Session::defaultRetentionPolicy = { 0, 0, 0 };
+const int Session::COUNT_OF_RESIDENT_COMMANDS = 8;
+const int Session::PERCENT_OF_LIMIT_AFTER_COMPACTION = 75;
+std::atomic<unsigned long long> Session::historyMemoryBudget = 0;
+
+class SessionsIndex {
+private:
+	struct TrieNode {
+		std::map<unsigned char, int> children; //наступні символи ключа -> номери вузлів
+		std::vector<int> sessions; //номери імен, ключ яких закінчується в цьому вузлі
+	};
+
+	std::vector<std::string> names; //імена сеансів за номерами (порожнє - номер звільнений)
+	std::vector<int> freeIds; //звільнені номери імен
+	std::unordered_map<std::string, int> idsOfNames; //ім'я -> номер
+	std::vector<TrieNode> trie; //префіксне дерево зведених до нижнього регістру імен, вузол 0 - корінь
+	std::unordered_map<unsigned int, std::vector<int>> trigrams; //триграма -> номери імен, в яких вона є
+
+	static unsigned char toLowerCase(unsigned char ch) {
+		//регістр зводиться для латиниці та кирилиці в кодуванні Windows-1251, в якому консоль вводить імена
+		if ((ch >= 'A' && ch <= 'Z') || (ch >= 0xC0 && ch <= 0xDF))
+			return ch + 0x20;
+		switch (ch) {
+		case 0xA8: return 0xB8; //Ё
+		case 0xAA: return 0xBA; //Є
+		case 0xAF: return 0xBF; //Ї
+		case 0xB2: return 0xB3; //І
+		case 0xA5: return 0xB4; //Ґ
+		default: return ch;
+		}
+	}
+	static std::string makeKey(std::string name) {
+		for (char& ch : name)
+			ch = toLowerCase(ch);
+		return name;
+	}
+	static std::string makeKeyOfName(std::string name) {
+		//розширення файлу однакове в усіх сеансів, тому не індексується
+		if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".txt") == 0)
+			name.erase(name.size() - 4);
+		return makeKey(name);
+	}
+	static std::vector<unsigned int> getTrigrams(const std::string& key) {
+		//ключ доповнюється пробілами, тому короткі імена та початки імен теж мають триграми
+		std::string paddedKey = "  " + key + " ";
+		std::vector<unsigned int> trigramsOfKey;
+
+		for (size_t i = 0; i + 3 <= paddedKey.size(); i++)
+			trigramsOfKey.push_back((unsigned char)paddedKey[i] << 16 | (unsigned char)paddedKey[i + 1] << 8 | (unsigned char)paddedKey[i + 2]);
+		std::sort(trigramsOfKey.begin(), trigramsOfKey.end());
+		trigramsOfKey.erase(std::unique(trigramsOfKey.begin(), trigramsOfKey.end()), trigramsOfKey.end());
+		return trigramsOfKey;
+	}
+	int findNode(const std::string& key) const {
+		int node = 0;
+		for (unsigned char ch : key) {
+			auto childrenIter = trie[node].children.find(ch);
+			if (childrenIter == trie[node].children.end())
+				return -1;
+			node = childrenIter->second;
+		}
+		return node;
+	}
+	void collectByPrefix(int node, size_t countOfResults, std::vector<int>& results) const {
+		//обхід у порядку символів дає результати в алфавітному порядку ключів
+		for (int id : trie[node].sessions) {
+			if (results.size() == countOfResults)
+				return;
+			results.push_back(id);
+		}
+		for (auto& [ch, child] : trie[node].children) {
+			if (results.size() == countOfResults)
+				return;
+			collectByPrefix(child, countOfResults, results);
+		}
+	}
+
+public:
+	SessionsIndex() { trie.emplace_back(); }
+
+	void add(std::string name) {
+		if (idsOfNames.count(name))
+			return;
+
+		int id;
+		if (freeIds.empty()) {
+			id = names.size();
+			names.push_back(name);
+		}
+		else {
+			id = freeIds.back();
+			freeIds.pop_back();
+			names[id] = name;
+		}
+		idsOfNames[name] = id;
+
+		std::string key = makeKeyOfName(name);
+		int node = 0;
+		for (unsigned char ch : key) {
+			auto childrenIter = trie[node].children.find(ch);
+			if (childrenIter != trie[node].children.end()) {
+				node = childrenIter->second;
+				continue;
+			}
+			trie.emplace_back();
+			trie[node].children[ch] = trie.size() - 1;
+			node = trie.size() - 1;
+		}
+		trie[node].sessions.push_back(id);
+
+		for (unsigned int trigram : getTrigrams(key))
+			trigrams[trigram].push_back(id);
+	}
+	void remove(std::string name) {
+		auto idsIter = idsOfNames.find(name);
+		if (idsIter == idsOfNames.end())
+			return;
+
+		int id = idsIter->second;
+		std::string key = makeKeyOfName(name);
+		std::vector<int>& sessionsOfNode = trie[findNode(key)].sessions;
+		sessionsOfNode.erase(std::find(sessionsOfNode.begin(), sessionsOfNode.end(), id));
+
+		for (unsigned int trigram : getTrigrams(key)) {
+			std::vector<int>& ids = trigrams[trigram];
+			ids.erase(std::find(ids.begin(), ids.end(), id));
+			if (ids.empty())
+				trigrams.erase(trigram);
+		}
+
+		idsOfNames.erase(idsIter);
+		names[id].clear();
+		freeIds.push_back(id);
+	}
+	void clear() {
+		names.clear();
+		freeIds.clear();
+		idsOfNames.clear();
+		trigrams.clear();
+		trie.assign(1, TrieNode());
+	}
+
+	std::vector<std::string> search(std::string query, size_t countOfResults) const {
+		//спочатку імена, які починаються із запиту, потім найсхожіші за спільними триграмами
+		std::string key = makeKey(query);
+		std::vector<int> results;
+		std::vector<std::string> namesOfResults;
+
+		int node = findNode(key);
+		if (node != -1)
+			collectByPrefix(node, countOfResults, results);
+
+		if (results.size() < countOfResults) {
+			std::vector<unsigned int> trigramsOfQuery = getTrigrams(key);
+			std::unordered_map<int, int> countsOfSharedTrigrams;
+			for (unsigned int trigram : trigramsOfQuery) {
+				auto trigramsIter = trigrams.find(trigram);
+				if (trigramsIter != trigrams.end())
+					for (int id : trigramsIter->second)
+						countsOfSharedTrigrams[id]++;
+			}
+			for (int id : results)
+				countsOfSharedTrigrams.erase(id);
+
+			//схожість - частка спільних триграм серед усіх триграм запиту та імені (коефіцієнт Жаккара)
+			std::vector<std::pair<double, int>> candidates;
+			for (auto& [id, countOfShared] : countsOfSharedTrigrams) {
+				double countOfAll = trigramsOfQuery.size() + makeKeyOfName(names[id]).size() + 1 - countOfShared;
+				candidates.push_back({ countOfShared / countOfAll, id });
+			}
+
+			size_t countOfCandidates = std::min(countOfResults - results.size(), candidates.size());
+			std::partial_sort(candidates.begin(), candidates.begin() + countOfCandidates, candidates.end(),
+				[](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+					return a.first > b.first || a.first == b.first && a.second < b.second;
+				});
+			for (size_t i = 0; i < countOfCandidates; i++)
+				results.push_back(candidates[i].second);
+		}
+
+		for (int id : results)
+			namesOfResults.push_back(names[id]);
+		return namesOfResults;
+	}
+};
+
+class SortedSessionsView {
+public:
+	enum Criterion { BY_NAME, BY_SIZE, BY_LENGTH_OF_HISTORY, BY_MODIFICATION_TIME };
+	static constexpr int COUNT_OF_CRITERIA = 4; //скільки є способів упорядкування
+
+private:
+	struct Node {
+		Session* session; //сеанс
+		std::string name; //ім'я сеансу (для однакових ключів порядок визначає ім'я)
+		unsigned long long key; //значення, за яким упорядковано сеанси (для впорядкування за іменем не використовується)
+		unsigned int priority; //випадковий пріоритет вузла дерамиди
+		int left, right; //дочірні вузли (-1 - немає)
+		int size; //скільки вузлів у піддереві
+	};
+
+	Criterion criterion; //за чим упорядковано сеанси
+	std::vector<Node> nodes; //усі вузли дерамиди
+	std::vector<int> freeNodes; //вузли, які звільнились після видалення сеансів
+	int root; //корінь (-1 - перегляд порожній)
+	std::mt19937 random; //джерело пріоритетів
+
+	unsigned long long getKey(Session* session) {
+		switch (criterion) {
+		case BY_SIZE:
+			return session->getSizeOfData();
+		case BY_LENGTH_OF_HISTORY:
+			return session->getLengthOfHistory();
+		case BY_MODIFICATION_TIME:
+			return session->getModificationTime();
+		default:
+			return 0;
+		}
+	}
+	bool isLess(const Node& node, unsigned long long key, const std::string& name) {
+		return node.key < key || node.key == key && node.name < name;
+	}
+	int getSize(int node) { return node == -1 ? 0 : nodes[node].size; }
+	void updateSize(int node) { nodes[node].size = 1 + getSize(nodes[node].left) + getSize(nodes[node].right); }
+
+	void split(int node, unsigned long long key, const std::string& name, bool isKeyIncludedInLeft, int& left, int& right) {
+		//ліворуч - вузли, менші за ключ (або не більші, якщо isKeyIncludedInLeft), праворуч - решта
+		if (node == -1) {
+			left = right = -1;
+			return;
+		}
+		bool isNodeInLeft = isLess(nodes[node], key, name) || isKeyIncludedInLeft && nodes[node].key == key && nodes[node].name == name;
+		if (isNodeInLeft) {
+			split(nodes[node].right, key, name, isKeyIncludedInLeft, nodes[node].right, right);
+			left = node;
+		}
+		else {
+			split(nodes[node].left, key, name, isKeyIncludedInLeft, left, nodes[node].left);
+			right = node;
+		}
+		updateSize(node);
+	}
+	int merge(int left, int right) {
+		if (left == -1 || right == -1)
+			return left == -1 ? right : left;
+		if (nodes[left].priority > nodes[right].priority) {
+			nodes[left].right = merge(nodes[left].right, right);
+			updateSize(left);
+			return left;
+		}
+		nodes[right].left = merge(left, nodes[right].left);
+		updateSize(right);
+		return right;
+	}
+	void collectPage(int node, int startOfSubtree, int first, int last, std::vector<Session*>& page) {
+		//обходить лише ті піддерева, які перетинаються з позиціями [first, last), тому вартість O(log n + розмір сторінки)
+		if (node == -1 || startOfSubtree >= last || startOfSubtree + nodes[node].size <= first)
+			return;
+		int position = startOfSubtree + getSize(nodes[node].left);
+		collectPage(nodes[node].left, startOfSubtree, first, last, page);
+		if (position >= first && position < last)
+			page.push_back(nodes[node].session);
+		collectPage(nodes[node].right, position + 1, first, last, page);
+	}
+
+public:
+	SortedSessionsView() {
+		criterion = BY_NAME;
+		root = -1;
+	}
+
+	void setCriterion(Criterion criterion) {
+		this->criterion = criterion;
+		clear();
+	}
+	Criterion getCriterion() { return criterion; }
+
+	void add(Session* session) {
+		int node;
+		if (freeNodes.empty()) {
+			node = nodes.size();
+			nodes.push_back({});
+		}
+		else {
+			node = freeNodes.back();
+			freeNodes.pop_back();
+		}
+		nodes[node] = { session, session->getName(), getKey(session), (unsigned int)random(), -1, -1, 1 };
+
+		int left, right;
+		split(root, nodes[node].key, nodes[node].name, false, left, right);
+		root = merge(merge(left, node), right);
+	}
+	void remove(Session* session) {
+		//ключ береться з поточних властивостей сеансу, тому сеанс видаляється з перегляду до їхньої зміни
+		unsigned long long key = getKey(session);
+		std::string name = session->getName();
+		int left, middle, right;
+		split(root, key, name, false, left, right);
+		split(right, key, name, true, middle, right);
+		if (middle != -1)
+			freeNodes.push_back(middle);
+		root = merge(left, right);
+	}
+	void clear() {
+		nodes.clear();
+		freeNodes.clear();
+		root = -1;
+	}
+
+	int size() { return getSize(root); }
+	std::vector<Session*> getPage(int first, int countOfSessions, bool isDescending) {
+		std::vector<Session*> page;
+		int countOfAll = size();
+		first = std::max(0, std::min(first, countOfAll));
+		countOfSessions = std::max(0, std::min(countOfSessions, countOfAll - first));
+
+		if (isDescending)
+			collectPage(root, 0, countOfAll - first - countOfSessions, countOfAll - first, page);
+		else
+			collectPage(root, 0, first, first + countOfSessions, page);
+		if (isDescending)
+			std::reverse(page.begin(), page.end());
+		return page;
+	}
+};
+
+class SessionsHistory {
+private:
+	std::stack<Session*> sessions; //історія сеансів
+	mutable std::shared_mutex sessionsMutex; //список сеансів змінюється рідко, тому читачі беруть спільне блокування
+	SessionsIndex namesIndex; //індекс імен для пошуку за початком або схожістю імені
+	std::unordered_map<std::string, Session*> sessionsByName; //ім'я сеансу -> сеанс
+	SortedSessionsView sortedViews[SortedSessionsView::COUNT_OF_CRITERIA]; //сеанси, впорядковані за кожною з властивостей
+
+	void addToViews(Session* session) {
+		for (SortedSessionsView& view : sortedViews)
+			view.add(session);
+	}
+	void removeFromViews(Session* session) {
+		for (SortedSessionsView& view : sortedViews)
+			view.remove(session);
+	}
+	static void deleteWhenUnlocked(Session* session) {
+		//фоновий потік міг захопити сеанс до того, як його прибрали зі списку, тому видалення чекає, доки він закінчить
+		{
+			std::lock_guard<std::mutex> writerLock(session->getWriterMutex());
+		}
+		delete session;
+	}
+
+public:
+	SessionsHistory() {
+		for (int i = 0; i < SortedSessionsView::COUNT_OF_CRITERIA; i++)
+			sortedViews[i].setCriterion((SortedSessionsView::Criterion)i);
+	}
+	~SessionsHistory() {
+		while (!sessions.empty()) {
+			delete sessions.top();
+			sessions.pop();
+		}
+	}
+
+	void addSessionToEnd(Session* session) {
+		std::unique_lock<std::shared_mutex> lock(sessionsMutex);
+		sessions.push(session);
+		namesIndex.add(session->getName());
+		sessionsByName[session->getName()] = session;
+		addToViews(session);
+	}
+	Session* getSessionByIndex(int index) {
+		std::shared_lock<std::shared_mutex> lock(sessionsMutex);
+		return sessions._Get_container()[index];
+	}
+	Session* getSessionByName(std::string name) {
+		std::shared_lock<std::shared_mutex> lock(sessionsMutex);
+		auto sessionsIter = sessionsByName.find(name);
+		if (sessionsIter == sessionsByName.end())
+			sessionsIter = sessionsByName.find(name + ".txt");
+
+		if (sessionsIter != sessionsByName.end())
+			return sessionsIter->second;
+		else
+			return nullptr;
+	}
+	std::string deleteSessionByIndex(int index) {
+		//сеанс видаляється після того, як відпущено блокування списку і звільнився його writerMutex (див. tryToLockSession)
+		std::unique_lock<std::shared_mutex> lock(sessionsMutex);
+		auto ptrOnUnderlyingContainer = &sessions._Get_container();
+		auto ptrOnRetiringSession = (*ptrOnUnderlyingContainer)[index];
+
+		std::string filename = ptrOnRetiringSession->getName();
+
+		std::deque<Session*> notRetiringElements;
+
+		remove_copy(ptrOnUnderlyingContainer->begin(),
+			ptrOnUnderlyingContainer->end(),
+			back_inserter(notRetiringElements),
+			ptrOnRetiringSession);
+
+		sessions = std::stack<Session*>(notRetiringElements);
+
+		namesIndex.remove(filename);
+		sessionsByName.erase(filename);
+		removeFromViews(ptrOnRetiringSession);
+		lock.unlock();
+		deleteWhenUnlocked(ptrOnRetiringSession);
+
+		return filename;
+	}
+	std::string deleteSessionByName(std::string name) {
+		auto sessionToDelete = getSessionByName(name);
+		if (!sessionToDelete)
+			return "";
+
+		std::unique_lock<std::shared_mutex> lock(sessionsMutex);
+		Session* topSession;
+		std::string filename = sessionToDelete->getName();
+		std::stack<Session*> tempStack;
+		std::vector<Session*> retiringSessions;
+
+
+		while (!sessions.empty()) {
+			topSession = sessions.top();
+			sessions.pop();
+
+			if (topSession->getName() == name || topSession->getName() == name + ".txt") {
+				namesIndex.remove(topSession->getName());
+				sessionsByName.erase(topSession->getName());
+				removeFromViews(topSession);
+				retiringSessions.push_back(topSession);
+				continue;
+			}
+
+			tempStack.push(topSession);
+		}
+
+		while (!tempStack.empty()) {
+			sessions.push(tempStack.top());
+			tempStack.pop();
+		}
+		lock.unlock();
+		for (Session* retiringSession : retiringSessions)
+			deleteWhenUnlocked(retiringSession);
+
+		return filename;
+	}
+
+	void updateSession(Session* session, unsigned long long sizeOfData, int lengthOfHistory, long long modificationTime) {
+		//сеанс виймається з переглядів за старими властивостями і вставляється за новими, тобто O(log n)
+		std::unique_lock<std::shared_mutex> lock(sessionsMutex);
+		removeFromViews(session);
+		session->setAttributes(sizeOfData, lengthOfHistory, modificationTime);
+		addToViews(session);
+	}
+	std::vector<Session*> getSortedPage(SortedSessionsView::Criterion criterion, int first, int countOfSessions, bool isDescending) {
+		std::shared_lock<std::shared_mutex> lock(sessionsMutex);
+		return sortedViews[criterion].getPage(first, countOfSessions, isDescending);
+	}
+
+	std::vector<std::string> getNamesOfSessions() {
+		std::shared_lock<std::shared_mutex> lock(sessionsMutex);
+		std::vector<std::string> names;
+		for (Session* session : sessions._Get_container())
+			names.push_back(session->getName());
+		return names;
+	}
+	Session* tryToLockSession(std::string name, std::unique_lock<std::mutex>& writerLock) {
+		//сеанс повертається з уже захопленим (без очікування) writerMutex, а видалення сеансу чекає на нього,
+		//тому з сеансом можна довго працювати і після того, як блокування списку знято
+		std::shared_lock<std::shared_mutex> lock(sessionsMutex);
+		auto sessionsIter = sessionsByName.find(name);
+		if (sessionsIter == sessionsByName.end())
+			return nullptr;
+		writerLock = std::unique_lock<std::mutex>(sessionsIter->second->getWriterMutex(), std::try_to_lock);
+		return writerLock.owns_lock() ? sessionsIter->second : nullptr;
+	}
+
+	void forEachSession(std::function<void(Session*)> action) {
+		//поки сеанс обробляється, його не можна видалити, бо видалення чекає на унікальне блокування
+		std::shared_lock<std::shared_mutex> lock(sessionsMutex);
+		for (Session* session : sessions._Get_container())
+			action(session);
+	}
+
+	std::vector<std::string> searchSessions(std::string query, size_t countOfResults) {
+		std::shared_lock<std::shared_mutex> lock(sessionsMutex);
+		return namesIndex.search(query, countOfResults);
+	}
+	int getIndexOfSession(std::string name) {
+		std::shared_lock<std::shared_mutex> lock(sessionsMutex);
+		auto ptrOnUnderlyingContainer = &sessions._Get_container();
+		for (int i = 0; i < ptrOnUnderlyingContainer->size(); i++)
+			if ((*ptrOnUnderlyingContainer)[i]->getName() == name)
+				return i;
+		return -1;
+	}
+
+	bool isEmpty() { return size() == 0; }
+	int size() {
+		std::shared_lock<std::shared_mutex> lock(sessionsMutex);
+		return sessions.size();
+	}
+
+	void printSessionsHistory() {
+		std::shared_lock<std::shared_mutex> lock(sessionsMutex);
+		system("cls");
+		for (int i = 0; i < sessions.size(); i++)
+			std::cout << "\nСеанс #" << i + 1 << ": " << sessions._Get_container()[i]->getName();
+		std::cout << std::endl;
+	}
+
+	void sortByName() {
+		//перегляд за іменем вже впорядкований, тому список лише переписується з нього за O(n)
+		std::unique_lock<std::shared_mutex> lock(sessionsMutex);
+		SortedSessionsView& viewByName = sortedViews[SortedSessionsView::BY_NAME];
+		std::vector<Session*> sessionsInOrder = viewByName.getPage(0, viewByName.size(), false);
+		sessions = std::stack<Session*>(std::deque<Session*>(sessionsInOrder.begin(), sessionsInOrder.end()));
+	}
+};
+
+class Editor {
+private:
+	static SessionsHistory* sessionsHistory; //історія сеансів
+	static thread_local Session* currentSession; //сеанс, з яким працює поточний потік
+	static thread_local std::string* currentText; //текст, який поточний потік редагує в даний момент
+	static thread_local Utf8Index::Splice lastSplice; //яку частину тексту змінила остання команда цього потоку
+	static bool isUtf8Enabled; //чи текст сеансів у UTF-8 (позиції тоді вказують на символи, а не на байти)
+	static const size_t MIN_COUNT_OF_LINES_FOR_THREAD; //скільки рядків має припадати на потік паралельного сортування
+
+	struct SortedLine {
+		unsigned long long prefix; //перші 8 байтів рядка як число (старший байт - перший), щоб більшість порівнянь не читала сам рядок
+		std::string_view line; //рядок у тексті сеансу
+	};
+
+	static size_t getLengthOfCharacterAt(std::string_view text, size_t position);
+	static size_t getStartOfLastCharacter(std::string_view text);
+	static std::vector<std::string_view> splitIntoLines(std::string_view text);
+	static void replaceByLines(std::pmr::string* textToProcess, const std::vector<std::string_view>& lines);
+	static void sortLineViews(std::vector<std::string_view>& lines);
+
+public:
+	Editor();
+
+	~Editor() {
+		//тексти сеансів належать їхнім власникам (кешу текстів або серверу), а не редактору
+		delete sessionsHistory;
+	}
+
+	void tryToLoadSessions();
+	bool tryToUnloadSessions(); //повертає false, якщо метадані якогось сеансу не вдалося записати
+
+	void copy(std::string_view textToProcess, int startPosition, int endPosition);
+	void paste(std::pmr::string* textToProcess, int startPosition, int endPosition, std::string_view textToPaste);
+	void cut(std::pmr::string* textToProcess, int startPosition, int endPosition);
+	void remove(std::pmr::string* textToProcess, int startPosition, int endPosition);
+	void replaceRange(std::pmr::string* textToProcess, int startPosition, int endPosition, std::string_view textToInsert);
+	void sortLines(std::pmr::string* textToProcess);
+	void uniqueLines(std::pmr::string* textToProcess);
+	void filterLines(std::pmr::string* textToProcess, std::string_view pattern, bool isMatchingKept);
+
+	static Session* getCurrentSession();
+	static SessionsHistory* getSessionsHistory();
+	static std::string* getCurrentText();
+	static void setCurrentSession(Session* session);
+	static void setCurrentText(std::string* text);
+	static std::shared_ptr<const std::string> getCurrentTextSnapshot();
+
+	static void printCurrentText();
+	static std::pair<size_t, size_t> findChangedRange(const std::string& textBefore, const std::string& textAfter);
+
+	static void setUtf8Enabled(bool isUtf8Enabled);
+	static bool isUtf8Mode();
+	static void resetLastSplice();
+	static Utf8Index::Splice getLastSplice();
+};
+
+class Command {
+protected:
+	Editor* editor; //редактор, в якому відбувається редагування тексту за допомогою команд
+	int startPosition, endPosition; //початкова та кінцева позиції для вставки, заміни, видалення, копіювання, вирізання
+	std::pmr::string textToProcess, textToPaste; //поля для тексту, який обробляємо і для тексту, який вставляємо 
+	Command* previousCommand, * commandToUndoOrRedo; //вказівник на попередню команду (в історії команд щось по типу однонапрямленого списка),
+	//далі - вказівник на команду, яку збираємось скасувати або повторити
+	HistorySpillFile* spillFile; //файл, куди витіснено textToProcess (nullptr - текст у пам'яті)
+	unsigned long long offsetInSpillFile; //де у файлі лежить витіснений текст
+	size_t sizeOfSpilledText; //розмір витісненого тексту
+
+	Command() {
+		previousCommand = nullptr;
+		commandToUndoOrRedo = nullptr;
+		spillFile = nullptr;
+		offsetInSpillFile = 0;
+		sizeOfSpilledText = 0;
+	}
+	Command(const Command& command, std::pmr::memory_resource* resource) : textToProcess(command.textToProcess, resource), textToPaste(resource) {
+		//копія для історії: текст для вставки після виконання вже не потрібен, бо скасування та повторення працюють зі знімками
+		editor = command.editor;
+		startPosition = command.startPosition;
+		endPosition = command.endPosition;
+		previousCommand = command.previousCommand;
+		commandToUndoOrRedo = command.commandToUndoOrRedo;
+		spillFile = command.spillFile;
+		offsetInSpillFile = command.offsetInSpillFile;
+		sizeOfSpilledText = command.sizeOfSpilledText;
+	}
+
+public:
+	virtual ~Command() { }
+
+	virtual void execute() = 0;
+	virtual void undo() = 0;
+	virtual void redo(); //повторення після скасування (за замовчуванням - відновлення знімка тексту після команди)
+	virtual Command* copy(SessionArena* arena) = 0;
+
+	void setParameters(std::string typeOfCommand, Command* previousCommand, Command* commandToUndoOrRedo, int startPosition, int endPosition, std::string textToPaste) {
+		if (typeOfCommand == "Undo" || typeOfCommand == "Redo")
+		{
+			this->commandToUndoOrRedo = commandToUndoOrRedo;
+			return;
+		}
+
+		size_t sizeOfText = typeOfCommand == "Copy" ? Editor::getCurrentTextSnapshot()->size() : Editor::getCurrentText()->size();
+		if (startPosition > endPosition && endPosition > -1 && startPosition < sizeOfText)
+			std::swap(startPosition, endPosition);
+
+		if (startPosition == -1 && endPosition == -1) {
+			startPosition = 0;
+			endPosition = 0;
+		}
+
+		this->startPosition = startPosition;
+		this->endPosition = endPosition;
+		this->previousCommand = previousCommand;
+		this->spillFile = nullptr;
+
+		//перетворення змінюють текст на місці й зберігають лише дані для скасування, тому знімок їм не потрібен
+		if (typeOfCommand == "Copy" || TextTransforms::findTransform(typeOfCommand) != -1)
+			return;
+
+		this->textToProcess = *(Editor::getCurrentText());
+
+		if (typeOfCommand == "Paste" || typeOfCommand == "KeepLines" || typeOfCommand == "DropLines" || typeOfCommand == "ExternalChange")
+			this->textToPaste = textToPaste;
+	}
+
+	virtual std::string getTextToProcess() {
+		//витіснений текст читається з файлу лише тоді, коли він справді потрібен (глибоке скасування, збереження історії)
+		return spillFile ? spillFile->read(offsetInSpillFile, sizeOfSpilledText) : std::string(textToProcess);
+	}
+	virtual void setTextToProcess(std::string textToProcess) {
+		this->textToProcess = textToProcess;
+		spillFile = nullptr;
+	}
+	size_t getSizeOfResidentText() { return textToProcess.size(); }
+	size_t getSizeOfSpilledText() { return spillFile ? sizeOfSpilledText : 0; }
+	unsigned long long getOffsetInSpillFile() { return offsetInSpillFile; }
+	void setOffsetInSpillFile(unsigned long long offsetInSpillFile) { this->offsetInSpillFile = offsetInSpillFile; }
+	bool spillText(HistorySpillFile* spillFile, std::string nameOfSession) {
+		//пам'ять тексту звільниться, коли сеанс перенесе історію в нову арену
+		if (this->spillFile || !spillFile->write(nameOfSession, textToProcess, offsetInSpillFile))
+			return false;
+		this->spillFile = spillFile;
+		sizeOfSpilledText = textToProcess.size();
+		textToProcess.clear();
+		return true;
+	}
+	void setPreviousCommand(Command* previousCommand) { this->previousCommand = previousCommand; }
+};
+
+class CopyCommand : public Command {
+public:
+	CopyCommand(Editor* editor);
+	CopyCommand(const CopyCommand& command, std::pmr::memory_resource* resource) : Command(command, resource) { }
+
+	void execute() override;
+	void undo() override;
+	Command* copy(SessionArena* arena) override;
+};
+
+class DeleteCommand : public Command {
+public:
+	DeleteCommand(Editor* editor);
+	DeleteCommand(const DeleteCommand& command, std::pmr::memory_resource* resource) : Command(command, resource) { }
+
+	void execute() override;
+	void undo() override;
+	Command* copy(SessionArena* arena) override;
+};
+
+class CutCommand : public Command {
+public:
+	CutCommand(Editor* editor);
+	CutCommand(const CutCommand& command, std::pmr::memory_resource* resource) : Command(command, resource) { }
+
+	void execute() override;
+	void undo() override;
+	Command* copy(SessionArena* arena) override;
+};
+
+class PasteCommand : public Command {
+public:
+	PasteCommand(Editor* editor);
+	PasteCommand(const PasteCommand& command, std::pmr::memory_resource* resource) : Command(command, resource) { }
+
+	void execute() override;
+	void undo() override;
+	Command* copy(SessionArena* arena) override;
+};
+
+class BatchCommand : public Command {
+public:
+	BatchCommand(Editor* editor);
+	BatchCommand(const BatchCommand& command, std::pmr::memory_resource* resource) : Command(command, resource) { }
+
+	void execute() override;
+	void undo() override;
+	Command* copy(SessionArena* arena) override;
+};
+
+class SortLinesCommand : public Command {
+public:
+	SortLinesCommand(Editor* editor);
+	SortLinesCommand(const SortLinesCommand& command, std::pmr::memory_resource* resource) : Command(command, resource) { }
+
+	void execute() override;
+	void undo() override;
+	Command* copy(SessionArena* arena) override;
+};
+
+class UniqueLinesCommand : public Command {
+public:
+	UniqueLinesCommand(Editor* editor);
+	UniqueLinesCommand(const UniqueLinesCommand& command, std::pmr::memory_resource* resource) : Command(command, resource) { }
+
+	void execute() override;
+	void undo() override;
+	Command* copy(SessionArena* arena) override;
+};
+
+class FilterLinesCommand : public Command {
+private:
+	bool isMatchingKept; //залишити рядки, які містять зразок (інакше - видалити їх)
+
+public:
+	FilterLinesCommand(Editor* editor, bool isMatchingKept);
+	FilterLinesCommand(const FilterLinesCommand& command, std::pmr::memory_resource* resource) : Command(command, resource) {
+		isMatchingKept = command.isMatchingKept;
+	}
+
+	void execute() override;
+	void undo() override;
+	Command* copy(SessionArena* arena) override;
+};
+
+class TransformCommand : public Command {
+private:
+	TextTransforms::Transform transform; //яке перетворення виконує команда
+	std::pmr::string undoData; //позиції змінених байтів або правки, за якими текст повертається до стану перед командою
+	bool hasUndoData; //чи є дані для скасування (після читання історії з диска їх немає)
+	bool hasSnapshot; //чи textToProcess вже містить текст після команди (перша в історії або вже не остання)
+	bool isUtf8Mode; //чи виконувалась команда в режимі UTF-8 (від нього залежить, наприклад, ширина символів при заміні табуляцій)
+
+public:
+	TransformCommand(Editor* editor, TextTransforms::Transform transform);
+	TransformCommand(const TransformCommand& command, std::pmr::memory_resource* resource) : Command(command, resource), undoData(command.undoData, resource) {
+		transform = command.transform;
+		hasUndoData = command.hasUndoData;
+		hasSnapshot = command.hasSnapshot;
+		isUtf8Mode = command.isUtf8Mode;
+	}
+
+	void execute() override;
+	void undo() override;
+	void redo() override;
+	Command* copy(SessionArena* arena) override;
+	std::string getTextToProcess() override;
+	void setTextToProcess(std::string textToProcess) override;
+	bool hasSnapshotOfText() { return hasSnapshot; }
+	bool wasExecutedInUtf8Mode() { return isUtf8Mode; }
+	void setUtf8Mode(bool isUtf8Mode) { this->isUtf8Mode = isUtf8Mode; }
+
+	TextTransforms::Transform getTransform() { return transform; }
+	size_t getSizeOfUndoData() { return undoData.size(); }
+};
+
+class ExternalChangeCommand : public Command {
+public:
+	ExternalChangeCommand(Editor* editor);
+	ExternalChangeCommand(const ExternalChangeCommand& command, std::pmr::memory_resource* resource) : Command(command, resource) { }
+
+	void execute() override;
+	void undo() override;
+	Command* copy(SessionArena* arena) override;
+};
+
+class UndoCommand : public Command {
+public:
+	void execute() override;
+	void undo() override;
+	Command* copy(SessionArena* arena) override;
+};
+
+class RedoCommand : public Command {
+public:
+	void execute() override;
+	void undo() override;
+	Command* copy(SessionArena* arena) override;
+};
+
+class SessionsCatalog {
+public:
+	static constexpr int MAX_LENGTH_OF_NAME = 260; //найдовше ім'я сеансу, яке вміщується в запис
+
+	struct Record {
+		char name[MAX_LENGTH_OF_NAME]; //ім'я сеансу (файлу)
+		unsigned char isUsed; //чи зайнятий запис
+		unsigned long long orderInList; //позиція сеансу у списку сеансів
+		unsigned long long dataOffset, dataSize; //де лежить текст сеансу та його розмір
+		unsigned long long metadataOffset, metadataSize; //де лежить історія команд та її розмір
+		int countOfCommands; //скільки команд в історії
+		int currentCommandIndex; //поточна позиція в історії
+		long long lastAccessTime; //коли сеанс востаннє відкривався (секунди від епохи)
+		long long lastModificationTime; //коли текст сеансу востаннє записувався (секунди від епохи)
+	};
+
+private:
+	static const char SIGNATURE[4]; //підпис файлу каталогу
+	static const unsigned int VERSION; //версія формату записів
+	static constexpr unsigned int INITIAL_CAPACITY = 64; //скільки записів вміщує новий каталог
+
+	struct Header {
+		char signature[4]; //підпис для перевірки, що це справді каталог
+		unsigned int version; //версія формату
+		unsigned int capacity; //скільки записів вміщує файл
+		unsigned int isSortedByName; //чи був список сеансів відсортований за іменем
+		unsigned long long nextOrderInList; //позиція для наступного створеного сеансу
+	};
+
+	HANDLE file; //відкритий файл каталогу
+	HANDLE mapping; //відображення файлу в пам'ять
+	Header* header; //початок відображеного файлу
+	Record* records; //записи одразу після заголовка
+	std::map<std::string, unsigned int> indexesOfRecords; //ім'я сеансу -> номер запису
+	std::vector<unsigned int> freeRecords; //номери вільних записів
+	std::mutex catalogMutex; //каталог оновлюють і головний потік, і сервер
+
+	static unsigned long long getSizeOfFile(unsigned int capacity) {
+		return sizeof(Header) + (unsigned long long)capacity * sizeof(Record);
+	}
+	bool mapFile(unsigned long long sizeOfFile) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)(sizeOfFile >> 32), (DWORD)sizeOfFile, NULL);
+		if (!mapping)
+			return false;
+
+		header = (Header*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+		if (!header) {
+			CloseHandle(mapping);
+			mapping = NULL;
+			return false;
+		}
+		records = (Record*)(header + 1);
+		return true;
+	}
+	void unmapFile() {
+		if (header)
+			UnmapViewOfFile(header);
+		if (mapping)
+			CloseHandle(mapping);
+		header = nullptr;
+		records = nullptr;
+		mapping = NULL;
+	}
+	bool grow() {
+		//файл подвоюється, тож додавання сеансу в середньому не переписує каталог
+		unsigned int oldCapacity = header->capacity, newCapacity = oldCapacity * 2;
+		unmapFile();
+		if (!mapFile(getSizeOfFile(newCapacity))) {
+			close();
+			return false;
+		}
+
+		header->capacity = newCapacity;
+		for (unsigned int i = newCapacity; i > oldCapacity; i--) {
+			records[i - 1].isUsed = 0;
+			freeRecords.push_back(i - 1);
+		}
+		return true;
+	}
+	Record* findRecord(std::string name) {
+		auto recordsIter = indexesOfRecords.find(name);
+		return recordsIter == indexesOfRecords.end() ? nullptr : &records[recordsIter->second];
+	}
+
+public:
+	SessionsCatalog() {
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+		header = nullptr;
+		records = nullptr;
+	}
+	~SessionsCatalog() { close(); }
+
+	bool open(std::string filepath) {
+		//повертає false, якщо каталогу немає або він пошкоджений - тоді сеанси шукаються в директорії
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		LARGE_INTEGER sizeOfFile;
+
+		file = CreateFileA(filepath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		if (!GetFileSizeEx(file, &sizeOfFile) || sizeOfFile.QuadPart < (long long)sizeof(Header) || !mapFile(sizeOfFile.QuadPart)) {
+			close();
+			return false;
+		}
+		if (std::string(header->signature, 4) != std::string(SIGNATURE, 4) || header->version != VERSION ||
+			getSizeOfFile(header->capacity) > (unsigned long long)sizeOfFile.QuadPart) {
+			close();
+			return false;
+		}
+
+		indexesOfRecords.clear();
+		freeRecords.clear();
+		for (unsigned int i = header->capacity; i > 0; i--) {
+			Record& record = records[i - 1];
+			record.name[MAX_LENGTH_OF_NAME - 1] = '\0';
+			if (record.isUsed)
+				indexesOfRecords[record.name] = i - 1;
+			else
+				freeRecords.push_back(i - 1);
+		}
+		return true;
+	}
+	bool create(std::string filepath) {
+		std::lock_guard<std::mutex> lock(catalogMutex);
+
+		file = CreateFileA(filepath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		if (!mapFile(getSizeOfFile(INITIAL_CAPACITY))) {
+			close();
+			return false;
+		}
+
+		std::copy(SIGNATURE, SIGNATURE + 4, header->signature);
+		header->version = VERSION;
+		header->capacity = INITIAL_CAPACITY;
+		header->isSortedByName = 0;
+		header->nextOrderInList = 0;
+
+		indexesOfRecords.clear();
+		freeRecords.clear();
+		for (unsigned int i = INITIAL_CAPACITY; i > 0; i--) {
+			records[i - 1].isUsed = 0;
+			freeRecords.push_back(i - 1);
+		}
+		return true;
+	}
+	void close() {
+		unmapFile();
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+	bool isOpen() { return header != nullptr; }
+	void flush() {
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		if (header)
+			FlushViewOfFile(header, 0);
+	}
+
+	std::vector<Record> getRecordsInOrder() {
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		std::vector<Record> recordsInOrder;
+
+		for (auto& [name, index] : indexesOfRecords)
+			recordsInOrder.push_back(records[index]);
+		std::sort(recordsInOrder.begin(), recordsInOrder.end(), [](const Record& a, const Record& b) {
+			return a.orderInList < b.orderInList;
+			});
+		return recordsInOrder;
+	}
+	bool isSortedByName() {
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		return header && header->isSortedByName;
+	}
+
+	bool addRecord(std::string name, unsigned long long dataSize = 0, int countOfCommands = 0, int currentCommandIndex = -1,
+		long long lastModificationTime = -1) { //-1 - сеанс змінений зараз
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		if (!header || name.size() >= MAX_LENGTH_OF_NAME || indexesOfRecords.count(name))
+			return false;
+		if (freeRecords.empty() && !grow())
+			return false;
+
+		unsigned int index = freeRecords.back();
+		freeRecords.pop_back();
+
+		Record& record = records[index];
+		std::fill(record.name, record.name + MAX_LENGTH_OF_NAME, '\0');
+		std::copy(name.begin(), name.end(), record.name);
+		record.orderInList = header->nextOrderInList++;
+		record.dataOffset = record.metadataOffset = record.metadataSize = 0;
+		record.dataSize = dataSize;
+		record.countOfCommands = countOfCommands;
+		record.currentCommandIndex = currentCommandIndex;
+		record.lastAccessTime = std::chrono::duration_cast<std::chrono::seconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+		record.lastModificationTime = lastModificationTime == -1 ? record.lastAccessTime : lastModificationTime;
+		record.isUsed = 1;
+
+		header->isSortedByName = 0;
+		indexesOfRecords[name] = index;
+		return true;
+	}
+	void removeRecord(std::string name) {
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		auto recordsIter = indexesOfRecords.find(name);
+		if (!header || recordsIter == indexesOfRecords.end())
+			return;
+
+		records[recordsIter->second].isUsed = 0;
+		freeRecords.push_back(recordsIter->second);
+		indexesOfRecords.erase(recordsIter);
+	}
+
+	void updateData(std::string name, unsigned long long dataSize) {
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		if (Record* record = findRecord(name))
+			record->dataSize = dataSize;
+	}
+	void updateHistory(std::string name, int countOfCommands, int currentCommandIndex, unsigned long long metadataSize) {
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		if (Record* record = findRecord(name)) {
+			record->countOfCommands = countOfCommands;
+			record->currentCommandIndex = currentCommandIndex;
+			record->metadataSize = metadataSize;
+		}
+	}
+	void updateOffsets(std::string name, unsigned long long dataOffset, unsigned long long dataSize,
+		unsigned long long metadataOffset, unsigned long long metadataSize) {
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		if (Record* record = findRecord(name)) {
+			record->dataOffset = dataOffset;
+			record->dataSize = dataSize;
+			record->metadataOffset = metadataOffset;
+			record->metadataSize = metadataSize;
+		}
+	}
+	void updateAccessTime(std::string name) {
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		if (Record* record = findRecord(name))
+			record->lastAccessTime = std::chrono::duration_cast<std::chrono::seconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+	void updateModificationTime(std::string name, long long lastModificationTime) {
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		if (Record* record = findRecord(name))
+			record->lastModificationTime = lastModificationTime;
+	}
+	void updateOrder(std::vector<std::string> namesInOrder, bool isSortedByName) {
+		std::lock_guard<std::mutex> lock(catalogMutex);
+		if (!header)
+			return;
+
+		header->nextOrderInList = 0;
+		for (std::string name : namesInOrder)
+			if (Record* record = findRecord(name))
+				record->orderInList = header->nextOrderInList++;
+		header->isSortedByName = isSortedByName;
+	}
+};
+
+const char SessionsCatalog::SIGNATURE[4] = { 'S', 'C', 'A', 'T' };
+const unsigned int SessionsCatalog::VERSION = 2;
+
+class PackedStore {
+public:
+	struct Location {
+		unsigned long long offset, size; //де починається вміст запису у файлі та його розмір (зміщення 0 - запису немає)
+	};
+	struct Entry {
+		Location data, metadata; //останні записи тексту та історії сеансу
+	};
+
+private:
+	enum KindOfRecord : unsigned char { DATA_RECORD, METADATA_RECORD, DELETION_RECORD };
+
+	static const char SIGNATURE_OF_FILE[4], SIGNATURE_OF_RECORD[4]; //підписи файлу та кожного запису
+	static constexpr unsigned long long SIZE_OF_FILE_HEADER = 4; //розмір заголовка файлу
+	static constexpr unsigned long long SIZE_OF_RECORD_HEADER = 4 + 1 + 4 + 8; //підпис, вид, довжина імені, довжина вмісту
+	static const unsigned long long MIN_SIZE_OF_GARBAGE_FOR_COMPACTION; //з якого обсягу застарілих записів варто ущільнювати
+	static const int COMPACTION_RETRY_DELAY_IN_MS; //пауза після невдалого ущільнення
+
+	std::string filepath; //шлях до файлу сховища
+	std::fstream file; //файл, у кінець якого дописуються записи
+	unsigned long long sizeOfFile, sizeOfGarbage; //розмір файлу та скільки з нього займають застарілі записи
+	std::map<std::string, Entry> entries; //індекс: ім'я сеансу -> його актуальні записи
+	std::function<void(const std::string&, const Entry&)> onEntryChanged; //викликається, коли записи сеансу змінили місце
+	std::mutex storeMutex; //захищає файл та індекс
+	std::condition_variable compactionCondition; //будить фоновий потік ущільнення
+	std::thread compactor; //фоновий потік ущільнення
+	bool isStopping; //чи потрібно зупинити фоновий потік
+
+	static unsigned long long getSizeOfRecord(const std::string& name, unsigned long long sizeOfPayload) {
+		return SIZE_OF_RECORD_HEADER + name.size() + sizeOfPayload;
+	}
+	static bool writeRecord(std::ostream& stream, KindOfRecord kind, const std::string& name, std::string_view payload) {
+		unsigned int lengthOfName = name.size();
+		unsigned long long lengthOfPayload = payload.size();
+
+		stream.write(SIGNATURE_OF_RECORD, 4);
+		stream.write((const char*)&kind, sizeof(kind));
+		stream.write((const char*)&lengthOfName, sizeof(lengthOfName));
+		stream.write((const char*)&lengthOfPayload, sizeof(lengthOfPayload));
+		stream.write(name.data(), lengthOfName);
+		stream.write(payload.data(), lengthOfPayload);
+		return (bool)stream;
+	}
+	static bool readRecordHeader(std::istream& stream, unsigned long long sizeOfStream, unsigned long long offset,
+		KindOfRecord& kind, std::string& name, unsigned long long& lengthOfPayload) {
+		//недописаний в кінці файлу запис (наприклад, після збою) вважається кінцем журналу
+		char signature[4];
+		unsigned int lengthOfName;
+
+		if (offset + SIZE_OF_RECORD_HEADER > sizeOfStream)
+			return false;
+
+		stream.seekg(offset);
+		stream.read(signature, 4);
+		stream.read((char*)&kind, sizeof(kind));
+		stream.read((char*)&lengthOfName, sizeof(lengthOfName));
+		stream.read((char*)&lengthOfPayload, sizeof(lengthOfPayload));
+		if (!stream || std::string(signature, 4) != std::string(SIGNATURE_OF_RECORD, 4) || kind > DELETION_RECORD ||
+			getSizeOfRecord(std::string(), lengthOfName) + lengthOfPayload > sizeOfStream - offset)
+			return false;
+
+		name.resize(lengthOfName);
+		stream.read(name.data(), lengthOfName);
+		return (bool)stream;
+	}
+
+	static unsigned long long applyRecord(std::map<std::string, Entry>& entries, KindOfRecord kind, const std::string& name,
+		unsigned long long offsetOfPayload, unsigned long long lengthOfPayload) {
+		//оновлює індекс записом і повертає, на скільки байтів збільшилось сміття
+		auto entriesIter = entries.find(name);
+		Location* oldLocation = nullptr;
+		unsigned long long garbage = 0;
+
+		if (entriesIter != entries.end())
+			oldLocation = kind == METADATA_RECORD ? &entriesIter->second.metadata : &entriesIter->second.data;
+		if (oldLocation && oldLocation->offset)
+			garbage += getSizeOfRecord(name, oldLocation->size);
+
+		if (kind == DELETION_RECORD) {
+			if (entriesIter != entries.end() && entriesIter->second.metadata.offset)
+				garbage += getSizeOfRecord(name, entriesIter->second.metadata.size);
+			if (entriesIter != entries.end())
+				entries.erase(entriesIter);
+			return garbage + getSizeOfRecord(name, 0);
+		}
+
+		Entry& entry = entries[name];
+		(kind == METADATA_RECORD ? entry.metadata : entry.data) = { offsetOfPayload, lengthOfPayload };
+		return garbage;
+	}
+	bool scanRecords() {
+		unsigned long long offset = SIZE_OF_FILE_HEADER, lengthOfPayload;
+		KindOfRecord kind;
+		std::string name;
+
+		entries.clear();
+		sizeOfGarbage = 0;
+		while (readRecordHeader(file, sizeOfFile, offset, kind, name, lengthOfPayload)) {
+			unsigned long long offsetOfPayload = offset + SIZE_OF_RECORD_HEADER + name.size();
+			sizeOfGarbage += applyRecord(entries, kind, name, offsetOfPayload, lengthOfPayload);
+			offset = offsetOfPayload + lengthOfPayload;
+		}
+		file.clear();
+
+		//все, що після останнього цілого запису, відкидається наступним дописуванням
+		sizeOfFile = offset;
+		return true;
+	}
+	bool areEntriesValid(const std::map<std::string, Entry>& knownEntries) {
+		for (auto& [name, entry] : knownEntries)
+			for (const Location& location : { entry.data, entry.metadata })
+				if (location.offset && location.offset + location.size > sizeOfFile)
+					return false;
+		return true;
+	}
+	unsigned long long getSizeOfLiveRecords() {
+		unsigned long long size = 0;
+		for (auto& [name, entry] : entries)
+			for (const Location& location : { entry.data, entry.metadata })
+				if (location.offset)
+					size += getSizeOfRecord(name, location.size);
+		return size;
+	}
+	bool isCompactionNeeded() {
+		return sizeOfGarbage >= MIN_SIZE_OF_GARBAGE_FOR_COMPACTION && sizeOfGarbage * 2 >= sizeOfFile;
+	}
+
+	bool append(KindOfRecord kind, const std::string& name, std::string_view payload) {
+		std::lock_guard<std::mutex> lock(storeMutex);
+		if (!file.is_open())
+			return false;
+
+		file.seekp(sizeOfFile);
+		if (!writeRecord(file, kind, name, payload) || !file.flush()) {
+			file.clear();
+			return false;
+		}
+
+		unsigned long long offsetOfPayload = sizeOfFile + SIZE_OF_RECORD_HEADER + name.size();
+		sizeOfFile += getSizeOfRecord(name, payload.size());
+		sizeOfGarbage += applyRecord(entries, kind, name, offsetOfPayload, payload.size());
+
+		if (onEntryChanged && kind != DELETION_RECORD)
+			onEntryChanged(name, entries[name]);
+		if (isCompactionNeeded())
+			compactionCondition.notify_one();
+		return true;
+	}
+	bool read(KindOfRecord kind, const std::string& name, std::string& payload) {
+		std::lock_guard<std::mutex> lock(storeMutex);
+		auto entriesIter = entries.find(name);
+		if (!file.is_open() || entriesIter == entries.end())
+			return false;
+
+		Location location = kind == METADATA_RECORD ? entriesIter->second.metadata : entriesIter->second.data;
+		if (!location.offset)
+			return false;
+
+		payload.resize(location.size);
+		file.seekg(location.offset);
+		file.read(payload.data(), location.size);
+		if (!file) {
+			file.clear();
+			return false;
+		}
+		return true;
+	}
+
+	void runCompactor() {
+		std::unique_lock<std::mutex> lock(storeMutex);
+		while (!isStopping) {
+			compactionCondition.wait(lock, [this]() { return isStopping || isCompactionNeeded(); });
+			if (isStopping)
+				break;
+
+			lock.unlock();
+			bool wasCompacted = compact();
+			lock.lock();
+
+			if (!wasCompacted)
+				compactionCondition.wait_for(lock, std::chrono::milliseconds(COMPACTION_RETRY_DELAY_IN_MS), [this]() { return isStopping; });
+		}
+	}
+
+public:
+	PackedStore() {
+		sizeOfFile = sizeOfGarbage = 0;
+		isStopping = false;
+	}
+	~PackedStore() { close(); }
+
+	void setOnEntryChanged(std::function<void(const std::string&, const Entry&)> onEntryChanged) {
+		this->onEntryChanged = onEntryChanged;
+	}
+
+	bool open(std::string filepath, const std::map<std::string, Entry>* knownEntries = nullptr) {
+		//індекс береться з каталогу, якщо він узгоджений з файлом, інакше відновлюється читанням журналу
+		std::lock_guard<std::mutex> lock(storeMutex);
+		this->filepath = filepath;
+
+		if (!std::filesystem::exists(filepath)) {
+			std::ofstream newFile(filepath, std::ios::binary);
+			newFile.write(SIGNATURE_OF_FILE, 4);
+			if (!newFile)
+				return false;
+		}
+
+		file.open(filepath, std::ios::in | std::ios::out | std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		char signature[4];
+		file.seekg(0, std::ios::end);
+		sizeOfFile = file.tellg();
+		file.seekg(0);
+		file.read(signature, 4);
+		if (!file || std::string(signature, 4) != std::string(SIGNATURE_OF_FILE, 4)) {
+			file.close();
+			return false;
+		}
+
+		if (knownEntries && areEntriesValid(*knownEntries)) {
+			entries = *knownEntries;
+			sizeOfGarbage = sizeOfFile - SIZE_OF_FILE_HEADER - std::min(getSizeOfLiveRecords(), sizeOfFile - SIZE_OF_FILE_HEADER);
+		}
+		else
+			scanRecords();
+
+		isStopping = false;
+		compactor = std::thread(&PackedStore::runCompactor, this);
+		return true;
+	}
+	void close() {
+		{
+			std::lock_guard<std::mutex> lock(storeMutex);
+			isStopping = true;
+		}
+		compactionCondition.notify_one();
+		if (compactor.joinable())
+			compactor.join();
+
+		std::lock_guard<std::mutex> lock(storeMutex);
+		if (file.is_open())
+			file.close();
+	}
+	bool isOpen() {
+		std::lock_guard<std::mutex> lock(storeMutex);
+		return file.is_open();
+	}
+
+	bool writeData(const std::string& name, std::string_view data) { return append(DATA_RECORD, name, data); }
+	bool writeMetadata(const std::string& name, std::string_view metadata) { return append(METADATA_RECORD, name, metadata); }
+	bool remove(const std::string& name) { return append(DELETION_RECORD, name, ""); }
+	bool readData(const std::string& name, std::string& data) { return read(DATA_RECORD, name, data); }
+	bool readRangeOfData(const std::string& name, unsigned long long offset, size_t length, std::string& data) {
+		//частина тексту сеансу (обрізана до його кінця), щоб великі тексти можна було переглядати шматками
+		std::lock_guard<std::mutex> lock(storeMutex);
+		auto entriesIter = entries.find(name);
+		if (!file.is_open() || entriesIter == entries.end() || !entriesIter->second.data.offset)
+			return false;
+
+		Location location = entriesIter->second.data;
+		data.resize((size_t)std::min<unsigned long long>(length, location.size - std::min(offset, location.size)));
+		file.seekg(location.offset + std::min(offset, location.size));
+		file.read(data.data(), data.size());
+		if (!file) {
+			file.clear();
+			return false;
+		}
+		return true;
+	}
+	bool readMetadata(const std::string& name, std::string& metadata) { return read(METADATA_RECORD, name, metadata); }
+
+	std::map<std::string, Entry> getEntries() {
+		std::lock_guard<std::mutex> lock(storeMutex);
+		return entries;
+	}
+	bool getEntry(const std::string& name, Entry& entry) {
+		std::lock_guard<std::mutex> lock(storeMutex);
+		auto entriesIter = entries.find(name);
+		if (entriesIter == entries.end())
+			return false;
+		entry = entriesIter->second;
+		return true;
+	}
+	unsigned long long getSizeOfFile() {
+		std::lock_guard<std::mutex> lock(storeMutex);
+		return sizeOfFile;
+	}
+	unsigned long long getSizeOfGarbage() {
+		std::lock_guard<std::mutex> lock(storeMutex);
+		return sizeOfGarbage;
+	}
+
+	bool compact() {
+		//живі записи копіюються в новий файл без блокування сховища; записи, дописані за цей час,
+		//переносяться вже під блокуванням, після чого новий файл замінює старий
+		std::unique_lock<std::mutex> lock(storeMutex);
+		if (!file.is_open())
+			return false;
+		std::map<std::string, Entry> entriesToCopy = entries;
+		unsigned long long endOfCopiedPart = sizeOfFile;
+		lock.unlock();
+
+		std::string temporaryFilepath = filepath + ".tmp", payload;
+		std::ifstream source(filepath, std::ios::binary);
+		std::ofstream target(temporaryFilepath, std::ios::binary | std::ios::trunc);
+		std::map<std::string, Entry> newEntries;
+		unsigned long long sizeOfNewFile = SIZE_OF_FILE_HEADER;
+
+		auto copyRecord = [&](KindOfRecord kind, const std::string& name, unsigned long long offsetOfPayload, unsigned long long lengthOfPayload) {
+			payload.resize(lengthOfPayload);
+			source.seekg(offsetOfPayload);
+			source.read(payload.data(), lengthOfPayload);
+			if (!source || !writeRecord(target, kind, name, payload))
+				return false;
+			applyRecord(newEntries, kind, name, sizeOfNewFile + SIZE_OF_RECORD_HEADER + name.size(), lengthOfPayload);
+			sizeOfNewFile += getSizeOfRecord(name, lengthOfPayload);
+			return true;
+		};
+
+		target.write(SIGNATURE_OF_FILE, 4);
+		bool isSuccessful = source.is_open() && (bool)target;
+		for (auto& [name, entry] : entriesToCopy) {
+			if (isSuccessful && entry.data.offset)
+				isSuccessful = copyRecord(DATA_RECORD, name, entry.data.offset, entry.data.size);
+			if (isSuccessful && entry.metadata.offset)
+				isSuccessful = copyRecord(METADATA_RECORD, name, entry.metadata.offset, entry.metadata.size);
+		}
+
+		lock.lock();
+		unsigned long long offset = endOfCopiedPart, lengthOfPayload;
+		KindOfRecord kind;
+		std::string name;
+		while (isSuccessful && offset < sizeOfFile && readRecordHeader(source, sizeOfFile, offset, kind, name, lengthOfPayload)) {
+			isSuccessful = copyRecord(kind, name, offset + SIZE_OF_RECORD_HEADER + name.size(), lengthOfPayload);
+			offset += getSizeOfRecord(name, lengthOfPayload);
+		}
+
+		source.close();
+		target.close();
+		std::error_code errorCode;
+		if (isSuccessful && target) {
+			file.close();
+			std::filesystem::rename(temporaryFilepath, filepath, errorCode);
+			file.open(filepath, std::ios::in | std::ios::out | std::ios::binary);
+		}
+		if (!isSuccessful || !target || errorCode || !file.is_open()) {
+			std::filesystem::remove(temporaryFilepath, errorCode);
+			if (!file.is_open())
+				file.open(filepath, std::ios::in | std::ios::out | std::ios::binary);
+			return false;
+		}
+
+		entries = newEntries;
+		sizeOfFile = sizeOfNewFile;
+		sizeOfGarbage = sizeOfFile - SIZE_OF_FILE_HEADER - getSizeOfLiveRecords();
+		if (onEntryChanged)
+			for (auto& [name, entry] : entries)
+				onEntryChanged(name, entry);
+		return true;
+	}
+};
+
+const char PackedStore::SIGNATURE_OF_FILE[4] = { 'S', 'P', 'A', 'K' },
+PackedStore::SIGNATURE_OF_RECORD[4] = { 'S', 'R', 'E', 'C' };
+const unsigned long long PackedStore::MIN_SIZE_OF_GARBAGE_FOR_COMPACTION = 1024 * 1024;
+const int PackedStore::COMPACTION_RETRY_DELAY_IN_MS = 1000;
+
+class ContentIndex {
+public:
+	struct Match {
+		std::string name; //сеанс, у тексті якого знайдена фраза
+		std::vector<unsigned long long> offsets; //позиції фрази в тексті (перші MAX_COUNT_OF_OFFSETS)
+		bool isComplete; //чи всі позиції вмістились у список
+	};
+
+	static constexpr size_t MIN_LENGTH_OF_PHRASE = 3; //коротші фрази не мають жодної триграми
+	static const size_t MAX_COUNT_OF_OFFSETS; //скільки позицій повертати для одного сеансу
+	static const unsigned long long MAX_SIZE_OF_INDEXED_TEXT; //більші тексти не індексуються, а переглядаються при пошуку
+
+private:
+	static const char SIGNATURE[4]; //підпис файлу індексу
+	static const unsigned int VERSION; //версія формату
+	static const unsigned long long SIZE_OF_STALE_DATA; //розмір, якого не буває в сеансу: запис треба переіндексувати
+
+	struct SessionPostings {
+		unsigned long long sizeOfData; //розмір даних сеансу на момент індексації, щоб помітити застарілий запис
+		bool isIndexed; //false - текст завеликий, його позиції не зберігаються
+		std::string ownPostings; //стиснуті списки, якщо сеанс переіндексовано після завантаження
+		std::vector<std::pair<unsigned int, std::string_view>> postings; //триграма -> стиснутий список позицій
+		//(посилається або на ownPostings, або на відображений у пам'ять файл індексу)
+	};
+
+	std::map<std::string, SessionPostings> sessions; //записи сеансів за іменами
+	std::unordered_map<unsigned int, std::vector<std::string>> sessionsOfTrigrams; //триграма -> сеанси, в яких вона є
+	HANDLE file, mapping; //файл індексу, відображений у пам'ять
+	const char* view; //початок відображення
+	unsigned long long sizeOfView; //розмір відображення
+	std::mutex indexMutex; //індекс оновлюють і головний потік, і сервер
+
+	static unsigned int getTrigram(const char* text) {
+		return (unsigned char)text[0] << 16 | (unsigned char)text[1] << 8 | (unsigned char)text[2];
+	}
+	static void writeVarint(std::string& buffer, unsigned long long value) {
+		//по 7 бітів у байті, старший біт - чи є ще байти
+		while (value >= 0x80) {
+			buffer += (char)(value & 0x7F | 0x80);
+			value >>= 7;
+		}
+		buffer += (char)value;
+	}
+	static bool readVarint(std::string_view& buffer, unsigned long long& value) {
+		value = 0;
+		for (int shift = 0; !buffer.empty() && shift < 64; shift += 7) {
+			unsigned char byte = buffer[0];
+			buffer.remove_prefix(1);
+			value |= (unsigned long long)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+	static std::vector<unsigned long long> decodeOffsets(std::string_view encodedOffsets) {
+		//список - кількість позицій, а далі різниці між сусідніми позиціями
+		std::vector<unsigned long long> offsets;
+		unsigned long long countOfOffsets, delta, offset = 0;
+
+		if (!readVarint(encodedOffsets, countOfOffsets))
+			return offsets;
+		offsets.reserve(countOfOffsets);
+		for (unsigned long long i = 0; i < countOfOffsets && readVarint(encodedOffsets, delta); i++) {
+			offset += delta;
+			offsets.push_back(offset);
+		}
+		return offsets;
+	}
+	static std::string_view findPostings(const SessionPostings& session, unsigned int trigram) {
+		auto postingsIter = std::lower_bound(session.postings.begin(), session.postings.end(), trigram,
+			[](const std::pair<unsigned int, std::string_view>& posting, unsigned int trigram) { return posting.first < trigram; });
+		return postingsIter != session.postings.end() && postingsIter->first == trigram ? postingsIter->second : std::string_view();
+	}
+
+	void addToTrigrams(const std::string& name, const SessionPostings& session) {
+		for (auto& [trigram, encodedOffsets] : session.postings)
+			sessionsOfTrigrams[trigram].push_back(name);
+	}
+	void removeFromTrigrams(const std::string& name) {
+		auto sessionsIter = sessions.find(name);
+		if (sessionsIter == sessions.end())
+			return;
+
+		for (auto& [trigram, encodedOffsets] : sessionsIter->second.postings) {
+			std::vector<std::string>& names = sessionsOfTrigrams[trigram];
+			names.erase(std::find(names.begin(), names.end(), name));
+			if (names.empty())
+				sessionsOfTrigrams.erase(trigram);
+		}
+	}
+	void unmap() {
+		if (view)
+			UnmapViewOfFile(view);
+		if (mapping)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		view = nullptr;
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+		sizeOfView = 0;
+	}
+	bool parseView() {
+		//записи сеансів не копіюються: їхні списки позицій лишаються у відображеному файлі
+		std::string_view buffer(view, sizeOfView);
+		unsigned long long countOfSessions, value;
+
+		if (buffer.size() < 8 || std::string(buffer.data(), 4) != std::string(SIGNATURE, 4) ||
+			*(const unsigned int*)(buffer.data() + 4) != VERSION)
+			return false;
+		buffer.remove_prefix(8);
+
+		if (!readVarint(buffer, countOfSessions))
+			return false;
+		for (unsigned long long i = 0; i < countOfSessions; i++) {
+			unsigned long long lengthOfName, countOfTrigrams, trigram, lengthOfPostings, isIndexed;
+			SessionPostings session;
+
+			if (!readVarint(buffer, lengthOfName) || lengthOfName > buffer.size())
+				return false;
+			std::string name(buffer.substr(0, lengthOfName));
+			buffer.remove_prefix(lengthOfName);
+
+			if (!readVarint(buffer, session.sizeOfData) || !readVarint(buffer, isIndexed) || !readVarint(buffer, countOfTrigrams))
+				return false;
+			session.isIndexed = isIndexed;
+			for (unsigned long long j = 0; j < countOfTrigrams; j++) {
+				if (!readVarint(buffer, trigram) || !readVarint(buffer, lengthOfPostings) || lengthOfPostings > buffer.size())
+					return false;
+				session.postings.push_back({ (unsigned int)trigram, buffer.substr(0, lengthOfPostings) });
+				buffer.remove_prefix(lengthOfPostings);
+			}
+
+			addToTrigrams(name, session);
+			sessions[name] = std::move(session);
+		}
+		return true;
+	}
+
+public:
+	ContentIndex() {
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+		view = nullptr;
+		sizeOfView = 0;
+	}
+	~ContentIndex() { unmap(); }
+
+	bool open(std::string filepath) {
+		std::lock_guard<std::mutex> lock(indexMutex);
+		LARGE_INTEGER sizeOfFile;
+
+		sessions.clear();
+		sessionsOfTrigrams.clear();
+		file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		if (!GetFileSizeEx(file, &sizeOfFile) || sizeOfFile.QuadPart == 0 ||
+			!(mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL)) ||
+			!(view = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))) {
+			unmap();
+			return false;
+		}
+		sizeOfView = sizeOfFile.QuadPart;
+
+		if (!parseView()) {
+			sessions.clear();
+			sessionsOfTrigrams.clear();
+			unmap();
+			return false;
+		}
+		return true;
+	}
+	bool save(std::string filepath) {
+		//індекс пишеться в тимчасовий файл і лише потім замінює старий, який до цього лишається відображеним
+		std::lock_guard<std::mutex> lock(indexMutex);
+		std::string temporaryFilepath = filepath + ".tmp", header;
+		std::ofstream target(temporaryFilepath, std::ios::binary | std::ios::trunc);
+
+		header.append(SIGNATURE, 4);
+		header.append((const char*)&VERSION, sizeof(VERSION));
+		writeVarint(header, sessions.size());
+		target << header;
+
+		for (auto& [name, session] : sessions) {
+			std::string record;
+			writeVarint(record, name.size());
+			record += name;
+			writeVarint(record, session.sizeOfData);
+			writeVarint(record, session.isIndexed);
+			writeVarint(record, session.postings.size());
+			for (auto& [trigram, encodedOffsets] : session.postings) {
+				writeVarint(record, trigram);
+				writeVarint(record, encodedOffsets.size());
+				record += encodedOffsets;
+			}
+			target << record;
+		}
+		target.close();
+		if (!target)
+			return false;
+
+		//після заміни файлу списки позицій мають жити в пам'яті, бо відображення закривається
+		for (auto& [name, session] : sessions)
+			if (session.ownPostings.empty() && !session.postings.empty()) {
+				for (auto& [trigram, encodedOffsets] : session.postings)
+					session.ownPostings += encodedOffsets;
+				size_t offset = 0;
+				for (auto& [trigram, encodedOffsets] : session.postings) {
+					size_t length = encodedOffsets.size();
+					encodedOffsets = std::string_view(session.ownPostings).substr(offset, length);
+					offset += length;
+				}
+			}
+		unmap();
+
+		std::error_code errorCode;
+		std::filesystem::rename(temporaryFilepath, filepath, errorCode);
+		return !errorCode;
+	}
+
+	void update(const std::string& name, std::string_view text, unsigned long long sizeOfData) {
+		//сеанс переіндексовується повністю: вартість пропорційна лише його тексту
+		std::map<unsigned int, std::vector<unsigned long long>> offsetsOfTrigrams;
+		SessionPostings session;
+		session.sizeOfData = sizeOfData;
+		session.isIndexed = sizeOfData <= MAX_SIZE_OF_INDEXED_TEXT; //тексти завеликих сеансів не потрібні, їх можна не читати
+
+		if (session.isIndexed)
+			for (size_t i = 0; i + MIN_LENGTH_OF_PHRASE <= text.size(); i++)
+				offsetsOfTrigrams[getTrigram(text.data() + i)].push_back(i);
+
+		std::vector<std::pair<unsigned int, size_t>> lengthsOfPostings; //списки лежать в ownPostings один за одним
+		for (auto& [trigram, offsets] : offsetsOfTrigrams) {
+			size_t start = session.ownPostings.size();
+			unsigned long long previousOffset = 0;
+			writeVarint(session.ownPostings, offsets.size());
+			for (unsigned long long offset : offsets) {
+				writeVarint(session.ownPostings, offset - previousOffset);
+				previousOffset = offset;
+			}
+			lengthsOfPostings.push_back({ trigram, session.ownPostings.size() - start });
+		}
+
+		std::lock_guard<std::mutex> lock(indexMutex);
+		removeFromTrigrams(name);
+
+		//посилання на списки створюються вже на рядок усередині словника, який більше не переміщується
+		SessionPostings& storedSession = sessions[name];
+		storedSession = std::move(session);
+		size_t offset = 0;
+		for (auto& [trigram, length] : lengthsOfPostings) {
+			storedSession.postings.push_back({ trigram, std::string_view(storedSession.ownPostings).substr(offset, length) });
+			offset += length;
+		}
+		addToTrigrams(name, storedSession);
+	}
+	void remove(const std::string& name) {
+		std::lock_guard<std::mutex> lock(indexMutex);
+		removeFromTrigrams(name);
+		sessions.erase(name);
+	}
+	void retainOnly(const std::vector<std::string>& names) {
+		//прибирає записи сеансів, яких вже немає (наприклад, видалених без оновлення індексу)
+		std::lock_guard<std::mutex> lock(indexMutex);
+		std::map<std::string, bool> isNameAlive;
+		for (const std::string& name : names)
+			isNameAlive[name] = true;
+
+		for (auto sessionsIter = sessions.begin(); sessionsIter != sessions.end();)
+			if (!isNameAlive.count(sessionsIter->first)) {
+				removeFromTrigrams(sessionsIter->first);
+				sessionsIter = sessions.erase(sessionsIter);
+			}
+			else
+				sessionsIter++;
+	}
+	void markAsStale(const std::string& name) {
+		//запис переіндексовується лише при наступному пошуку, тож редагування не платить за повну індексацію сеансу
+		std::lock_guard<std::mutex> lock(indexMutex);
+		auto sessionsIter = sessions.find(name);
+		if (sessionsIter != sessions.end())
+			sessionsIter->second.sizeOfData = SIZE_OF_STALE_DATA;
+	}
+	bool isUpToDate(const std::string& name, unsigned long long sizeOfData) {
+		std::lock_guard<std::mutex> lock(indexMutex);
+		auto sessionsIter = sessions.find(name);
+		return sessionsIter != sessions.end() && sessionsIter->second.sizeOfData == sizeOfData;
+	}
+	std::vector<std::string> getNotIndexedSessions() {
+		std::lock_guard<std::mutex> lock(indexMutex);
+		std::vector<std::string> names;
+		for (auto& [name, session] : sessions)
+			if (!session.isIndexed)
+				names.push_back(name);
+		return names;
+	}
+
+	std::vector<Match> find(const std::string& phrase) {
+		//позиція підходить, якщо з неї починається перша триграма фрази, а кожна наступна (з кроком 3 і остання)
+		//стоїть на своєму зсуві - разом вони покривають усі символи фрази
+		std::lock_guard<std::mutex> lock(indexMutex);
+		std::vector<Match> matches;
+		if (phrase.size() < MIN_LENGTH_OF_PHRASE)
+			return matches;
+
+		std::vector<size_t> shiftsOfTrigrams;
+		for (size_t shift = 0; shift + MIN_LENGTH_OF_PHRASE <= phrase.size(); shift += MIN_LENGTH_OF_PHRASE)
+			shiftsOfTrigrams.push_back(shift);
+		if (shiftsOfTrigrams.back() != phrase.size() - MIN_LENGTH_OF_PHRASE)
+			shiftsOfTrigrams.push_back(phrase.size() - MIN_LENGTH_OF_PHRASE);
+
+		//кандидати - сеанси з найрідшою триграмою фрази
+		std::vector<std::string>* candidates = nullptr;
+		for (size_t shift : shiftsOfTrigrams) {
+			auto trigramsIter = sessionsOfTrigrams.find(getTrigram(phrase.data() + shift));
+			if (trigramsIter == sessionsOfTrigrams.end())
+				return matches;
+			if (!candidates || trigramsIter->second.size() < candidates->size())
+				candidates = &trigramsIter->second;
+		}
+
+		for (const std::string& name : *candidates) {
+			const SessionPostings& session = sessions[name];
+			std::vector<unsigned long long> offsets = decodeOffsets(findPostings(session, getTrigram(phrase.data())));
+
+			for (size_t i = 1; i < shiftsOfTrigrams.size() && !offsets.empty(); i++) {
+				std::vector<unsigned long long> nextOffsets = decodeOffsets(findPostings(session, getTrigram(phrase.data() + shiftsOfTrigrams[i])));
+				std::vector<unsigned long long> remainingOffsets;
+				for (unsigned long long offset : offsets)
+					if (std::binary_search(nextOffsets.begin(), nextOffsets.end(), offset + shiftsOfTrigrams[i]))
+						remainingOffsets.push_back(offset);
+				offsets.swap(remainingOffsets);
+			}
+
+			if (offsets.empty())
+				continue;
+			Match match = { name, offsets, offsets.size() <= MAX_COUNT_OF_OFFSETS };
+			if (!match.isComplete)
+				match.offsets.resize(MAX_COUNT_OF_OFFSETS);
+			matches.push_back(match);
+		}
+		return matches;
+	}
+};
+
+const size_t ContentIndex::MAX_COUNT_OF_OFFSETS = 10;
+const unsigned long long ContentIndex::MAX_SIZE_OF_INDEXED_TEXT = 16 * 1024 * 1024;
+const char ContentIndex::SIGNATURE[4] = { 'S', 'F', 'T', 'I' };
+const unsigned int ContentIndex::VERSION = 1;
+const unsigned long long ContentIndex::SIZE_OF_STALE_DATA = ULLONG_MAX;
+
+class TextDiff {
+public:
+	struct Hunk {
+		size_t startInFirst, lengthInFirst; //яка ділянка першого тексту прибрана (у байтах)
+		size_t startInSecond, lengthInSecond; //яка ділянка другого тексту вставлена замість неї
+	};
+
+	static const size_t MAX_SIZE_FOR_BYTES_DIFF; //до якого розміру відмінної частини тексти порівнюються побайтово, а не по рядках
+	static const long long MAX_COUNT_OF_DIFFERENCES; //після скількох кроків пошуку ділянка вважається повністю заміненою
+	static const size_t MAX_SIZE_OF_PRINTED_FRAGMENT; //скільки байтів кожного фрагмента показувати
+
+private:
+	struct Snake {
+		size_t startInFirst, startInSecond, endInFirst, endInSecond; //діагональ спільних елементів посередині найкоротшого шляху
+		long long countOfDifferences; //довжина найкоротшого шляху (кількість вилучень та вставок)
+	};
+
+	static size_t findCommonPrefix(const char* first, const char* second, size_t size) {
+		size_t i = 0;
+		for (; i + 16 <= size; i += 16) {
+			int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(first + i)), _mm_loadu_si128((const __m128i*)(second + i))));
+			if (mask != 0xFFFF)
+				return i + std::countr_one((unsigned int)mask);
+		}
+		while (i < size && first[i] == second[i])
+			i++;
+		return i;
+	}
+	static size_t findCommonSuffix(const char* first, const char* second, size_t size) {
+		//first та second вказують на кінці текстів
+		size_t i = 0;
+		for (; i + 16 <= size; i += 16) {
+			int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(first - i - 16)), _mm_loadu_si128((const __m128i*)(second - i - 16))));
+			if (mask != 0xFFFF)
+				return i + std::countl_one((unsigned int)mask << 16);
+		}
+		while (i < size && first[-(long long)i - 1] == second[-(long long)i - 1])
+			i++;
+		return i;
+	}
+	static size_t findCommonPrefix(const unsigned int* first, const unsigned int* second, size_t size) {
+		size_t i = 0;
+		for (; i + 4 <= size; i += 4) {
+			int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(first + i)), _mm_loadu_si128((const __m128i*)(second + i))));
+			if (mask != 0xFFFF)
+				return i + std::countr_one((unsigned int)mask) / 4;
+		}
+		while (i < size && first[i] == second[i])
+			i++;
+		return i;
+	}
+	static size_t findCommonSuffix(const unsigned int* first, const unsigned int* second, size_t size) {
+		size_t i = 0;
+		while (i < size && first[-(long long)i - 1] == second[-(long long)i - 1])
+			i++;
+		return i;
+	}
+
+	template <typename Element>
+	static bool findMiddleSnake(const Element* first, size_t sizeOfFirst, const Element* second, size_t sizeOfSecond,
+		std::vector<long long>& forward, std::vector<long long>& backward, Snake& snake) {
+		//лінійний за пам'яттю варіант алгоритму Маєрса: пошук одночасно з початку й з кінця до зустрічі посередині;
+		//false - шлях довший за MAX_COUNT_OF_DIFFERENCES
+		long long n = sizeOfFirst, m = sizeOfSecond, delta = n - m, maxD = (n + m + 1) / 2;
+		long long limit = std::min(maxD, MAX_COUNT_OF_DIFFERENCES), offset = limit + 1;
+		bool isDeltaOdd = delta % 2 != 0;
+		forward.assign(2 * offset + 1, 0);
+		backward.assign(2 * offset + 1, 0);
+
+		for (long long d = 0; d <= limit; d++) {
+			for (long long k = -d; k <= d; k += 2) {
+				long long x = k == -d || (k != d && forward[offset + k - 1] < forward[offset + k + 1]) ?
+					forward[offset + k + 1] : forward[offset + k - 1] + 1;
+				long long y = x - k, startX = x, startY = y;
+				while (x < n && y < m && first[x] == second[y]) {
+					x++;
+					y++;
+				}
+				forward[offset + k] = x;
+				if (isDeltaOdd && delta - k >= -(d - 1) && delta - k <= d - 1 && x + backward[offset + delta - k] >= n) {
+					snake = { (size_t)startX, (size_t)startY, (size_t)x, (size_t)y, 2 * d - 1 };
+					return true;
+				}
+			}
+			for (long long k = -d; k <= d; k += 2) {
+				long long x = k == -d || (k != d && backward[offset + k - 1] < backward[offset + k + 1]) ?
+					backward[offset + k + 1] : backward[offset + k - 1] + 1;
+				long long y = x - k, startX = x, startY = y;
+				while (x < n && y < m && first[n - x - 1] == second[m - y - 1]) {
+					x++;
+					y++;
+				}
+				backward[offset + k] = x;
+				if (!isDeltaOdd && delta - k >= -d && delta - k <= d && x + forward[offset + delta - k] >= n) {
+					snake = { (size_t)(n - x), (size_t)(m - y), (size_t)(n - startX), (size_t)(m - startY), 2 * d };
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	static void addHunk(std::vector<Hunk>& hunks, Hunk hunk) {
+		if (hunk.lengthInFirst == 0 && hunk.lengthInSecond == 0)
+			return;
+		if (!hunks.empty() && hunks.back().startInFirst + hunks.back().lengthInFirst == hunk.startInFirst &&
+			hunks.back().startInSecond + hunks.back().lengthInSecond == hunk.startInSecond) {
+			hunks.back().lengthInFirst += hunk.lengthInFirst;
+			hunks.back().lengthInSecond += hunk.lengthInSecond;
+			return;
+		}
+		hunks.push_back(hunk);
+	}
+
+	template <typename Element>
+	static void compareRanges(const Element* first, size_t sizeOfFirst, size_t startInFirst, const Element* second, size_t sizeOfSecond,
+		size_t startInSecond, std::vector<long long>& forward, std::vector<long long>& backward, std::vector<Hunk>& hunks) {
+		size_t sizeOfPrefix = findCommonPrefix(first, second, std::min(sizeOfFirst, sizeOfSecond));
+		first += sizeOfPrefix;
+		second += sizeOfPrefix;
+		sizeOfFirst -= sizeOfPrefix;
+		sizeOfSecond -= sizeOfPrefix;
+		startInFirst += sizeOfPrefix;
+		startInSecond += sizeOfPrefix;
+		size_t sizeOfSuffix = findCommonSuffix(first + sizeOfFirst, second + sizeOfSecond, std::min(sizeOfFirst, sizeOfSecond));
+		sizeOfFirst -= sizeOfSuffix;
+		sizeOfSecond -= sizeOfSuffix;
+
+		Snake snake;
+		if (sizeOfFirst == 0 || sizeOfSecond == 0 ||
+			!findMiddleSnake(first, sizeOfFirst, second, sizeOfSecond, forward, backward, snake) || snake.countOfDifferences <= 1) {
+			addHunk(hunks, { startInFirst, sizeOfFirst, startInSecond, sizeOfSecond });
+			return;
+		}
+
+		compareRanges(first, snake.startInFirst, startInFirst, second, snake.startInSecond, startInSecond, forward, backward, hunks);
+		compareRanges(first + snake.endInFirst, sizeOfFirst - snake.endInFirst, startInFirst + snake.endInFirst,
+			second + snake.endInSecond, sizeOfSecond - snake.endInSecond, startInSecond + snake.endInSecond, forward, backward, hunks);
+	}
+
+	static std::vector<size_t> splitIntoLines(std::string_view text) {
+		//зміщення початків рядків; останній елемент - кінець тексту
+		std::vector<size_t> startsOfLines = { 0 };
+		for (size_t position = text.find('\n'); position != std::string_view::npos; position = text.find('\n', position + 1))
+			if (position + 1 < text.size())
+				startsOfLines.push_back(position + 1);
+		if (!text.empty())
+			startsOfLines.push_back(text.size());
+		return startsOfLines;
+	}
+	static void compareLines(std::string_view first, std::string_view second, size_t startInFirst, size_t startInSecond, std::vector<Hunk>& hunks) {
+		//рядки замінюються номерами за їхнім хешем (відкрита адресація, рядки порівнюються лише при збігу хешів),
+		//тож алгоритм Маєрса порівнює числа, а не рядки
+		std::vector<size_t> linesOfFirst = splitIntoLines(first), linesOfSecond = splitIntoLines(second);
+		std::vector<unsigned int> idsOfFirst, idsOfSecond;
+		std::vector<std::string_view> uniqueLines;
+		std::vector<std::pair<size_t, unsigned int>> tableOfIds(std::bit_ceil(2 * (linesOfFirst.size() + linesOfSecond.size())), { 0, UINT_MAX });
+		size_t mask = tableOfIds.size() - 1;
+
+		for (int i = 0; i < 2; i++) {
+			std::string_view text = i == 0 ? first : second;
+			std::vector<size_t>& lines = i == 0 ? linesOfFirst : linesOfSecond;
+			std::vector<unsigned int>& ids = i == 0 ? idsOfFirst : idsOfSecond;
+			ids.reserve(lines.size());
+
+			for (size_t j = 0; j + 1 < lines.size(); j++) {
+				std::string_view line = text.substr(lines[j], lines[j + 1] - lines[j]);
+				size_t hash = std::hash<std::string_view>()(line), index = hash & mask;
+				while (tableOfIds[index].second != UINT_MAX && (tableOfIds[index].first != hash || uniqueLines[tableOfIds[index].second] != line))
+					index = (index + 1) & mask;
+				if (tableOfIds[index].second == UINT_MAX) {
+					tableOfIds[index] = { hash, (unsigned int)uniqueLines.size() };
+					uniqueLines.push_back(line);
+				}
+				ids.push_back(tableOfIds[index].second);
+			}
+		}
+
+		std::vector<Hunk> hunksOfLines;
+		std::vector<long long> forward, backward;
+		compareRanges(idsOfFirst.data(), idsOfFirst.size(), 0, idsOfSecond.data(), idsOfSecond.size(), 0, forward, backward, hunksOfLines);
+
+		for (Hunk& hunk : hunksOfLines)
+			hunks.push_back({ startInFirst + linesOfFirst[hunk.startInFirst], linesOfFirst[hunk.startInFirst + hunk.lengthInFirst] - linesOfFirst[hunk.startInFirst],
+				startInSecond + linesOfSecond[hunk.startInSecond], linesOfSecond[hunk.startInSecond + hunk.lengthInSecond] - linesOfSecond[hunk.startInSecond] });
+	}
+	static void alignToCharacters(std::string_view first, std::string_view second, std::vector<Hunk>& hunks) {
+		//у режимі UTF-8 межі ділянок зсуваються до меж символів, щоб не розрізати багатобайтові символи
+		std::vector<Hunk> alignedHunks;
+		for (Hunk hunk : hunks) {
+			while (hunk.startInFirst > 0 && hunk.startInSecond > 0 && (first[hunk.startInFirst] & 0xC0) == 0x80) {
+				hunk.startInFirst--;
+				hunk.startInSecond--;
+				hunk.lengthInFirst++;
+				hunk.lengthInSecond++;
+			}
+			while (hunk.startInFirst + hunk.lengthInFirst < first.size() && (first[hunk.startInFirst + hunk.lengthInFirst] & 0xC0) == 0x80) {
+				hunk.lengthInFirst++;
+				hunk.lengthInSecond++;
+			}
+			if (!alignedHunks.empty() && alignedHunks.back().startInFirst + alignedHunks.back().lengthInFirst >= hunk.startInFirst) {
+				Hunk& lastHunk = alignedHunks.back();
+				lastHunk.lengthInFirst = hunk.startInFirst + hunk.lengthInFirst - lastHunk.startInFirst;
+				lastHunk.lengthInSecond = hunk.startInSecond + hunk.lengthInSecond - lastHunk.startInSecond;
+			}
+			else
+				alignedHunks.push_back(hunk);
+		}
+		hunks = alignedHunks;
+	}
+
+public:
+	static std::vector<Hunk> compare(std::string_view first, std::string_view second) {
+		//спільні початок і кінець відкидаються порівнянням по 16 байтів; невелика відмінна частина порівнюється побайтово,
+		//велика - по рядках
+		ProfilerScope profilerScope("TextDiff::compare");
+		std::vector<Hunk> hunks;
+		size_t sizeOfPrefix = findCommonPrefix(first.data(), second.data(), std::min(first.size(), second.size()));
+		size_t sizeOfSuffix = findCommonSuffix(first.data() + first.size(), second.data() + second.size(),
+			std::min(first.size(), second.size()) - sizeOfPrefix);
+		std::string_view middleOfFirst = first.substr(sizeOfPrefix, first.size() - sizeOfPrefix - sizeOfSuffix),
+			middleOfSecond = second.substr(sizeOfPrefix, second.size() - sizeOfPrefix - sizeOfSuffix);
+
+		if (middleOfFirst.size() + middleOfSecond.size() <= MAX_SIZE_FOR_BYTES_DIFF) {
+			std::vector<long long> forward, backward;
+			compareRanges(middleOfFirst.data(), middleOfFirst.size(), sizeOfPrefix, middleOfSecond.data(), middleOfSecond.size(), sizeOfPrefix,
+				forward, backward, hunks);
+		}
+		else {
+			//порівняння по рядках починається з початку рядка, в якому знайдена перша відмінність, і закінчується кінцем рядка,
+			//в якому знайдена остання
+			size_t startOfLine = sizeOfPrefix == 0 ? 0 : first.rfind('\n', sizeOfPrefix - 1) + 1;
+			size_t endOfMiddle = first.size() - sizeOfSuffix, sizeOfExtension = 0;
+			if (endOfMiddle > 0 && first[endOfMiddle - 1] != '\n') {
+				size_t endOfLine = first.find('\n', endOfMiddle);
+				sizeOfExtension = endOfLine == std::string_view::npos ? sizeOfSuffix : endOfLine + 1 - endOfMiddle;
+			}
+			sizeOfSuffix -= sizeOfExtension;
+			compareLines(first.substr(startOfLine, first.size() - startOfLine - sizeOfSuffix),
+				second.substr(startOfLine, second.size() - startOfLine - sizeOfSuffix), startOfLine, startOfLine, hunks);
+		}
+
+		if (Editor::isUtf8Mode())
+			alignToCharacters(first, second, hunks);
+		return hunks;
+	}
+
+	static void print(std::string_view first, std::string_view second, const std::vector<Hunk>& hunks) {
+		auto printFragment = [](char sign, std::string_view fragment) {
+			if (fragment.empty())
+				return;
+			std::cout << sign << "\"" << fragment.substr(0, MAX_SIZE_OF_PRINTED_FRAGMENT) << "\"";
+			if (fragment.size() > MAX_SIZE_OF_PRINTED_FRAGMENT)
+				std::cout << " ... (" << fragment.size() << " байт)";
+			std::cout << "\n";
+		};
+
+		for (const Hunk& hunk : hunks) {
+			std::cout << "@@ -" << hunk.startInFirst << "," << hunk.lengthInFirst << " +" << hunk.startInSecond << "," << hunk.lengthInSecond << " @@\n";
+			printFragment('-', first.substr(hunk.startInFirst, hunk.lengthInFirst));
+			printFragment('+', second.substr(hunk.startInSecond, hunk.lengthInSecond));
+		}
+	}
+};
+
+const size_t TextDiff::MAX_SIZE_FOR_BYTES_DIFF = 64 * 1024;
+const long long TextDiff::MAX_COUNT_OF_DIFFERENCES = 4096;
+const size_t TextDiff::MAX_SIZE_OF_PRINTED_FRAGMENT = 200;
+
+class FilesManager {
+public:
+	struct LoadingStatistics {
+		int countOfSessions; //скільки сеансів завантажено
+		int countOfThreads; //скільки потоків розбирали метадані
+		long long durationInMs; //тривалість завантаження
+	};
+	struct ExternalChange {
+		int startPosition, endPosition; //ділянка відкритого тексту [початок, кінець), яку замінює зміна
+		std::string text; //текст з файлу, який стає на місце ділянки
+		bool isAppend; //чи дочитаний лише дописаний у кінець файлу хвіст
+		bool isRejected; //чи новий текст не в UTF-8 (у режимі UTF-8), тоді зміна не застосовується
+	};
+
+private:
+	friend class Editor;
+
+	static const std::string METADATA_DIRECTORY, //директорія папки метаданих
+		DATA_DIRECTORY; //директорія, де безпосередньо збергаються текстові файли, які ми редагуємо в програмі
+	static const std::string CATALOG_FILEPATH, //файл каталогу сеансів
+		PACKED_STORE_FILEPATH, //файл сховища, в якому всі сеанси лежать одним журналом
+		PACKED_CATALOG_FILEPATH, //каталог сеансів сховища
+		CONTENT_INDEX_FILEPATH; //повнотекстовий індекс вмісту сеансів
+	static const int MIN_COUNT_OF_FILES_FOR_PROGRESS; //з якої кількості файлів метаданих показувати прогрес завантаження
+	static const size_t SIZE_OF_SCAN_CHUNK; //якими шматками переглядаються тексти, завеликі для індексу
+	static SessionsCatalog catalog; //відображений у пам'ять каталог сеансів
+	static PackedStore packedStore; //сховище для режиму одного файлу
+	static bool isPackedStorageEnabled; //чи зберігаються сеанси в одному файлі замість пар файлів у Data та Metadata
+	static ContentIndex contentIndex; //в яких сеансах і на яких позиціях зустрічаються триграми тексту
+
+	static LoadingStatistics lastLoadingStatistics; //звіт про останнє завантаження сеансів
+
+	struct DataState {
+		unsigned long long sizeOfFile; //розмір файлу в байтах
+		std::filesystem::file_time_type lastWriteTime; //час останнього запису файлу
+		size_t hashOfTail; //хеш останньої частини файлу (до SIZE_OF_TAIL_CHUNK байтів)
+		char lastByte; //останній байт файлу (0 - файл порожній)
+	};
+
+	static const size_t SIZE_OF_TAIL_CHUNK; //скільки байтів з кінця файлу хешується, щоб впізнати дописування
+	static std::unordered_map<std::string, DataState> statesOfData; //файли сеансів, якими їх востаннє прочитала або записала програма
+	static std::mutex statesOfDataMutex; //захищає стани файлів, бо записують їх і потоки сервера
+
+	static std::string readRangeOfFile(std::string filepath, unsigned long long offset, size_t length) {
+		std::string range(length, '\0');
+		std::ifstream file(filepath, std::ios::binary);
+		file.seekg(offset);
+		file.read(range.data(), length);
+		range.resize(file ? length : (size_t)file.gcount());
+		return range;
+	}
+	static bool readDataState(std::string filename, DataState& state) {
+		std::error_code errorCode;
+		std::string filepath = DATA_DIRECTORY + filename;
+		state.sizeOfFile = std::filesystem::file_size(filepath, errorCode);
+		if (!errorCode)
+			state.lastWriteTime = std::filesystem::last_write_time(filepath, errorCode);
+		if (errorCode)
+			return false;
+
+		size_t sizeOfTail = std::min<unsigned long long>(state.sizeOfFile, SIZE_OF_TAIL_CHUNK);
+		std::string tail = readRangeOfFile(filepath, state.sizeOfFile - sizeOfTail, sizeOfTail);
+		state.hashOfTail = std::hash<std::string>()(tail);
+		state.lastByte = tail.empty() ? 0 : tail.back();
+		return true;
+	}
+	static std::string convertLineEndings(std::string data) {
+		//так само, як читання файлу в текстовому режимі: CRLF стає LF
+		size_t sizeOfResult = 0;
+		for (size_t i = 0; i < data.size(); i++)
+			if (data[i] != '\r' || i + 1 == data.size() || data[i + 1] != '\n')
+				data[sizeOfResult++] = data[i];
+		data.resize(sizeOfResult);
+		return data;
+	}
+
+	static std::stack<std::string> getFilepathsForMetadata(std::string directory) {
+		std::stack<std::string> filesFromMetadataDirectory;
+
+		auto iteratorOnFiles = std::filesystem::directory_iterator(directory);
+
+		for (const auto& entry : iteratorOnFiles)
+				filesFromMetadataDirectory.push(entry.path().string());
+
+		return filesFromMetadataDirectory;
+	}
+	static std::string readDataByDelimiter(std::istream* ifs_session, std::string delimiter) {
+		std::string line, text;
+		int counterOfLines = 0;
+
+		getline(*ifs_session, line);
+		while (getline(*ifs_session, line)) {
+			if (line == delimiter)
+				break;
+			counterOfLines++;
+			if (counterOfLines > 1)
+				line = "\n" + line;
+			text += line;
+		}
+
+		return text;
+	}
+
+	static void deleteMetadataForDeletedSessions(SessionsHistory* sessionsHistory, std::string directory) {
+		if (!std::filesystem::exists(directory))
+			return;
+
+		std::stack<std::string> filesFromMetadataDirectory = getFilepathsForMetadata(directory);
+		std::string sessionFilepath;
+		bool isPartOfRealtimeSessions;
+
+		for (int i = 0; i < filesFromMetadataDirectory.size(); i++)
+		{
+			isPartOfRealtimeSessions = false;
+			for (int j = 0; j < sessionsHistory->size(); j++)
+			{
+				sessionFilepath = directory + sessionsHistory->getSessionByIndex(j)->getName();
+				if (filesFromMetadataDirectory._Get_container()[i] == sessionFilepath)
+					isPartOfRealtimeSessions = true;
+			}
+
+			if (!isPartOfRealtimeSessions)
+				remove(filesFromMetadataDirectory._Get_container()[i].c_str());
+		}
+		
+	}
+
+	static bool writeSessionsMetadata(SessionsHistory* sessionsHistory) {
+		ProfilerScope profilerScope("FilesManager::writeSessionsMetadata");
+		//з каталогом метадані видалених сеансів видаляються одразу, тому директорію сканувати не потрібно
+		if (!catalog.isOpen() && !isPackedStorageEnabled)
+			deleteMetadataForDeletedSessions(sessionsHistory, METADATA_DIRECTORY);
+
+		if (!std::filesystem::exists(METADATA_DIRECTORY) && !isPackedStorageEnabled)
+			std::filesystem::create_directories(METADATA_DIRECTORY);
+
+		bool areAllWritten = true;
+		std::vector<std::string> namesOfSessions;
+		for (int i = 0; i < sessionsHistory->size(); i++) {
+			areAllWritten = writeSessionMetadata(sessionsHistory, i) && areAllWritten;
+			namesOfSessions.push_back(sessionsHistory->getSessionByIndex(i)->getName());
+		}
+
+		catalog.flush();
+		contentIndex.retainOnly(namesOfSessions);
+		contentIndex.save(CONTENT_INDEX_FILEPATH);
+		return areAllWritten;
+	}
+	static bool writeSessionMetadata(SessionsHistory* sessionsHistory, int index) {
+		Session* session = sessionsHistory->getSessionByIndex(index);
+
+		//історія, яку не відкривали, на диску не змінилась
+		if (!session->wasHistoryLoaded())
+			return true;
+
+		//історію може саме стискати фоновий потік
+		std::lock_guard<std::mutex> writerLock(session->getWriterMutex());
+
+		//метадані спершу збираються в пам'яті: якщо витіснений знімок не прочитається, попередні метадані на диску лишаться цілими
+		std::ostringstream ofs_session;
+		try {
+			ofs_session << session->sizeOfCommandsHistory() << std::endl;
+			ofs_session << session->getCurIndexInCommHistory() << std::endl;
+
+			for (int j = 0; j < session->sizeOfCommandsHistory(); j++)
+				writeCommandMetadata(&ofs_session, session, j);
+		}
+		catch (const std::ios_base::failure&) {
+			return false;
+		}
+
+		catalog.updateHistory(session->getName(), session->sizeOfCommandsHistory(), session->getCurIndexInCommHistory(), ofs_session.tellp());
+		if (isPackedStorageEnabled)
+			packedStore.writeMetadata(session->getName(), ofs_session.str());
+		else {
+			std::ofstream metadataFile(METADATA_DIRECTORY + session->getName());
+			metadataFile << ofs_session.str();
+		}
+		return true;
+	}
+	static void writeCommandMetadata(std::ostream* ofs_session, Session* session, int index) {
+		std::string typeOfCommand, nameOfCommandClass, delimiter = "---\n";
+		Command* command = session->getCommandByIndex(index);
+
+		nameOfCommandClass = std::string(typeid(*command).name());
+
+		if (index == 0 && session->hasBaseSnapshotInHistory())
+			typeOfCommand = "BaseCommand";
+		else if (nameOfCommandClass == "class PasteCommand")
+			typeOfCommand = "PasteCommand";
+		else if (nameOfCommandClass == "class CutCommand")
+			typeOfCommand = "CutCommand";
+		else if (nameOfCommandClass == "class BatchCommand")
+			typeOfCommand = "BatchCommand";
+		else if (nameOfCommandClass == "class SortLinesCommand")
+			typeOfCommand = "SortLinesCommand";
+		else if (nameOfCommandClass == "class UniqueLinesCommand")
+			typeOfCommand = "UniqueLinesCommand";
+		else if (nameOfCommandClass == "class FilterLinesCommand")
+			typeOfCommand = "FilterLinesCommand";
+		else if (nameOfCommandClass == "class TransformCommand")
+			typeOfCommand = "TransformCommand";
+		else if (nameOfCommandClass == "class ExternalChangeCommand")
+			typeOfCommand = "ExternalChangeCommand";
+		else
+			typeOfCommand = "DeleteCommand";
+
+		*ofs_session << typeOfCommand << std::endl << delimiter;
+
+		if (typeOfCommand == "TransformCommand") {
+			//записуються ім'я перетворення з режимом, у якому воно виконувалось, та знімок, якщо він вже є
+			//(у першої команди історії та в команд, які вже не останні); знімок останньої відтворюється при читанні
+			TransformCommand* transformCommand = (TransformCommand*)command;
+			*ofs_session << TextTransforms::NAMES[transformCommand->getTransform()] <<
+				(transformCommand->wasExecutedInUtf8Mode() ? " utf8" : " bytes") << std::endl;
+			if ((index == 0 || transformCommand->hasSnapshotOfText()) && transformCommand->getTextToProcess() != "")
+				*ofs_session << transformCommand->getTextToProcess() << std::endl;
+			*ofs_session << delimiter;
+			return;
+		}
+
+		if (command->getTextToProcess() != "")
+			*ofs_session << command->getTextToProcess() << std::endl;
+
+		*ofs_session << delimiter;
+	}
+
+	static void readSessionsMetadata(Editor* editor) {
+		ProfilerScope profilerScope("FilesManager::readSessionsMetadata");
+		contentIndex.open(CONTENT_INDEX_FILEPATH);
+		if (isPackedStorageEnabled) {
+			readSessionsFromPackedStore(editor);
+			return;
+		}
+		if (readSessionsFromCatalog(editor))
+			return;
+
+		//каталогу немає або він пошкоджений: сеанси шукаються в директорії метаданих, а каталог будується заново
+		scanSessionsMetadata(editor);
+		if (!catalog.create(CATALOG_FILEPATH))
+			return;
+
+		for (int i = 0; i < editor->getSessionsHistory()->size(); i++) {
+			Session* session = editor->getSessionsHistory()->getSessionByIndex(i);
+			std::error_code errorCode;
+			auto dataSize = std::filesystem::file_size(DATA_DIRECTORY + session->getName(), errorCode);
+			catalog.addRecord(session->getName(), errorCode ? 0 : dataSize, session->sizeOfCommandsHistory(), session->getCurIndexInCommHistory(),
+				session->getModificationTime());
+		}
+		catalog.flush();
+	}
+	static void readSessionsFromPackedStore(Editor* editor) {
+		//зміщення записів у сховищі зберігаються в каталозі, тому журнал читається лише тоді, коли каталогу немає
+		auto start = std::chrono::steady_clock::now();
+		bool isCatalogOpen = catalog.open(PACKED_CATALOG_FILEPATH);
+		std::map<std::string, PackedStore::Entry> knownEntries;
+
+		if (isCatalogOpen)
+			for (SessionsCatalog::Record& record : catalog.getRecordsInOrder())
+				knownEntries[record.name] = { { record.dataOffset, record.dataSize }, { record.metadataOffset, record.metadataSize } };
+
+		packedStore.setOnEntryChanged([](const std::string& name, const PackedStore::Entry& entry) {
+			catalog.updateOffsets(name, entry.data.offset, entry.data.size, entry.metadata.offset, entry.metadata.size);
+			});
+		if (!packedStore.open(PACKED_STORE_FILEPATH, isCatalogOpen ? &knownEntries : nullptr))
+			return;
+
+		if (!isCatalogOpen) {
+			if (!catalog.create(PACKED_CATALOG_FILEPATH))
+				return;
+			for (auto& [name, entry] : packedStore.getEntries()) {
+				catalog.addRecord(name);
+				catalog.updateOffsets(name, entry.data.offset, entry.data.size, entry.metadata.offset, entry.metadata.size);
+			}
+			catalog.flush();
+		}
+
+		readSessionsFromOpenCatalog(editor, start);
+	}
+	static bool readSessionsFromCatalog(Editor* editor) {
+		//список сеансів береться з каталогу одним відображенням файлу, а історія кожного читається при першому відкритті
+		auto start = std::chrono::steady_clock::now();
+		if (!catalog.open(CATALOG_FILEPATH))
+			return false;
+
+		readSessionsFromOpenCatalog(editor, start);
+		return true;
+	}
+	static void readSessionsFromOpenCatalog(Editor* editor, std::chrono::steady_clock::time_point start) {
+		std::vector<SessionsCatalog::Record> records = catalog.getRecordsInOrder();
+		for (SessionsCatalog::Record& record : records) {
+			Session* session = new Session(record.name);
+			session->setCurIndexInCommHistory(record.currentCommandIndex);
+			session->setAttributes(record.dataSize, record.countOfCommands, record.lastModificationTime);
+			session->setHistoryLoaded(false);
+			editor->getSessionsHistory()->addSessionToEnd(session);
+		}
+
+		lastLoadingStatistics.countOfSessions = records.size();
+		lastLoadingStatistics.countOfThreads = 0;
+		lastLoadingStatistics.durationInMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	}
+	static void scanSessionsMetadata(Editor* editor) {
+		if (!std::filesystem::exists(METADATA_DIRECTORY))
+			return;
+
+		auto start = std::chrono::steady_clock::now();
+		std::stack<std::string> available_sessions;
+
+		available_sessions = getFilepathsForMetadata(METADATA_DIRECTORY);
+
+		//кожен потік бере наступний файл і сам будує сеанс (зі своєю ареною команд),
+		//а в історію сеанси додаються в кінці в порядку файлів, як і при послідовному завантаженні
+		int countOfFiles = available_sessions.size();
+		int countOfThreads = std::max(1, std::min(countOfFiles, (int)std::thread::hardware_concurrency()));
+		std::vector<Session*> loadedSessions(countOfFiles, nullptr);
+		std::atomic<int> indexOfNextFile = 0, countOfLoadedFiles = 0;
+		std::vector<std::thread> workers;
+
+		for (int i = 0; i < countOfThreads; i++)
+			workers.emplace_back([&]() {
+				for (int index = indexOfNextFile++; index < countOfFiles; index = indexOfNextFile++) {
+					loadedSessions[index] = readSessionMetadata(editor, available_sessions._Get_container()[index]);
+					countOfLoadedFiles++;
+				}
+				});
+
+		if (countOfFiles >= MIN_COUNT_OF_FILES_FOR_PROGRESS)
+			while (countOfLoadedFiles < countOfFiles) {
+				std::cout << "\rЗавантаження сеансів: " << countOfLoadedFiles << "/" << countOfFiles << std::flush;
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
+
+		for (auto& worker : workers)
+			worker.join();
+
+		for (Session* session : loadedSessions)
+			editor->getSessionsHistory()->addSessionToEnd(session);
+
+		lastLoadingStatistics.countOfSessions = countOfFiles;
+		lastLoadingStatistics.countOfThreads = countOfThreads;
+		lastLoadingStatistics.durationInMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start).count();
+
+		if (countOfFiles >= MIN_COUNT_OF_FILES_FOR_PROGRESS)
+			std::cout << "\rЗавантажено сеансів: " << countOfFiles << " за " << lastLoadingStatistics.durationInMs
+			<< " мс (потоків: " << countOfThreads << ")\n";
+	}
+	static Session* readSessionMetadata(Editor* editor, std::string filepath) {
+		filepath.erase(0, METADATA_DIRECTORY.size());
+		Session* session = new Session(filepath);
+		readSessionHistory(editor, session);
+
+		std::error_code errorCode;
+		auto sizeOfData = std::filesystem::file_size(DATA_DIRECTORY + filepath, errorCode);
+		if (errorCode)
+			sizeOfData = 0;
+		auto lastWriteTime = std::filesystem::last_write_time(DATA_DIRECTORY + filepath, errorCode);
+		//час файлу переводиться в системний годинник через різницю між поточними значеннями обох годинників
+		long long modificationTime = errorCode ? session->getModificationTime() : std::chrono::duration_cast<std::chrono::seconds>(
+			(std::chrono::system_clock::now() + (lastWriteTime - std::filesystem::file_time_type::clock::now())).time_since_epoch()).count();
+		session->setAttributes(sizeOfData, session->sizeOfCommandsHistory(), modificationTime);
+		session->setTimeOfCommands(modificationTime);
+		return session;
+	}
+	static void readSessionHistory(Editor* editor, Session* session) {
+		std::string line, packedMetadata;
+		int countOfCommands;
+
+		std::istringstream packedSession;
+		std::ifstream metadataFile;
+		std::istream& ifs_session = isPackedStorageEnabled ? (std::istream&)packedSession : metadataFile;
+		if (!isPackedStorageEnabled)
+			metadataFile.open(METADATA_DIRECTORY + session->getName());
+		else if (packedStore.readMetadata(session->getName(), packedMetadata))
+			packedSession.str(packedMetadata);
+
+		//сеанс, створений після останнього завершення програми, ще не має метаданих
+		if (!getline(ifs_session, line) || line.empty())
+			return;
+		countOfCommands = stoi(line);
+
+		getline(ifs_session, line);
+		session->setCurIndexInCommHistory(stoi(line));
+
+		for (int j = 0; j < countOfCommands; j++)
+			readCommandMetadata(editor, &ifs_session, session);
+	}
+	static void readTransformCommandMetadata(Editor* editor, std::istream* ifs_session, Session* session) {
+		//перший рядок - ім'я перетворення і режим (в історіях старих версій лише ім'я), далі - знімок тексту, якщо він є;
+		//дані для скасування не зберігаються, тому прочитана команда скасовується відновленням тексту попередньої
+		std::string text = readDataByDelimiter(ifs_session, "---");
+		size_t endOfLine = std::min(text.find('\n'), text.size());
+		std::string firstLine = text.substr(0, endOfLine), mode;
+		size_t endOfName = std::min(firstLine.find(' '), firstLine.size());
+		if (endOfName < firstLine.size())
+			mode = firstLine.substr(endOfName + 1);
+		int transform = TextTransforms::findTransform(firstLine.substr(0, endOfName));
+		Command* previousCommand = session->sizeOfCommandsHistory() > 0 ? session->getCommandByIndex(session->sizeOfCommandsHistory() - 1) : nullptr;
+
+		if (transform == -1) {
+			//невідоме перетворення замінюється записом без змін, щоб позиції в історії лишились правильними
+			BatchCommand batchCommand(editor);
+			batchCommand.setPreviousCommand(previousCommand);
+			session->addCommandAsLast(&batchCommand)->setTextToProcess(previousCommand ? previousCommand->getTextToProcess() : "");
+			return;
+		}
+
+		TransformCommand transformCommand(editor, (TextTransforms::Transform)transform);
+		transformCommand.setPreviousCommand(previousCommand);
+		if (!mode.empty())
+			transformCommand.setUtf8Mode(mode == "utf8");
+		Command* command = session->addCommandAsLast(&transformCommand);
+		if (!previousCommand || endOfLine < text.size())
+			command->setTextToProcess(endOfLine < text.size() ? text.substr(endOfLine + 1) : "");
+	}
+	static void readCommandMetadata(Editor* editor, std::istream* ifs_session, Session* session) {
+		std::string typeOfCommand, text;
+		Command* command,* previousCommand;
+		CutCommand cutCommand(editor);
+		PasteCommand pasteCommand(editor);
+		BatchCommand batchCommand(editor);
+		DeleteCommand deleteCommand(editor);
+		SortLinesCommand sortLinesCommand(editor);
+		UniqueLinesCommand uniqueLinesCommand(editor);
+		FilterLinesCommand filterLinesCommand(editor, true); //зразок і вид фільтра не потрібні: історія зберігає текст після команди
+		ExternalChangeCommand externalChangeCommand(editor);
+
+		getline(*ifs_session, typeOfCommand);
+		if (typeOfCommand == "TransformCommand") {
+			readTransformCommandMetadata(editor, ifs_session, session);
+			return;
+		}
+		if (typeOfCommand == "CutCommand")
+			command = &cutCommand;
+		else if (typeOfCommand == "PasteCommand")
+			command = &pasteCommand;
+		else if (typeOfCommand == "BatchCommand")
+			command = &batchCommand;
+		else if (typeOfCommand == "BaseCommand") {
+			//базовий знімок, в який злиті старіші записи; скасувати його не можна
+			command = &batchCommand;
+			session->setBaseSnapshotInHistory(session->sizeOfCommandsHistory() == 0);
+		}
+		else if (typeOfCommand == "SortLinesCommand")
+			command = &sortLinesCommand;
+		else if (typeOfCommand == "UniqueLinesCommand")
+			command = &uniqueLinesCommand;
+		else if (typeOfCommand == "FilterLinesCommand")
+			command = &filterLinesCommand;
+		else if (typeOfCommand == "ExternalChangeCommand")
+			command = &externalChangeCommand;
+		else
+			command = &deleteCommand;
+
+		if (session->sizeOfCommandsHistory() > 0)
+		{
+			previousCommand = session->getCommandByIndex(session->sizeOfCommandsHistory() - 1);
+			command->setPreviousCommand(previousCommand);
+		}
+
+		//текст записується вже в копію з арени сеансу, щоб не копіювати його двічі
+		text = readDataByDelimiter(ifs_session, "---");
+		session->addCommandAsLast(command)->setTextToProcess(text);
+	}
+
+public:
+	static std::string getSessionsDirectory() {
+		return DATA_DIRECTORY;
+	}
+	static LoadingStatistics getLastLoadingStatistics() {
+		return lastLoadingStatistics;
+	}
+	static void setPackedStorageEnabled(bool isPackedStorageEnabled) {
+		FilesManager::isPackedStorageEnabled = isPackedStorageEnabled;
+	}
+	static bool isPackedStorageUsed() {
+		return isPackedStorageEnabled;
+	}
+	static PackedStore* getPackedStore() {
+		return &packedStore;
+	}
+
+	static void loadSessionHistory(Editor* editor, Session* session) {
+		//сеанси з каталогу отримують історію при першому відкритті
+		std::lock_guard<std::mutex> writerLock(session->getWriterMutex());
+		if (!session->wasHistoryLoaded()) {
+			session->setCurIndexInCommHistory(-1);
+			readSessionHistory(editor, session);
+			session->setTimeOfCommands(session->getModificationTime());
+			session->setHistoryLoaded(true);
+		}
+		catalog.updateAccessTime(session->getName());
+	}
+	static void updateAccessTime(Session* session) {
+		//текст, знайдений у кеші, відкривається без читання файлу, але це теж звернення до сеансу
+		catalog.updateAccessTime(session->getName());
+	}
+	static bool createSessionFiles(Session* session) {
+		if (isPackedStorageEnabled) {
+			catalog.addRecord(session->getName());
+			bool wasCreated = packedStore.writeData(session->getName(), "");
+			catalog.flush();
+			return wasCreated;
+		}
+
+		if (!std::filesystem::exists(DATA_DIRECTORY))
+			std::filesystem::create_directories(DATA_DIRECTORY);
+
+		std::ofstream file(DATA_DIRECTORY + session->getName());
+		if (!file.is_open())
+			return false;
+		file.close();
+
+		catalog.addRecord(session->getName());
+		catalog.flush();
+		return true;
+	}
+	static void deleteSessionFiles(std::string filename) {
+		contentIndex.remove(filename);
+		if (isPackedStorageEnabled) {
+			packedStore.remove(filename);
+			catalog.removeRecord(filename);
+			catalog.flush();
+			return;
+		}
+
+		remove((DATA_DIRECTORY + filename).c_str());
+		{
+			std::lock_guard<std::mutex> lock(statesOfDataMutex);
+			statesOfData.erase(filename);
+		}
+		if (catalog.isOpen()) {
+			remove((METADATA_DIRECTORY + filename).c_str());
+			catalog.removeRecord(filename);
+			catalog.flush();
+		}
+	}
+	static void writeSessionsOrder(SessionsHistory* sessionsHistory, bool isSortedByName) {
+		std::vector<std::string> namesInOrder;
+		for (int i = 0; i < sessionsHistory->size(); i++)
+			namesInOrder.push_back(sessionsHistory->getSessionByIndex(i)->getName());
+		catalog.updateOrder(namesInOrder, isSortedByName);
+		catalog.flush();
+	}
+
+	static std::string readSessionData(std::string fullFilepath) {
+		ProfilerScope profilerScope("FilesManager::readSessionData");
+		std::string text, line;
+
+		std::ifstream file(fullFilepath);
+
+		int counterOfLines = 0;
+
+		while (getline(file, line))
+		{
+			counterOfLines++;
+			if (counterOfLines > 1)
+				line = "\n" + line;
+			text += line;
+		}
+
+		file.close();
+
+		return text;
+	}
+
+	static unsigned long long getSizeOfSessionData(std::string filename) {
+		if (isPackedStorageEnabled) {
+			PackedStore::Entry entry;
+			return packedStore.getEntry(filename, entry) ? entry.data.size : 0;
+		}
+
+		std::error_code errorCode;
+		auto sizeOfFile = std::filesystem::file_size(DATA_DIRECTORY + filename, errorCode);
+		return errorCode ? 0 : sizeOfFile;
+	}
+	static void forEachChunkOfSessionData(std::string filename, std::function<bool(const char*, size_t)> action) {
+		//текст сеансу передається шматками, не завантажуючись у пам'ять цілим; action повертає false, щоб зупинитись
+		std::string chunk;
+		if (isPackedStorageEnabled) {
+			for (unsigned long long offset = 0; packedStore.readRangeOfData(filename, offset, SIZE_OF_SCAN_CHUNK, chunk) && !chunk.empty();
+				offset += chunk.size())
+				if (!action(chunk.data(), chunk.size()))
+					return;
+			return;
+		}
+
+		//файл читається так само, як у readSessionData: останній символ кінця рядка до тексту не належить,
+		//тому він притримується, доки не стане відомо, чи є після нього ще дані
+		std::ifstream file(DATA_DIRECTORY + filename);
+		bool isNewlineHeld = false;
+		while (file) {
+			chunk.assign(isNewlineHeld ? "\n" : "");
+			size_t startOfRead = chunk.size();
+			chunk.resize(startOfRead + SIZE_OF_SCAN_CHUNK);
+			file.read(chunk.data() + startOfRead, SIZE_OF_SCAN_CHUNK);
+			chunk.resize(startOfRead + (size_t)file.gcount());
+			if (chunk.size() == startOfRead)
+				return;
+
+			isNewlineHeld = chunk.back() == '\n';
+			if (isNewlineHeld)
+				chunk.pop_back();
+			if (!chunk.empty() && !action(chunk.data(), chunk.size()))
+				return;
+		}
+	}
+	static ContentIndex::Match findInSessionData(std::string filename, const std::string& phrase) {
+		//між шматками зберігається хвіст довжиною phrase.size() - 1, тому фраза на межі шматків теж знаходиться
+		ContentIndex::Match match = { filename, {}, true };
+		std::string window;
+		unsigned long long startOfWindow = 0;
+
+		forEachChunkOfSessionData(filename, [&](const char* chunk, size_t lengthOfChunk) {
+			window.append(chunk, lengthOfChunk);
+			for (size_t position = window.find(phrase); position != std::string::npos; position = window.find(phrase, position + 1)) {
+				if (match.offsets.size() == ContentIndex::MAX_COUNT_OF_OFFSETS) {
+					match.isComplete = false;
+					return false;
+				}
+				match.offsets.push_back(startOfWindow + position);
+			}
+
+			size_t lengthOfTail = std::min(window.size(), phrase.size() - 1);
+			startOfWindow += window.size() - lengthOfTail;
+			window.erase(0, window.size() - lengthOfTail);
+			return true;
+			});
+		return match;
+	}
+	static std::string getFingerprintOfSessionData(std::string filename) {
+		//розмір, час запису та хеш кінця файлу (у сховищі - місце запису тексту) змінюються при кожному записі,
+		//тому за відбитком видно, чи змінювався текст, без читання всього тексту ("" - тексту немає)
+		if (isPackedStorageEnabled) {
+			PackedStore::Entry entry;
+			if (!packedStore.getEntry(filename, entry) || !entry.data.offset)
+				return "";
+			return std::to_string(entry.data.offset) + " " + std::to_string(entry.data.size);
+		}
+
+		DataState state;
+		if (!readDataState(filename, state))
+			return "";
+		return std::to_string(state.sizeOfFile) + " " + std::to_string(state.lastWriteTime.time_since_epoch().count()) + " " +
+			std::to_string(state.hashOfTail);
+	}
+	static std::vector<ContentIndex::Match> searchInSessions(SessionsHistory* sessionsHistory, std::string phrase) {
+		//сеанси, змінені поза цим процесом (розмір не збігається із записаним в індексі), переіндексовуються перед пошуком;
+		//записи пакованого сховища копіюються один раз, а не для кожного сеансу
+		std::map<std::string, PackedStore::Entry> entries;
+		if (isPackedStorageEnabled)
+			entries = packedStore.getEntries();
+
+		for (const std::string& name : sessionsHistory->getNamesOfSessions()) {
+			unsigned long long sizeOfData;
+			if (isPackedStorageEnabled) {
+				auto entriesIter = entries.find(name);
+				sizeOfData = entriesIter == entries.end() ? 0 : entriesIter->second.data.size;
+			}
+			else
+				sizeOfData = getSizeOfSessionData(name);
+			if (!contentIndex.isUpToDate(name, sizeOfData))
+				contentIndex.update(name, sizeOfData <= ContentIndex::MAX_SIZE_OF_INDEXED_TEXT ? readSessionDataByName(name) : "", sizeOfData);
+		}
+
+		std::vector<ContentIndex::Match> matches = contentIndex.find(phrase);
+
+		//завеликі для індексу тексти переглядаються напряму, шматками
+		if (!phrase.empty())
+			for (std::string name : contentIndex.getNotIndexedSessions()) {
+				ContentIndex::Match match = findInSessionData(name, phrase);
+				if (!match.offsets.empty())
+					matches.push_back(match);
+			}
+		return matches;
+	}
+
+	static std::string readSessionDataByName(std::string filename) {
+		if (!isPackedStorageEnabled)
+			return readSessionData(DATA_DIRECTORY + filename);
+
+		ProfilerScope profilerScope("FilesManager::readSessionData");
+		std::string text;
+		packedStore.readData(filename, text);
+		return text;
+	}
+
+	static bool writeSessionData(std::string filename, std::string newData) {
+		ProfilerScope profilerScope("FilesManager::writeSessionData");
+		if (isPackedStorageEnabled) {
+			bool wasWritten = packedStore.writeData(filename, newData);
+			if (wasWritten) {
+				contentIndex.markAsStale(filename);
+				updateSessionAttributes(filename, newData.size());
+			}
+			return wasWritten;
+		}
+
+		std::ofstream file(DATA_DIRECTORY + filename);
+
+		if (!file.is_open())
+			return false;
+
+		file << newData;
+		if(!newData.empty() && newData[newData.size() - 1] == '\n')
+			file << '\n';
+
+		unsigned long long sizeOfFile = file.tellp();
+		catalog.updateData(filename, sizeOfFile);
+		file.close();
+		contentIndex.markAsStale(filename);
+		updateSessionAttributes(filename, sizeOfFile);
+		rememberDataState(filename);
+
+		return true;
+	}
+
+	//зовнішні зміни файлів сеансів: програма пам'ятає, яким файл був після її власного читання чи запису,
+	//тому сповіщення про власні записи відкидаються порівнянням розміру й часу запису
+	static void rememberDataState(std::string filename) {
+		if (isPackedStorageEnabled)
+			return;
+
+		DataState state;
+		bool wasRead = readDataState(filename, state);
+		std::lock_guard<std::mutex> lock(statesOfDataMutex);
+		if (wasRead)
+			statesOfData[filename] = state;
+		else
+			statesOfData.erase(filename);
+	}
+	static bool hasDataChangedExternally(std::string filename) {
+		std::error_code errorCode;
+		std::lock_guard<std::mutex> lock(statesOfDataMutex);
+		auto statesIter = statesOfData.find(filename);
+		if (statesIter == statesOfData.end())
+			return false;
+
+		unsigned long long sizeOfFile = std::filesystem::file_size(DATA_DIRECTORY + filename, errorCode);
+		if (errorCode)
+			return false;
+		auto lastWriteTime = std::filesystem::last_write_time(DATA_DIRECTORY + filename, errorCode);
+		return !errorCode && (sizeOfFile != statesIter->second.sizeOfFile || lastWriteTime != statesIter->second.lastWriteTime);
+	}
+	static std::vector<std::string> getNamesOfRememberedData() {
+		std::lock_guard<std::mutex> lock(statesOfDataMutex);
+		std::vector<std::string> names;
+		for (auto& [name, state] : statesOfData)
+			names.push_back(name);
+		return names;
+	}
+	static bool readExternalChange(std::string filename, const std::string& text, ExternalChange& change) {
+		//дописування в кінець впізнається за хешем колишнього хвоста, і з файлу читаються лише нові байти;
+		//інакше файл читається повністю, а змінена ділянка - це все між спільними з відкритим текстом початком і кінцем
+		std::unique_lock<std::mutex> lock(statesOfDataMutex);
+		auto statesIter = statesOfData.find(filename);
+		if (isPackedStorageEnabled || statesIter == statesOfData.end())
+			return false;
+		DataState oldState = statesIter->second, newState;
+		lock.unlock();
+
+		if (!readDataState(filename, newState) ||
+			(newState.sizeOfFile == oldState.sizeOfFile && newState.lastWriteTime == oldState.lastWriteTime))
+			return false;
+
+		std::string filepath = DATA_DIRECTORY + filename;
+		unsigned long long startOfOldTail = oldState.sizeOfFile - std::min<unsigned long long>(oldState.sizeOfFile, SIZE_OF_TAIL_CHUNK);
+		//CR в кінці старого файлу міг стати половиною CRLF, тоді дописаний хвіст окремо не перетворити
+		bool isAppend = oldState.sizeOfFile > 0 && newState.sizeOfFile > oldState.sizeOfFile && oldState.lastByte != '\r' &&
+			std::hash<std::string>()(readRangeOfFile(filepath, startOfOldTail, oldState.sizeOfFile - startOfOldTail)) == oldState.hashOfTail;
+
+		if (isAppend) {
+			//текст сеансу - це файл без одного останнього переходу на новий рядок (див. writeSessionData)
+			std::string appendedText = convertLineEndings(readRangeOfFile(filepath, oldState.sizeOfFile, newState.sizeOfFile - oldState.sizeOfFile));
+			if (oldState.lastByte == '\n')
+				appendedText.insert(appendedText.begin(), '\n');
+			if (!appendedText.empty() && appendedText.back() == '\n')
+				appendedText.pop_back();
+			change = { (int)text.size(), (int)text.size(), appendedText, true, false };
+		}
+		else {
+			std::string newText = readSessionData(filepath);
+			std::pair<size_t, size_t> changedRange = Editor::findChangedRange(text, newText);
+			int sizeOfPrefix = (int)changedRange.first, sizeOfSuffix = (int)(newText.size() - changedRange.second);
+			if (Editor::isUtf8Mode()) {
+				//межі ділянки зсуваються на початки символів, щоб не розрізати багатобайтовий символ
+				auto isContinuationByte = [](const std::string& text, int position) {
+					return position < (int)text.size() && (text[position] & 0xC0) == 0x80;
+				};
+				while (sizeOfPrefix > 0 && (isContinuationByte(text, sizeOfPrefix) || isContinuationByte(newText, sizeOfPrefix)))
+					sizeOfPrefix--;
+				while (sizeOfSuffix > 0 && isContinuationByte(newText, (int)newText.size() - sizeOfSuffix))
+					sizeOfSuffix--;
+			}
+			change = { sizeOfPrefix, (int)text.size() - sizeOfSuffix,
+				newText.substr(sizeOfPrefix, newText.size() - sizeOfSuffix - sizeOfPrefix), false, false };
+		}
+
+		//відхилена зміна не запам'ятовується, інакше наступна шукалась би відносно тексту, якого в буфері немає
+		change.isRejected = Editor::isUtf8Mode() && !Utf8Index::isValid(change.text);
+		if (change.isRejected)
+			return true;
+
+		lock.lock();
+		statesOfData[filename] = newState;
+		return change.startPosition != change.endPosition || !change.text.empty();
+	}
+	static bool moveExternalChangeOverUnsavedEdits(const std::string& textInFile, const std::string& text, ExternalChange& change) {
+		//зміна знайдена відносно тексту, який програма востаннє записала у файл, а в буфері після нього є незбережені правки;
+		//зміна, яка їх не зачіпає, лише зсувається, інакше охоплює й ділянку правок, тобто там перемагає файл,
+		//а правки повертає скасування; повертає false, якщо ділянки перетнулись
+		std::pair<size_t, size_t> unsavedRange = Editor::findChangedRange(textInFile, text);
+		int startOfUnsaved = (int)unsavedRange.first, sizeOfSuffix = (int)(text.size() - unsavedRange.second);
+		if (Editor::isUtf8Mode()) {
+			auto isContinuationByte = [](const std::string& text, int position) {
+				return position < (int)text.size() && (text[position] & 0xC0) == 0x80;
+			};
+			while (startOfUnsaved > 0 && isContinuationByte(text, startOfUnsaved))
+				startOfUnsaved--;
+			while (sizeOfSuffix > 0 && isContinuationByte(text, (int)text.size() - sizeOfSuffix))
+				sizeOfSuffix--;
+		}
+		int endOfUnsavedInFile = (int)textInFile.size() - sizeOfSuffix, shiftOfText = (int)text.size() - (int)textInFile.size();
+
+		if (change.endPosition <= startOfUnsaved)
+			return true;
+		if (change.startPosition >= endOfUnsavedInFile) {
+			change.startPosition += shiftOfText;
+			change.endPosition += shiftOfText;
+			return true;
+		}
+
+		int startOfRange = std::min(change.startPosition, startOfUnsaved), endOfRangeInFile = std::max(change.endPosition, endOfUnsavedInFile);
+		std::string newTextInFile = textInFile;
+		newTextInFile.replace(change.startPosition, change.endPosition - change.startPosition, change.text);
+		int shiftOfChange = (int)change.text.size() - (change.endPosition - change.startPosition);
+		change.text = newTextInFile.substr(startOfRange, endOfRangeInFile + shiftOfChange - startOfRange);
+		change.startPosition = startOfRange;
+		change.endPosition = endOfRangeInFile + shiftOfText;
+		change.isAppend = false;
+		return false;
+	}
+	static void updateSessionAttributes(std::string filename, unsigned long long sizeOfData) {
+		//після запису сеанс переставляється у впорядкованих переглядах (розмір, довжина історії, час зміни)
+		long long modificationTime = std::chrono::duration_cast<std::chrono::seconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+		catalog.updateModificationTime(filename, modificationTime);
+
+		SessionsHistory* sessionsHistory = Editor::getSessionsHistory();
+		Session* session = sessionsHistory ? sessionsHistory->getSessionByName(filename) : nullptr;
+		if (!session)
+			return;
+
+		int lengthOfHistory = session->wasHistoryLoaded() ? session->sizeOfCommandsHistory() : session->getLengthOfHistory();
+		sessionsHistory->updateSession(session, sizeOfData, lengthOfHistory, modificationTime);
+	}
+};
+
+const std::string FilesManager::METADATA_DIRECTORY = "Metadata\\",
+FilesManager::DATA_DIRECTORY = "Data\\";
+const std::string FilesManager::CATALOG_FILEPATH = "Sessions.catalog",
+FilesManager::PACKED_STORE_FILEPATH = "Sessions.pack",
+FilesManager::PACKED_CATALOG_FILEPATH = "Sessions.pack.catalog",
+FilesManager::CONTENT_INDEX_FILEPATH = "Contents.index";
+const int FilesManager::MIN_COUNT_OF_FILES_FOR_PROGRESS = 500;
+const size_t FilesManager::SIZE_OF_SCAN_CHUNK = 1 << 20;
+SessionsCatalog FilesManager::catalog;
+PackedStore FilesManager::packedStore;
+bool FilesManager::isPackedStorageEnabled = false;
+ContentIndex FilesManager::contentIndex;
+FilesManager::LoadingStatistics FilesManager::lastLoadingStatistics = { 0, 0, 0 };
+const size_t FilesManager::SIZE_OF_TAIL_CHUNK = 64 * 1024;
+std::unordered_map<std::string, FilesManager::DataState> FilesManager::statesOfData;
+std::mutex FilesManager::statesOfDataMutex;
+
+class StreamingDocument {
+private:
+	static const size_t SIZE_OF_CHUNK; //розмір шматка, яким читається оригінальний файл
+
+	struct Piece {
+		bool isFromOriginal; //шматок з оригінального файлу чи з доданого тексту
+		unsigned long long offset, length; //зміщення в джерелі та довжина
+	};
+
+	std::string filepath; //шлях до файлу, який редагуємо
+	std::ifstream original; //оригінальний файл на диску, який не змінюється до збереження
+	std::string addedText; //усі вставлені байти (накладка правок у пам'яті)
+	std::vector<Piece> pieces; //таблиця шматків: документ - це їх послідовність
+	unsigned long long size; //поточний розмір документа
+
+	size_t splitPieceAt(unsigned long long position) {
+		//повертає індекс шматка, який починається точно з position, розрізаючи шматок за потреби
+		unsigned long long startOfPiece = 0;
+		for (size_t i = 0; i < pieces.size(); i++) {
+			if (position == startOfPiece)
+				return i;
+			if (position < startOfPiece + pieces[i].length) {
+				Piece secondPart = pieces[i];
+				unsigned long long lengthOfFirstPart = position - startOfPiece;
+				pieces[i].length = lengthOfFirstPart;
+				secondPart.offset += lengthOfFirstPart;
+				secondPart.length -= lengthOfFirstPart;
+				pieces.insert(pieces.begin() + i + 1, secondPart);
+				return i + 1;
+			}
+			startOfPiece += pieces[i].length;
+		}
+		return pieces.size();
+	}
+	void readFromPiece(const Piece& piece, unsigned long long offsetInPiece, size_t length, char* buffer) {
+		if (!piece.isFromOriginal) {
+			std::copy_n(addedText.data() + piece.offset + offsetInPiece, length, buffer);
+			return;
+		}
+		original.clear();
+		original.seekg(piece.offset + offsetInPiece);
+		original.read(buffer, length);
+	}
+
+public:
+	StreamingDocument() { size = 0; }
+
+	bool open(std::string filepath) {
+		this->filepath = filepath;
+		original.open(filepath, std::ios::binary);
+		if (!original.is_open())
+			return false;
+
+		size = std::filesystem::file_size(filepath);
+		pieces.clear();
+		addedText.clear();
+		if (size > 0)
+			pieces.push_back({ true, 0, size });
+		return true;
+	}
+
+	unsigned long long getSize() { return size; }
+	size_t getCountOfPieces() { return pieces.size(); }
+	size_t getSizeOfOverlay() { return addedText.size() + pieces.size() * sizeof(Piece); }
+
+	void forEachChunk(unsigned long long position, unsigned long long length, std::function<bool(const char*, size_t)> action) {
+		//послідовно передає вміст діапазону шматками не більшими за SIZE_OF_CHUNK; action повертає false, щоб зупинитись
+		std::string buffer(SIZE_OF_CHUNK, '\0');
+		unsigned long long startOfPiece = 0, endOfRange = std::min(position + length, size);
+
+		for (size_t i = 0; i < pieces.size() && position < endOfRange; i++) {
+			unsigned long long endOfPiece = startOfPiece + pieces[i].length;
+			while (position >= startOfPiece && position < endOfPiece && position < endOfRange) {
+				size_t lengthOfChunk = (size_t)std::min({ (unsigned long long)SIZE_OF_CHUNK, endOfPiece - position, endOfRange - position });
+				readFromPiece(pieces[i], position - startOfPiece, lengthOfChunk, buffer.data());
+				if (!action(buffer.data(), lengthOfChunk))
+					return;
+				position += lengthOfChunk;
+			}
+			startOfPiece = endOfPiece;
+		}
+	}
+	std::string read(unsigned long long position, size_t length) {
+		std::string text;
+		forEachChunk(position, length, [&text](const char* chunk, size_t lengthOfChunk) {
+			text.append(chunk, lengthOfChunk);
+			return true;
+			});
+		return text;
+	}
+	long long find(std::string textToFind, unsigned long long from = 0) {
+		//пошук потоком по шматках; між шматками зберігається хвіст довжиною textToFind.size() - 1
+		if (textToFind.empty() || from >= size)
+			return -1;
+
+		std::string window;
+		unsigned long long startOfWindow = from;
+		long long foundPosition = -1;
+
+		forEachChunk(from, size - from, [&](const char* chunk, size_t lengthOfChunk) {
+			window.append(chunk, lengthOfChunk);
+			size_t positionInWindow = window.find(textToFind);
+			if (positionInWindow != std::string::npos) {
+				foundPosition = startOfWindow + positionInWindow;
+				return false;
+			}
+
+			size_t lengthOfTail = std::min(window.size(), textToFind.size() - 1);
+			startOfWindow += window.size() - lengthOfTail;
+			window.erase(0, window.size() - lengthOfTail);
+			return true;
+			});
+
+		return foundPosition;
+	}
+
+	void insert(unsigned long long position, std::string_view text) {
+		if (text.empty())
+			return;
+
+		position = std::min(position, size);
+		size_t indexOfPiece = splitPieceAt(position);
+		pieces.insert(pieces.begin() + indexOfPiece, { false, addedText.size(), text.size() });
+		addedText += text;
+		size += text.size();
+	}
+	void remove(unsigned long long position, unsigned long long length) {
+		if (position >= size || length == 0)
+			return;
+
+		length = std::min(length, size - position);
+		size_t indexOfFirstPiece = splitPieceAt(position);
+		size_t indexOfLastPiece = splitPieceAt(position + length);
+		pieces.erase(pieces.begin() + indexOfFirstPiece, pieces.begin() + indexOfLastPiece);
+		size -= length;
+	}
+	std::string cut(unsigned long long position, size_t length) {
+		std::string text = read(position, length);
+		remove(position, length);
+		return text;
+	}
+
+	bool save() {
+		//документ потоком записується в тимчасовий файл, який потім замінює оригінал
+		std::string temporaryFilepath = filepath + ".tmp";
+		std::ofstream file(temporaryFilepath, std::ios::binary);
+
+		if (!file.is_open())
+			return false;
+
+		forEachChunk(0, size, [&file](const char* chunk, size_t lengthOfChunk) {
+			file.write(chunk, lengthOfChunk);
+			return true;
+			});
+		file.close();
+		if (file.fail())
+			return false;
+
+		original.close();
+		std::error_code errorCode;
+		std::filesystem::rename(temporaryFilepath, filepath, errorCode);
+		if (errorCode) {
+			original.open(filepath, std::ios::binary);
+			return false;
+		}
+
+		return open(filepath);
+	}
+};
+
+const size_t StreamingDocument::SIZE_OF_CHUNK = 1 << 20;
+
+void Editor::tryToLoadSessions() { FilesManager::readSessionsMetadata(this); }
+bool Editor::tryToUnloadSessions() { return FilesManager::writeSessionsMetadata(sessionsHistory); }
+
+class DataDirectoryWatcher {
+private:
+	static const DWORD SIZE_OF_NOTIFICATIONS_BUFFER; //скільки байтів сповіщень система може накопичити між читаннями
+
+	HANDLE directory, stopEvent; //директорія, за якою стежимо, та подія зупинки потоку
+	std::thread worker; //потік, який чекає на сповіщення системи
+	std::mutex changesMutex; //захищає накопичені зміни
+	std::unordered_set<std::string> changedFiles; //імена змінених файлів, ще не забрані програмою
+	bool wasOverflowed; //сповіщень було більше, ніж вміщує буфер, тому змінитись міг будь-який файл
+
+	void run() {
+		std::vector<DWORD> buffer(SIZE_OF_NOTIFICATIONS_BUFFER / sizeof(DWORD)); //сповіщення мають бути вирівняні на DWORD
+		OVERLAPPED overlapped = {};
+		overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+		HANDLE events[] = { overlapped.hEvent, stopEvent };
+		DWORD sizeOfNotifications;
+
+		while (ReadDirectoryChangesW(directory, buffer.data(), SIZE_OF_NOTIFICATIONS_BUFFER, FALSE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE, NULL, &overlapped, NULL)) {
+			if (WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0) {
+				CancelIo(directory);
+				GetOverlappedResult(directory, &overlapped, &sizeOfNotifications, TRUE);
+				break;
+			}
+			if (!GetOverlappedResult(directory, &overlapped, &sizeOfNotifications, FALSE))
+				break;
+			ResetEvent(overlapped.hEvent);
+
+			std::lock_guard<std::mutex> lock(changesMutex);
+			if (sizeOfNotifications == 0) {
+				wasOverflowed = true;
+				continue;
+			}
+			for (char* notification = (char*)buffer.data(); ; ) {
+				FILE_NOTIFY_INFORMATION* information = (FILE_NOTIFY_INFORMATION*)notification;
+				char filename[MAX_PATH];
+				int sizeOfFilename = WideCharToMultiByte(CP_ACP, 0, information->FileName, information->FileNameLength / sizeof(WCHAR),
+					filename, MAX_PATH, NULL, NULL);
+				changedFiles.insert(std::string(filename, sizeOfFilename));
+				if (information->NextEntryOffset == 0)
+					break;
+				notification += information->NextEntryOffset;
+			}
+		}
+		CloseHandle(overlapped.hEvent);
+	}
+
+public:
+	DataDirectoryWatcher() {
+		directory = INVALID_HANDLE_VALUE;
+		stopEvent = NULL;
+		wasOverflowed = false;
+	}
+	~DataDirectoryWatcher() { stop(); }
+
+	bool start(std::string directoryPath) {
+		stop();
+		std::filesystem::create_directories(directoryPath);
+		directory = CreateFileA(directoryPath.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+		if (directory == INVALID_HANDLE_VALUE)
+			return false;
+
+		stopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+		worker = std::thread(&DataDirectoryWatcher::run, this);
+		return true;
+	}
+	void stop() {
+		if (!worker.joinable())
+			return;
+
+		SetEvent(stopEvent);
+		worker.join();
+		CloseHandle(stopEvent);
+		CloseHandle(directory);
+		directory = INVALID_HANDLE_VALUE;
+	}
+	std::vector<std::string> takeChangedFiles(bool& wasOverflowed) {
+		std::lock_guard<std::mutex> lock(changesMutex);
+		std::vector<std::string> filenames(changedFiles.begin(), changedFiles.end());
+		changedFiles.clear();
+		wasOverflowed = this->wasOverflowed;
+		this->wasOverflowed = false;
+		return filenames;
+	}
+};
+
+const DWORD DataDirectoryWatcher::SIZE_OF_NOTIFICATIONS_BUFFER = 64 * 1024;
+
+class SessionBuffersCache {
+public:
+	struct Statistics {
+		unsigned long long countOfHits, countOfMisses, countOfEvictions; //звернення, знайдені в кеші, не знайдені та витіснені тексти
+		size_t countOfBuffers, sizeOfBuffers, budgetInBytes; //скільки текстів у кеші, скільки байтів вони займають та обмеження
+	};
+
+	static const size_t DEFAULT_BUDGET_IN_BYTES; //скільки байтів текстів сеансів можна тримати в пам'яті за замовчуванням
+
+private:
+	struct Entry {
+		Session* session; //сеанс, якому належить текст
+		std::string* text; //текст сеансу, який редагується на місці
+	};
+
+	std::list<Entry> entries; //від нещодавно використаного до найдавнішого
+	std::unordered_map<Session*, std::list<Entry>::iterator> entriesOfSessions; //пошук запису за сеансом
+	size_t budgetInBytes; //обмеження розміру кешу
+	unsigned long long countOfHits, countOfMisses, countOfEvictions; //лічильники звернень
+
+	size_t getSizeOfBuffers() {
+		//тексти змінюються командами на місці, тому розмір рахується щоразу заново
+		size_t sizeOfBuffers = 0;
+		for (Entry& entry : entries)
+			sizeOfBuffers += entry.text->capacity();
+		return sizeOfBuffers;
+	}
+	void evictIfNecessary() {
+		//найновіший запис не витісняється ніколи: його текст зараз редагується
+		while (entries.size() > 1 && getSizeOfBuffers() > budgetInBytes) {
+			Entry& entry = entries.back();
+			entriesOfSessions.erase(entry.session);
+			delete entry.text;
+			entries.pop_back();
+			countOfEvictions++;
+		}
+	}
+
+public:
+	SessionBuffersCache(size_t budgetInBytes = DEFAULT_BUDGET_IN_BYTES) {
+		this->budgetInBytes = budgetInBytes;
+		countOfHits = countOfMisses = countOfEvictions = 0;
+	}
+	~SessionBuffersCache() { clear(); }
+
+	std::string* get(Session* session) {
+		auto iterator = entriesOfSessions.find(session);
+		if (iterator == entriesOfSessions.end()) {
+			countOfMisses++;
+			return nullptr;
+		}
+
+		countOfHits++;
+		entries.splice(entries.begin(), entries, iterator->second);
+		return iterator->second->text;
+	}
+	std::string* put(Session* session, std::string text) {
+		invalidate(session);
+		entries.push_front({ session, new std::string(std::move(text)) });
+		entriesOfSessions[session] = entries.begin();
+		evictIfNecessary();
+		return entries.front().text;
+	}
+	void invalidate(Session* session) {
+		auto iterator = entriesOfSessions.find(session);
+		if (iterator == entriesOfSessions.end())
+			return;
+
+		delete iterator->second->text;
+		entries.erase(iterator->second);
+		entriesOfSessions.erase(iterator);
+	}
+	void clear() {
+		for (Entry& entry : entries)
+			delete entry.text;
+		entries.clear();
+		entriesOfSessions.clear();
+	}
+
+	void setBudget(size_t budgetInBytes) {
+		this->budgetInBytes = budgetInBytes;
+		evictIfNecessary();
+	}
+	Statistics getStatistics() {
+		return { countOfHits, countOfMisses, countOfEvictions, entries.size(), getSizeOfBuffers(), budgetInBytes };
+	}
+};
+
+const size_t SessionBuffersCache::DEFAULT_BUDGET_IN_BYTES = 64 * 1024 * 1024;
+
+class CommandsRecorder {
+public:
+	struct Request {
+		std::string type; //PASTE, DELETE, CUT, COPY, SORTLINES, UNIQUELINES, KEEPLINES, DROPLINES, EXTERNALCHANGE,
+		//UNDO, REDO, BEGIN, COMMIT, ROLLBACK, OPEN, LOAD, MODE, а в журналі реплікації ще LOG, CREATESESSION, DELETESESSION
+		long long startPosition, endPosition; //межі ділянки тексту для команд редагування
+		std::string payload; //текст вставки, зразок фільтра рядків, ім'я сеансу (OPEN та ін.), початковий текст сеансу (LOAD),
+		//кодування (MODE) або ідентифікатор журналу (LOG)
+	};
+
+private:
+	static std::ofstream stream; //файл, в який записуються запити
+	static std::mutex streamMutex; //запити з різних потоків записуються по одному
+	static Session* lastSession; //сеанс, до якого належить останній записаний запит
+	static std::map<Session*, bool> recordedSessions; //сеанси, початковий текст яких уже записаний
+	static bool wasModeRecorded; //чи записане кодування тексту
+
+	static bool hasNameAfterType(std::string type) {
+		return type == "OPEN" || type == "MODE" || type == "LOG" || type == "CREATESESSION" || type == "DELETESESSION";
+	}
+	static bool hasPositions(std::string type) {
+		return type == "PASTE" || type == "DELETE" || type == "CUT" || type == "COPY" || type == "EXTERNALCHANGE";
+	}
+	static bool hasPayloadAfterLine(std::string type) {
+		return type == "PASTE" || type == "LOAD" || type == "KEEPLINES" || type == "DROPLINES" || type == "EXTERNALCHANGE";
+	}
+
+public:
+	static std::string formatRequest(const Request& request) {
+		//той самий формат, що й у запитів сервера редагування: рядок "ТИП аргументи", а текст іде одразу після нього
+		std::string line = request.type;
+		if (hasPositions(request.type))
+			line += " " + std::to_string(request.startPosition) + " " + std::to_string(request.endPosition);
+		if (hasNameAfterType(request.type))
+			line += " " + request.payload;
+		if (hasPayloadAfterLine(request.type))
+			line += " " + std::to_string(request.payload.size());
+		line += "\n";
+		return hasPayloadAfterLine(request.type) ? line + request.payload : line;
+	}
+	static bool readRequest(std::istream& input, Request& request) {
+		std::string line;
+		if (!getline(input, line))
+			return false;
+
+		std::istringstream arguments(line);
+		size_t sizeOfPayload = 0;
+		request = { "", 0, 0, "" };
+		arguments >> request.type;
+		if (hasNameAfterType(request.type))
+			getline(arguments >> std::ws, request.payload);
+		if (hasPositions(request.type) && !(arguments >> request.startPosition >> request.endPosition))
+			return false;
+		if (hasPayloadAfterLine(request.type)) {
+			if (!(arguments >> sizeOfPayload))
+				return false;
+			request.payload.resize(sizeOfPayload);
+			if (sizeOfPayload > 0 && !input.read(request.payload.data(), sizeOfPayload))
+				return false;
+		}
+		return !request.type.empty();
+	}
+
+	static bool start(std::string filepath) {
+		std::lock_guard<std::mutex> lock(streamMutex);
+		stream.open(filepath, std::ios::binary | std::ios::trunc);
+		return stream.is_open();
+	}
+	static void stop() {
+		std::lock_guard<std::mutex> lock(streamMutex);
+		stream.close();
+	}
+	static bool isRecording() { return stream.is_open(); }
+
+	static void record(Session* session, std::string typeOfCommand, long long startPosition = 0, long long endPosition = 0, std::string payload = "") {
+		//перед першим запитом сеансу записується його текст, щоб відтворення починалося з того самого стану
+		if (!isRecording())
+			return;
+
+		std::lock_guard<std::mutex> lock(streamMutex);
+		if (!wasModeRecorded) {
+			stream << formatRequest({ "MODE", 0, 0, Editor::isUtf8Mode() ? "UTF8" : "BYTES" });
+			wasModeRecorded = true;
+		}
+		if (session != lastSession) {
+			stream << formatRequest({ "OPEN", 0, 0, session->getName() });
+			if (!recordedSessions[session]) {
+				stream << formatRequest({ "LOAD", 0, 0, *session->getTextSnapshot() });
+				recordedSessions[session] = true;
+			}
+			lastSession = session;
+		}
+
+		for (char& symbol : typeOfCommand)
+			symbol = toupper(symbol);
+		stream << formatRequest({ typeOfCommand, startPosition, endPosition, payload });
+		stream.flush();
+	}
+};
+
+std::ofstream CommandsRecorder::stream;
+std::mutex CommandsRecorder::streamMutex;
+Session* CommandsRecorder::lastSession = nullptr;
+std::map<Session*, bool> CommandsRecorder::recordedSessions;
+bool CommandsRecorder::wasModeRecorded = false;
+
+class ReplicationLog {
+public:
+	static const std::string LOG_FILENAME, //журнал змін у резервній директорії
+		APPLIED_FILENAME, //ідентифікатор журналу та позиція, до якої його застосувала репліка
+		SHIPPED_FILENAME; //відбитки текстів сеансів, повністю описаних журналом (пишуться при зупинці журналу)
+
+private:
+	static std::string standbyDirectory; //резервна директорія ("" - реплікація вимкнена)
+	static std::ofstream stream; //журнал, в який дописуються зміни
+	static std::mutex streamMutex; //зміни з різних потоків записуються по одній
+	static std::atomic<bool> isActive; //чи ведеться журнал
+	static Session* lastSession; //сеанс, до якого належить останній записаний запис
+	static SessionsHistory* sessionsHistory; //сеанси, зміни яких відправляються
+	static unsigned long long maxSizeOfSession; //сеанси такого розміру і більші редагуються потоково і не реплікуються
+	static unsigned long long countOfRecords, countOfShippedBytes; //скільки записів і байтів відправлено в журнал
+
+	static void write(const CommandsRecorder::Request& request) {
+		std::string record = CommandsRecorder::formatRequest(request);
+		stream << record;
+		countOfRecords++;
+		countOfShippedBytes += record.size();
+	}
+
+public:
+	static void setStandbyDirectory(std::string standbyDirectory) { ReplicationLog::standbyDirectory = standbyDirectory; }
+	static std::string getStandbyDirectory() { return standbyDirectory; }
+	static bool isReplicating() { return isActive; }
+	static unsigned long long getCountOfRecords() { return countOfRecords; }
+	static unsigned long long getCountOfShippedBytes() { return countOfShippedBytes; }
+
+	static std::string readIdentifierOfLog(std::string filepath) {
+		std::ifstream file(filepath, std::ios::binary);
+		CommandsRecorder::Request request;
+		return CommandsRecorder::readRequest(file, request) && request.type == "LOG" ? request.payload : "";
+	}
+
+	static std::map<std::string, std::string> readShippedFingerprints() {
+		//файл пар рядків "ім'я сеансу", "відбиток"; після читання видаляється, тож після збою його не буде
+		std::map<std::string, std::string> fingerprints;
+		std::string filepath = standbyDirectory + "\\" + SHIPPED_FILENAME, name, fingerprint;
+		std::ifstream file(filepath, std::ios::binary);
+		while (getline(file, name) && getline(file, fingerprint))
+			fingerprints[name] = fingerprint;
+		file.close();
+
+		std::error_code errorCode;
+		std::filesystem::remove(filepath, errorCode);
+		return fingerprints;
+	}
+
+	static bool start(SessionsHistory* sessionsHistory, unsigned long long maxSizeOfSession) {
+		//журнал, який репліка вже застосувала повністю, починається заново з новим ідентифікатором, інакше дописується;
+		//сеанси, копія яких у резервній директорії відсутня або відрізняється вмістом, відправляються цілим текстом;
+		//потокові сеанси не реплікуються, і їхні копії прибираються з резервної директорії
+		std::lock_guard<std::mutex> lock(streamMutex);
+		ReplicationLog::sessionsHistory = sessionsHistory;
+		ReplicationLog::maxSizeOfSession = maxSizeOfSession;
+		std::string filepath = standbyDirectory + "\\" + LOG_FILENAME, appliedIdentifier;
+		unsigned long long appliedOffset = 0;
+		std::error_code errorCode;
+		std::filesystem::create_directories(standbyDirectory, errorCode);
+		std::ifstream(standbyDirectory + "\\" + APPLIED_FILENAME) >> appliedIdentifier >> appliedOffset;
+
+		std::string identifier = readIdentifierOfLog(filepath);
+		unsigned long long sizeOfLog = std::filesystem::file_size(filepath, errorCode);
+		bool isNewLog = identifier.empty() || (identifier == appliedIdentifier && !errorCode && appliedOffset == sizeOfLog);
+		stream.open(filepath, std::ios::binary | (isNewLog ? std::ios::trunc : std::ios::app));
+		if (!stream.is_open())
+			return false;
+
+		if (isNewLog)
+			write({ "LOG", 0, 0, std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count()) });
+		write({ "MODE", 0, 0, Editor::isUtf8Mode() ? "UTF8" : "BYTES" });
+
+		std::unordered_set<std::string> namesOfSessions;
+		std::map<std::string, std::string> shippedFingerprints = readShippedFingerprints();
+		sessionsHistory->forEachSession([&](Session* session) {
+			std::string name = session->getName();
+			unsigned long long sizeOfData = FilesManager::getSizeOfSessionData(name);
+			if (sizeOfData >= maxSizeOfSession)
+				return;
+			namesOfSessions.insert(name);
+
+			//текст, не змінений після чистої зупинки журналу, вже описаний журналом, тому нічого не читається;
+			//інакше розмір порівнюється першим, щоб не читати копію, яка точно відрізняється, а при однаковому - вміст
+			std::string fingerprint = FilesManager::getFingerprintOfSessionData(name);
+			auto shippedIter = shippedFingerprints.find(name);
+			if (!fingerprint.empty() && shippedIter != shippedFingerprints.end() && shippedIter->second == fingerprint)
+				return;
+			std::string filepathOnStandby = standbyDirectory + "\\" + FilesManager::getSessionsDirectory() + name;
+			auto sizeOnStandby = std::filesystem::file_size(filepathOnStandby, errorCode);
+			if (!errorCode && sizeOnStandby == sizeOfData &&
+				FilesManager::readSessionData(filepathOnStandby) == FilesManager::readSessionDataByName(name))
+				return;
+
+			write({ "CREATESESSION", 0, 0, name });
+			write({ "OPEN", 0, 0, name });
+			write({ "LOAD", 0, 0, FilesManager::readSessionDataByName(name) });
+			});
+		if (std::filesystem::exists(standbyDirectory + "\\" + FilesManager::getSessionsDirectory(), errorCode))
+			for (const auto& entry : std::filesystem::directory_iterator(standbyDirectory + "\\" + FilesManager::getSessionsDirectory(), errorCode))
+				if (namesOfSessions.find(entry.path().filename().string()) == namesOfSessions.end())
+					write({ "DELETESESSION", 0, 0, entry.path().filename().string() });
+
+		stream.flush();
+		lastSession = nullptr;
+		isActive = true;
+		return true;
+	}
+	static void stop() {
+		//після чистої зупинки журнал описує всі тексти, тому їхні відбитки зберігаються для наступного запуску
+		std::lock_guard<std::mutex> lock(streamMutex);
+		if (!isActive)
+			return;
+		isActive = false;
+		stream.close();
+		if (!stream)
+			return;
+
+		std::string shipped;
+		sessionsHistory->forEachSession([&](Session* session) {
+			std::string name = session->getName(), fingerprint = FilesManager::getFingerprintOfSessionData(name);
+			if (!fingerprint.empty() && FilesManager::getSizeOfSessionData(name) < maxSizeOfSession)
+				shipped += name + "\n" + fingerprint + "\n";
+			});
+		std::ofstream(standbyDirectory + "\\" + SHIPPED_FILENAME, std::ios::binary | std::ios::trunc) << shipped;
+	}
+
+	static void recordCreation(std::string name) {
+		if (!isActive)
+			return;
+		std::lock_guard<std::mutex> lock(streamMutex);
+		write({ "CREATESESSION", 0, 0, name });
+		stream.flush();
+	}
+	static void recordDeletion(std::string name) {
+		//адресу видаленого сеансу може отримати новий, тому наступна зміна обов'язково вкаже сеанс
+		if (!isActive)
+			return;
+		std::lock_guard<std::mutex> lock(streamMutex);
+		write({ "DELETESESSION", 0, 0, name });
+		lastSession = nullptr;
+		stream.flush();
+	}
+	static void recordChange(Session* session, const std::string& textBefore, const std::string& textAfter, Utf8Index::Splice splice) {
+		//відправляється лише змінена ділянка; для команд, які замінюють весь текст, вона шукається порівнянням версій
+		if (!isActive)
+			return;
+		if (splice.isWholeText) {
+			std::pair<size_t, size_t> changedRange = Editor::findChangedRange(textBefore, textAfter);
+			splice.position = changedRange.first;
+			splice.insertedLength = changedRange.second - changedRange.first;
+			splice.removedLength = textBefore.size() - (textAfter.size() - changedRange.second) - changedRange.first;
+		}
+		if (splice.removedLength == 0 && splice.insertedLength == 0)
+			return;
+
+		std::lock_guard<std::mutex> lock(streamMutex);
+		if (session != lastSession) {
+			write({ "OPEN", 0, 0, session->getName() });
+			lastSession = session;
+		}
+		write({ "EXTERNALCHANGE", (long long)splice.position, (long long)(splice.position + splice.removedLength),
+			textAfter.substr(splice.position, splice.insertedLength) });
+		stream.flush();
+	}
+};
+
+const std::string ReplicationLog::LOG_FILENAME = "Replication.log",
+ReplicationLog::APPLIED_FILENAME = "Replication.applied",
+ReplicationLog::SHIPPED_FILENAME = "Replication.shipped";
+std::string ReplicationLog::standbyDirectory;
+std::ofstream ReplicationLog::stream;
+std::mutex ReplicationLog::streamMutex;
+std::atomic<bool> ReplicationLog::isActive = false;
+Session* ReplicationLog::lastSession = nullptr;
+SessionsHistory* ReplicationLog::sessionsHistory = nullptr;
+unsigned long long ReplicationLog::maxSizeOfSession = ULLONG_MAX;
+unsigned long long ReplicationLog::countOfRecords = 0, ReplicationLog::countOfShippedBytes = 0;
+
+Editor::Editor() { this->sessionsHistory = new SessionsHistory(); }
+
+void Session::deleteLastCommand() {
+	//команди та їхні тексти лежать в арені, тому видалення - це лише відкат арени до позначки
+	sizeOfSpilledHistory -= commandsHistory.top()->getSizeOfSpilledText();
+	commandsArena.rewindTo(commandsMarks.top());
+	commandsMarks.pop();
+	commandsTimes.pop();
+	commandsHistory.pop();
+	if (commandsHistory.empty())
+		hasBaseSnapshot = false;
+	if (sizeOfSpilledHistory == 0)
+		spillFile.clear();
+}
+void Session::reallocateCommands(int indexOfFirstCommand, Command* baseCommand, long long timeOfBase) {
+	//записи, починаючи з indexOfFirstCommand, переносяться в нову арену (за потреби після базового знімка),
+	//тому пам'ять решти записів та текстів, які вже не потрібні, звільняється повністю;
+	//на час перебудови записи живуть в окремій арені, бо арена сеансу звільняється
+	SessionArena temporaryArena;
+	std::vector<Command*> keptCommands;
+	std::vector<long long> timesOfKeptCommands;
+	for (int i = indexOfFirstCommand; i < sizeOfCommandsHistory(); i++) {
+		keptCommands.push_back(getCommandByIndex(i)->copy(&temporaryArena));
+		timesOfKeptCommands.push_back(commandsTimes._Get_container()[i]);
+	}
+
+	commandsHistory = std::stack<Command*>();
+	commandsMarks = std::stack<SessionArena::Mark>();
+	commandsTimes = std::stack<long long>();
+	commandsArena.release();
+
+	Command* previousCommand = nullptr;
+	if (baseCommand) {
+		previousCommand = addCommandAsLast(baseCommand);
+		commandsTimes.top() = timeOfBase;
+	}
+	sizeOfSpilledHistory = 0;
+	for (int i = 0; i < keptCommands.size(); i++) {
+		keptCommands[i]->setPreviousCommand(previousCommand);
+		previousCommand = addCommandAsLast(keptCommands[i]);
+		commandsTimes.top() = timesOfKeptCommands[i];
+		sizeOfSpilledHistory += previousCommand->getSizeOfSpilledText();
+	}
+	if (sizeOfSpilledHistory == 0)
+		spillFile.clear();
+	else
+		rewriteSpillFileIfNeeded();
+}
+void Session::rewriteSpillFileIfNeeded() {
+	//знімки злитих записів і ті, що повернулись у пам'ять, лишаються у файлі мертвими байтами,
+	//тому файл переписується, коли їх стає більше, ніж живих; викликається під writerMutex
+	if (!spillFile.isWorthRewriting(sizeOfSpilledHistory))
+		return;
+
+	std::vector<Command*> spilledCommands;
+	std::vector<std::pair<unsigned long long, size_t>> liveTexts;
+	for (int i = 0; i < sizeOfCommandsHistory(); i++) {
+		Command* command = getCommandByIndex(i);
+		if (command->getSizeOfSpilledText() == 0)
+			continue;
+		spilledCommands.push_back(command);
+		liveTexts.push_back(std::pair(command->getOffsetInSpillFile(), command->getSizeOfSpilledText()));
+	}
+	if (!spillFile.rewrite(liveTexts))
+		return;
+	for (int i = 0; i < spilledCommands.size(); i++)
+		spilledCommands[i]->setOffsetInSpillFile(liveTexts[i].first);
+}
+unsigned long long Session::spillHistory(unsigned long long bytesToFree) {
+	//знімки найстаріших записів переносяться у файл, а записи лишаються в історії та читають текст з файлу за потреби;
+	//записи поблизу поточного не витісняються, бо звичайне скасування торкається саме їх
+	if (isTransactionActive || bytesToFree == 0)
+		return 0;
+
+	unsigned long long sizeOfSpilledTexts = 0;
+	int countOfSpilled = 0;
+	for (int i = 0; i < currentCommandIndexInHistory - COUNT_OF_RESIDENT_COMMANDS && sizeOfSpilledTexts < bytesToFree; i++) {
+		Command* command = getCommandByIndex(i);
+		size_t sizeOfText = command->getSizeOfResidentText();
+		if (sizeOfText == 0 || !command->spillText(&spillFile, name))
+			continue;
+		sizeOfSpilledTexts += sizeOfText;
+		countOfSpilled++;
+	}
+	if (countOfSpilled == 0)
+		return 0;
+
+	size_t usedBytesBefore = commandsArena.getStatistics().usedBytes;
+	reallocateCommands(0, nullptr, 0);
+	size_t usedBytesAfter = commandsArena.getStatistics().usedBytes;
+	return usedBytesBefore > usedBytesAfter ? usedBytesBefore - usedBytesAfter : 0;
+}
+Command* Session::addCommandAsLast(Command* command) {
+	//запис команди в історію - це виділення з арени сеансу, яке запам'ятовує позицію арени для відкату;
+	//перетворення, яке перестає бути останнім записом, отримує знімок, щоб тексти записів не відтворювались ланцюжком
+	if (!commandsHistory.empty()) {
+		TransformCommand* lastTransform = dynamic_cast<TransformCommand*>(commandsHistory.top());
+		if (lastTransform && !lastTransform->hasSnapshotOfText())
+			lastTransform->setTextToProcess(lastTransform->getTextToProcess());
+	}
+	commandsMarks.push(commandsArena.getMark());
+	commandsTimes.push(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+	commandsHistory.push(command->copy(&commandsArena));
+	return commandsHistory.top();
+}
+int Session::getCountOfCommandsToSquash(long long currentTime) {
+	//скільки найстаріших записів злити в базовий знімок, щоб історія вмістилась у межі політики;
+	//злити можна лише записи до поточного, інакше скасування вийшло б за базовий знімок;
+	//історія, яка вийшла за межу кількості чи розміру, стискається із запасом, щоб наступна команда знову не запускала стискання
+	RetentionPolicy policy = getRetentionPolicy();
+	int countOfCommands = sizeOfCommandsHistory(), countToSquash = 0;
+	if (policy.isUnlimited() || isTransactionActive || countOfCommands == 0)
+		return 0;
+
+	if (policy.maxCountOfCommands > 0 && countOfCommands > policy.maxCountOfCommands) {
+		int countOfKeptCommands = std::max(1, policy.maxCountOfCommands * PERCENT_OF_LIMIT_AFTER_COMPACTION / 100);
+		countToSquash = std::max(countToSquash, countOfCommands - countOfKeptCommands + 1);
+	}
+
+	if (policy.maxAgeInSeconds > 0) {
+		int countOfOldCommands = 0;
+		while (countOfOldCommands < countOfCommands &&
+			commandsTimes._Get_container()[countOfOldCommands] < currentTime - policy.maxAgeInSeconds)
+			countOfOldCommands++;
+		countToSquash = std::max(countToSquash, countOfOldCommands);
+	}
+
+	if (policy.maxSizeInBytes > 0 && commandsArena.getStatistics().usedBytes > policy.maxSizeInBytes) {
+		//базовий знімок займає приблизно стільки ж, скільки запис, з якого він зроблений, бо записи зберігають знімки тексту
+		unsigned long long sizeOfKeptCommands = 0, maxSizeOfKeptCommands = policy.maxSizeInBytes / 100 * PERCENT_OF_LIMIT_AFTER_COMPACTION;
+		int indexOfCommand = countOfCommands - 1;
+		while (indexOfCommand >= 0 && sizeOfKeptCommands + getSizeOfCommand(indexOfCommand) <= maxSizeOfKeptCommands)
+			sizeOfKeptCommands += getSizeOfCommand(indexOfCommand--);
+		if (indexOfCommand >= 0)
+			countToSquash = std::max(countToSquash, indexOfCommand + 2);
+	}
+
+	countToSquash = std::min(countToSquash, currentCommandIndexInHistory + 1);
+	return countToSquash >= 2 ? countToSquash : 0;
+}
+int Session::compactHistory(Editor* editor) {
+	std::lock_guard<std::mutex> writerLock(writerMutex);
+	return compactLockedHistory(editor);
+}
+int Session::compactLockedHistory(Editor* editor) {
+	//найстаріші записи замінюються одним базовим знімком стану, а решта переноситься в арену заново,
+	//тому пам'ять злитих записів звільняється повністю; скасування працює в межах залишених записів
+	long long currentTime = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	int countToSquash = getCountOfCommandsToSquash(currentTime);
+	if (countToSquash == 0)
+		return 0;
+
+	BatchCommand baseCommand(editor);
+	try {
+		baseCommand.setTextToProcess(getCommandByIndex(countToSquash - 1)->getTextToProcess());
+	}
+	catch (const std::ios_base::failure&) {
+		//без знімка базовий запис не зробити, тому історія лишається як є
+		return 0;
+	}
+	reallocateCommands(countToSquash, &baseCommand, commandsTimes._Get_container()[countToSquash - 1]);
+
+	currentCommandIndexInHistory -= countToSquash - 1;
+	hasBaseSnapshot = true;
+	return countToSquash - 1;
+}
+
+bool Session::beginTransaction() {
+	std::lock_guard<std::mutex> writerLock(writerMutex);
+	if (isTransactionActive)
+		return false;
+
+	isTransactionActive = true;
+	textBeforeTransaction = *(Editor::getCurrentText());
+	CommandsRecorder::record(this, "Begin");
+	return true;
+}
+bool Session::commitTransaction(Editor* editor, bool isDataWritten) {
+	//усі команди пакета вже застосовані до тексту, тому в історію потрапляє лише підсумковий знімок,
+	//а файл переписується один раз
+	std::lock_guard<std::mutex> writerLock(writerMutex);
+	if (!isTransactionActive)
+		return false;
+
+	isTransactionActive = false;
+	CommandsRecorder::record(this, "Commit");
+	if (*(Editor::getCurrentText()) == textBeforeTransaction)
+		return true;
+
+	while (currentCommandIndexInHistory < sizeOfCommandsHistory() - 1)
+		deleteLastCommand();
+
+	BatchCommand batchCommand(editor);
+	batchCommand.setPreviousCommand(sizeOfCommandsHistory() > 0 ? getCommandByIndex(sizeOfCommandsHistory() - 1) : nullptr);
+	addCommandAsLast(&batchCommand)->setTextToProcess(*(Editor::getCurrentText()));
+	currentCommandIndexInHistory++;
+	ReplicationLog::recordChange(this, textBeforeTransaction, *(Editor::getCurrentText()), { 0, 0, 0, true });
+
+	textBeforeTransaction.clear();
+	return isDataWritten ? FilesManager::writeSessionData(name, *(Editor::getCurrentText())) : true;
+}
+bool Session::rollbackTransaction() {
+	std::lock_guard<std::mutex> writerLock(writerMutex);
+	if (!isTransactionActive)
+		return false;
+
+	isTransactionActive = false;
+	CommandsRecorder::record(this, "Rollback");
+	*(Editor::getCurrentText()) = textBeforeTransaction;
+	if (Editor::isUtf8Mode())
+		utf8Index.rebuild(textBeforeTransaction);
+	publishText(textBeforeTransaction);
+	textBeforeTransaction.clear();
+	return true;
+}
+
+void Editor::copy(std::string_view textToProcess, int startPosition, int endPosition) {
+	//копіюється лише сам фрагмент, тому вартість не залежить від розміру тексту
+	ProfilerScope profilerScope("Editor::copy");
+	std::string_view dataToCopy = textToProcess.substr(startPosition, endPosition + getLengthOfCharacterAt(textToProcess, endPosition) - startPosition);
+	currentSession->addDataToClipboard(std::string(dataToCopy));
+}
+void Editor::paste(std::pmr::string* textToProcess, int startPosition, int endPosition, std::string_view textToPaste) {
+	ProfilerScope profilerScope("Editor::paste");
+	//позиції вказують на перший байт символу (у режимі UTF-8 символ може займати кілька байтів)
+	size_t startOfLastCharacter = getStartOfLastCharacter(*textToProcess);
+	size_t position = startPosition, removedLength;
+
+	if (startPosition == endPosition) {
+		if (startPosition == 0)
+			position = removedLength = 0;
+		else if (startPosition >= startOfLastCharacter) {
+			position = textToProcess->size();
+			removedLength = 0;
+		}
+		else
+			removedLength = endPosition + getLengthOfCharacterAt(*textToProcess, endPosition) - startPosition;
+	}
+	else
+	{
+		if (endPosition == -1) {
+			position = 0;
+			removedLength = getLengthOfCharacterAt(*textToProcess, 0);
+		}
+		else if (endPosition == textToProcess->size()) {
+			position = startOfLastCharacter;
+			removedLength = textToProcess->size() - startOfLastCharacter;
+		}
+		else
+			removedLength = endPosition + getLengthOfCharacterAt(*textToProcess, endPosition) - startPosition;
+	}
+
+	position = std::min(position, textToProcess->size());
+	removedLength = std::min(removedLength, textToProcess->size() - position);
+	(*textToProcess).replace(position, removedLength, textToPaste);
+	lastSplice = { position, removedLength, textToPaste.size(), false };
+	*currentText = *textToProcess;
+}
+void Editor::cut(std::pmr::string* textToProcess, int startPosition, int endPosition) {
+	ProfilerScope profilerScope("Editor::cut");
+	copy(*textToProcess, startPosition, endPosition);
+	remove(textToProcess, startPosition, endPosition);
+	*currentText = *textToProcess;
+}
+void Editor::remove(std::pmr::string* textToProcess, int startPosition, int endPosition) {
+	ProfilerScope profilerScope("Editor::remove");
+	size_t removedLength = std::min(endPosition + getLengthOfCharacterAt(*textToProcess, endPosition) - startPosition,
+		textToProcess->size() - startPosition);
+	(*textToProcess).erase(startPosition, removedLength);
+	lastSplice = { (size_t)startPosition, removedLength, 0, false };
+	*currentText = *textToProcess;
+}
+void Editor::replaceRange(std::pmr::string* textToProcess, int startPosition, int endPosition, std::string_view textToInsert) {
+	ProfilerScope profilerScope("Editor::replaceRange");
+	//на відміну від вставки, межі точні: замінюються байти [початок, кінець)
+	size_t position = std::min((size_t)startPosition, textToProcess->size());
+	size_t removedLength = std::min((size_t)endPosition, textToProcess->size()) - position;
+	(*textToProcess).replace(position, removedLength, textToInsert);
+	lastSplice = { position, removedLength, textToInsert.size(), false };
+	*currentText = *textToProcess;
+}
+void Editor::sortLines(std::pmr::string* textToProcess) {
+	ProfilerScope profilerScope("Editor::sortLines");
+	std::vector<std::string_view> lines = splitIntoLines(*textToProcess);
+	sortLineViews(lines);
+	replaceByLines(textToProcess, lines);
+}
+void Editor::uniqueLines(std::pmr::string* textToProcess) {
+	//залишається перше входження кожного рядка, порядок рядків не змінюється
+	ProfilerScope profilerScope("Editor::uniqueLines");
+	std::vector<std::string_view> lines = splitIntoLines(*textToProcess), uniqueLines;
+	std::unordered_set<std::string_view> seenLines(lines.size());
+
+	for (std::string_view line : lines)
+		if (seenLines.insert(line).second)
+			uniqueLines.push_back(line);
+	replaceByLines(textToProcess, uniqueLines);
+}
+void Editor::filterLines(std::pmr::string* textToProcess, std::string_view pattern, bool isMatchingKept) {
+	ProfilerScope profilerScope("Editor::filterLines");
+	std::vector<std::string_view> lines = splitIntoLines(*textToProcess), filteredLines;
+
+	for (std::string_view line : lines)
+		if ((line.find(pattern) != std::string_view::npos) == isMatchingKept)
+			filteredLines.push_back(line);
+	replaceByLines(textToProcess, filteredLines);
+}
+
+Session* Editor::getCurrentSession() { return currentSession; }
+std::string* Editor::getCurrentText() { return currentText; }
+SessionsHistory* Editor::getSessionsHistory() { return sessionsHistory; }
+void Editor::setCurrentSession(Session* session) { currentSession = session; }
+void Editor::setCurrentText(std::string* text) { currentText = text; }
+std::shared_ptr<const std::string> Editor::getCurrentTextSnapshot() { return currentSession->getTextSnapshot(); }
+void Editor::setUtf8Enabled(bool isUtf8Enabled) { Editor::isUtf8Enabled = isUtf8Enabled; }
+bool Editor::isUtf8Mode() { return isUtf8Enabled; }
+void Editor::resetLastSplice() { lastSplice = { 0, 0, 0, true }; }
+Utf8Index::Splice Editor::getLastSplice() { return lastSplice; }
+
+size_t Editor::getLengthOfCharacterAt(std::string_view text, size_t position) {
+	return isUtf8Enabled ? Utf8Index::getLengthOfCharacterAt(text, position) : 1;
+}
+size_t Editor::getStartOfLastCharacter(std::string_view text) {
+	if (!isUtf8Enabled)
+		return text.empty() ? 0 : text.size() - 1;
+	return Utf8Index::getStartOfLastCharacter(text);
+}
+
+std::vector<std::string_view> Editor::splitIntoLines(std::string_view text) {
+	//рядки - це лише вікна в текст сеансу, тому окремі рядки не виділяються в пам'яті;
+	//символ кінця рядка після останнього рядка не утворює ще одного порожнього рядка
+	std::vector<std::string_view> lines;
+	size_t startOfLine = 0;
+	while (startOfLine < text.size()) {
+		const char* endOfLine = (const char*)memchr(text.data() + startOfLine, '\n', text.size() - startOfLine);
+		size_t lengthOfLine = endOfLine ? endOfLine - text.data() - startOfLine : text.size() - startOfLine;
+		lines.push_back(text.substr(startOfLine, lengthOfLine));
+		startOfLine += lengthOfLine + 1;
+	}
+	return lines;
+}
+void Editor::replaceByLines(std::pmr::string* textToProcess, const std::vector<std::string_view>& lines) {
+	//рядки вказують на textToProcess, тому новий текст збирається окремо і лише потім займає його місце
+	bool hasFinalNewline = !textToProcess->empty() && textToProcess->back() == '\n';
+	std::pmr::string newText(textToProcess->get_allocator());
+	newText.reserve(textToProcess->size());
+
+	for (size_t i = 0; i < lines.size(); i++) {
+		newText += lines[i];
+		if (i + 1 < lines.size() || hasFinalNewline)
+			newText += '\n';
+	}
+
+	*textToProcess = std::move(newText);
+	lastSplice = { 0, 0, 0, true };
+	*currentText = *textToProcess;
+}
+void Editor::sortLineViews(std::vector<std::string_view>& lines) {
+	//кожен потік сортує свою частину, після чого сусідні частини зливаються попарно (теж паралельно),
+	//поки не залишиться одна; рядки порівнюються побайтово, тож у UTF-8 це порядок кодів символів
+	std::vector<SortedLine> sortedLines(lines.size());
+	for (size_t i = 0; i < lines.size(); i++) {
+		unsigned long long prefix = 0;
+		for (size_t j = 0; j < 8; j++)
+			prefix = prefix << 8 | (j < lines[i].size() ? (unsigned char)lines[i][j] : 0);
+		sortedLines[i] = { prefix, lines[i] };
+	}
+	auto isLess = [](const SortedLine& first, const SortedLine& second) {
+		return first.prefix < second.prefix || first.prefix == second.prefix && first.line < second.line;
+	};
+
+	int countOfParts = (int)std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), lines.size() / MIN_COUNT_OF_LINES_FOR_THREAD);
+	countOfParts = std::max(countOfParts, 1);
+	std::vector<size_t> bounds;
+	for (int i = 0; i <= countOfParts; i++)
+		bounds.push_back(lines.size() * i / countOfParts);
+
+	std::vector<std::thread> workers;
+	if (countOfParts == 1)
+		std::sort(sortedLines.begin(), sortedLines.end(), isLess);
+	else
+		for (int i = 0; i < countOfParts; i++)
+			workers.emplace_back([&sortedLines, &bounds, isLess, i]() {
+				std::sort(sortedLines.begin() + bounds[i], sortedLines.begin() + bounds[i + 1], isLess);
+				});
+	for (auto& worker : workers)
+		worker.join();
+
+	std::vector<SortedLine> mergedLines(countOfParts > 1 ? lines.size() : 0);
+	while (bounds.size() > 2) {
+		std::vector<size_t> mergedBounds;
+		workers.clear();
+		for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+			mergedBounds.push_back(bounds[i]);
+			size_t end = i + 2 < bounds.size() ? bounds[i + 2] : bounds[i + 1];
+			size_t middle = i + 2 < bounds.size() ? bounds[i + 1] : end;
+			workers.emplace_back([&sortedLines, &mergedLines, isLess, start = bounds[i], middle, end]() {
+				std::merge(sortedLines.begin() + start, sortedLines.begin() + middle, sortedLines.begin() + middle, sortedLines.begin() + end,
+					mergedLines.begin() + start, isLess);
+				});
+		}
+		mergedBounds.push_back(bounds.back());
+		for (auto& worker : workers)
+			worker.join();
+
+		sortedLines.swap(mergedLines);
+		bounds = mergedBounds;
+	}
+
+	for (size_t i = 0; i < lines.size(); i++)
+		lines[i] = sortedLines[i].line;
+}
+
+std::pair<size_t, size_t> Editor::findChangedRange(const std::string& textBefore, const std::string& textAfter) {
+	//повертає діапазон [початок, кінець) у новому тексті, який відрізняється від старого
+	size_t sizeOfPrefix = 0, sizeOfSuffix = 0;
+	size_t minSize = std::min(textBefore.size(), textAfter.size());
+
+	while (sizeOfPrefix < minSize && textBefore[sizeOfPrefix] == textAfter[sizeOfPrefix])
+		sizeOfPrefix++;
+	while (sizeOfSuffix < minSize - sizeOfPrefix &&
+		textBefore[textBefore.size() - 1 - sizeOfSuffix] == textAfter[textAfter.size() - 1 - sizeOfSuffix])
+		sizeOfSuffix++;
+
+	return std::pair(sizeOfPrefix, textAfter.size() - sizeOfSuffix);
+}
+
+void Editor::printCurrentText() {
+	ProfilerScope profilerScope("Editor::printCurrentText");
+	system("cls");
+	std::shared_ptr<const std::string> text = getCurrentTextSnapshot();
+	std::cout << "\nЗміст файлу " << currentSession->getName() << ":\n";
+	*text != "" ? 
+		std::cout << "\"" << *text << "\"\n" : 
+		std::cout << "\nФайл пустий!\n";
+	if (isUtf8Enabled && *text != "")
+		std::cout << "Символів: " << currentSession->getUtf8Index()->getCountOfCodePoints() << ", байтів: " << text->size() << "\n";
+}
+
+SessionsHistory* Editor::sessionsHistory;
+thread_local Session* Editor::currentSession;
+thread_local std::string* Editor::currentText;
+thread_local Utf8Index::Splice Editor::lastSplice = { 0, 0, 0, true };
+bool Editor::isUtf8Enabled = false;
+const size_t Editor::MIN_COUNT_OF_LINES_FOR_THREAD = 64 * 1024;
+
+CopyCommand::CopyCommand(Editor* editor) { this->editor = editor; }
+
+void CopyCommand::execute() {
+	//знімок лише утримується, поки з нього читається фрагмент, а не копіюється
+	std::shared_ptr<const std::string> text = Editor::getCurrentTextSnapshot();
+	editor->copy(*text, startPosition, endPosition);
+}
+void CopyCommand::undo() { }
+Command* CopyCommand::copy(SessionArena* arena) { return nullptr; }
+
+DeleteCommand::DeleteCommand(Editor* editor) { this->editor = editor; }
+
+void DeleteCommand::execute() { editor->remove(&textToProcess, startPosition, endPosition); }
+void DeleteCommand::undo() {
+	if (previousCommand)
+		*(Editor::getCurrentText()) = previousCommand->getTextToProcess();
+	else
+		*(Editor::getCurrentText()) = "";
+}
+Command* DeleteCommand::copy(SessionArena* arena) { return arena->create<DeleteCommand>(*this, arena); }
+
+CutCommand::CutCommand(Editor* editor) { this->editor = editor; }
+
+void CutCommand::execute() { editor->cut(&textToProcess, startPosition, endPosition); }
+void CutCommand::undo() {
+	if (previousCommand)
+		*(Editor::getCurrentText()) = previousCommand->getTextToProcess();
+	else
+		*(Editor::getCurrentText()) = "";
+}
+Command* CutCommand::copy(SessionArena* arena) { return arena->create<CutCommand>(*this, arena); }
+
+PasteCommand::PasteCommand(Editor* editor) { this->editor = editor; }
+
+void PasteCommand::execute() { editor->paste(&textToProcess, startPosition, endPosition, textToPaste); }
+void PasteCommand::undo() {
+	if (previousCommand)
+		*(Editor::getCurrentText()) = previousCommand->getTextToProcess();
+	else
+		*(Editor::getCurrentText()) = "";
+}
+Command* PasteCommand::copy(SessionArena* arena) { return arena->create<PasteCommand>(*this, arena); }
+
+BatchCommand::BatchCommand(Editor* editor) {
+	this->editor = editor;
+	this->previousCommand = nullptr;
+}
+
+void BatchCommand::execute() { *(Editor::getCurrentText()) = textToProcess; }
+void BatchCommand::undo() {
+	if (previousCommand)
+		*(Editor::getCurrentText()) = previousCommand->getTextToProcess();
+	else
+		*(Editor::getCurrentText()) = "";
+}
+Command* BatchCommand::copy(SessionArena* arena) { return arena->create<BatchCommand>(*this, arena); }
+
+SortLinesCommand::SortLinesCommand(Editor* editor) { this->editor = editor; }
+
+void SortLinesCommand::execute() { editor->sortLines(&textToProcess); }
+void SortLinesCommand::undo() {
+	if (previousCommand)
+		*(Editor::getCurrentText()) = previousCommand->getTextToProcess();
+	else
+		*(Editor::getCurrentText()) = "";
+}
+Command* SortLinesCommand::copy(SessionArena* arena) { return arena->create<SortLinesCommand>(*this, arena); }
+
+UniqueLinesCommand::UniqueLinesCommand(Editor* editor) { this->editor = editor; }
+
+void UniqueLinesCommand::execute() { editor->uniqueLines(&textToProcess); }
+void UniqueLinesCommand::undo() {
+	if (previousCommand)
+		*(Editor::getCurrentText()) = previousCommand->getTextToProcess();
+	else
+		*(Editor::getCurrentText()) = "";
+}
+Command* UniqueLinesCommand::copy(SessionArena* arena) { return arena->create<UniqueLinesCommand>(*this, arena); }
+
+FilterLinesCommand::FilterLinesCommand(Editor* editor, bool isMatchingKept) {
+	this->editor = editor;
+	this->isMatchingKept = isMatchingKept;
+}
+
+void FilterLinesCommand::execute() { editor->filterLines(&textToProcess, textToPaste, isMatchingKept); }
+void FilterLinesCommand::undo() {
+	if (previousCommand)
+		*(Editor::getCurrentText()) = previousCommand->getTextToProcess();
+	else
+		*(Editor::getCurrentText()) = "";
+}
+Command* FilterLinesCommand::copy(SessionArena* arena) { return arena->create<FilterLinesCommand>(*this, arena); }
+
+TransformCommand::TransformCommand(Editor* editor, TextTransforms::Transform transform) {
+	this->editor = editor;
+	this->transform = transform;
+	hasUndoData = false;
+	hasSnapshot = false;
+	isUtf8Mode = Editor::isUtf8Mode();
+}
 
-	void execute() override;
-	void undo() override;
-	Command* copy() override;
+void TransformCommand::execute() {
+	//текст після команди відтворюється з тексту попередньої, тому знімок зберігається лише для першої команди історії
+	std::string newUndoData;
+	isUtf8Mode = Editor::isUtf8Mode();
+	TextTransforms::apply(transform, *(Editor::getCurrentText()), isUtf8Mode, &newUndoData);
+	undoData = newUndoData;
+	hasUndoData = true;
+	hasSnapshot = !previousCommand;
+	textToProcess = previousCommand ? "" : *(Editor::getCurrentText());
+}
+void TransformCommand::undo() {
+	if (!previousCommand)
+		*(Editor::getCurrentText()) = "";
+	else if (hasUndoData)
+		TextTransforms::revert(transform, *(Editor::getCurrentText()), undoData);
+	else
+		*(Editor::getCurrentText()) = previousCommand->getTextToProcess();
+}
+void TransformCommand::redo() {
+	if (previousCommand)
+		TextTransforms::apply(transform, *(Editor::getCurrentText()), isUtf8Mode, nullptr);
+	else
+		*(Editor::getCurrentText()) = Command::getTextToProcess();
+}
+void TransformCommand::setTextToProcess(std::string textToProcess) {
+	Command::setTextToProcess(textToProcess);
+	hasSnapshot = true;
+}
+Command* TransformCommand::copy(SessionArena* arena) { return arena->create<TransformCommand>(*this, arena); }
+std::string TransformCommand::getTextToProcess() {
+	//відтворюється з попереднього запису лише остання команда історії, старіші вже мають знімок (Session::addCommandAsLast)
+	if (hasSnapshot || !previousCommand)
+		return Command::getTextToProcess();
+
+	std::string text = previousCommand->getTextToProcess();
+	TextTransforms::apply(transform, text, isUtf8Mode, nullptr);
+	return text;
+}
+
+void Command::redo() { *(Editor::getCurrentText()) = getTextToProcess(); }
+
+ExternalChangeCommand::ExternalChangeCommand(Editor* editor) { this->editor = editor; }
+
+void ExternalChangeCommand::execute() { editor->replaceRange(&textToProcess, startPosition, endPosition, textToPaste); }
+void ExternalChangeCommand::undo() {
+	if (previousCommand)
+		*(Editor::getCurrentText()) = previousCommand->getTextToProcess();
+	else
+		*(Editor::getCurrentText()) = "";
+}
+Command* ExternalChangeCommand::copy(SessionArena* arena) { return arena->create<ExternalChangeCommand>(*this, arena); }
+
+void UndoCommand::execute() { commandToUndoOrRedo->undo(); }
+void UndoCommand::undo() { }
+Command* UndoCommand::copy(SessionArena* arena) { return nullptr; }
+
+void RedoCommand::execute() { commandToUndoOrRedo->redo(); }
+void RedoCommand::undo() { }
+Command* RedoCommand::copy(SessionArena* arena) { return nullptr; }
+
+class CommandsManager {
+private:
+	static const int COALESCING_TIME_WINDOW_IN_MS, //максимальна пауза між командами, які ще можна об'єднати в один запис історії
+		COALESCING_SIZE_WINDOW; //максимальна кількість байтів, які може змінити один об'єднаний запис історії
+
+	std::stack<std::pair<std::string, Command*>> manager; //зберігач усіх команд, дозволяє зручно їми керувати за допомогою поліморфізму
+	bool isCoalescingEnabled, wasLastCommandCoalesced; //чи об'єднуються сусідні вставки/видалення та чи була об'єднана остання команда
+	std::string typeOfCoalescingGroup; //тип команд у поточній групі об'єднання ("" - групи немає)
+	Session* sessionOfCoalescingGroup; //сеанс, в якому була створена група
+	std::chrono::steady_clock::time_point timeOfLastCoalescing; //час останньої команди групи
+	int startOfCoalescingRange, endOfCoalescingRange, sizeOfCoalescedData; //ділянка тексту, яку змінила група, та обсяг змінених байтів
+
+	Command* getCommandFromManagerByKey(std::string typeOfCommand) {
+		for (int i = 0; i < manager.size(); i++)
+			if (manager._Get_container()[i].first == typeOfCommand)
+				return manager._Get_container()[i].second;
+	}
+	bool isNotUndoOrRedoCommand(std::string typeOfCommand) { return typeOfCommand != "Undo" && typeOfCommand != "Redo"; }
+	void setParametersForCommand(std::string typeOfCommand, int startPosition, int endPosition, std::string textToPaste) {
+		Command* commandToUndoOrRedo = nullptr, * previousCommand = nullptr;
+
+		if (typeOfCommand == "Undo")
+			commandToUndoOrRedo = Editor::getCurrentSession()->getCommandByIndex(Editor::getCurrentSession()->getCurIndexInCommHistory());
+
+		if(typeOfCommand == "Redo")
+			commandToUndoOrRedo = Editor::getCurrentSession()->getCommandByIndex(Editor::getCurrentSession()->getCurIndexInCommHistory() + 1);
+
+		if (Editor::getCurrentSession()->getCurIndexInCommHistory() != -1 && isNotUndoOrRedoCommand(typeOfCommand))
+			previousCommand = Editor::getCurrentSession()->getCommandByIndex(Editor::getCurrentSession()->sizeOfCommandsHistory() - 1);
+
+		
+
+		getCommandFromManagerByKey(typeOfCommand)->setParameters(typeOfCommand, previousCommand, commandToUndoOrRedo, startPosition, endPosition, textToPaste);
+	}
+	int getCountOfForwardCommands() {
+		return Editor::getCurrentSession()->sizeOfCommandsHistory() - 1 - Editor::getCurrentSession()->getCurIndexInCommHistory();
+	}
+	void deleteForwardCommandsIfNecessary(std::string typeOfCommand) {
+		if (typeOfCommand != "Undo" && typeOfCommand != "Redo" && isThereAnyCommandForward())
+		{
+			int countOfForwardCommands = getCountOfForwardCommands();
+			for (int i = 0; i < countOfForwardCommands; i++)
+				Editor::getCurrentSession()->deleteLastCommand();
+		}
+	}
+
+	void resetCoalescingGroup() {
+		typeOfCoalescingGroup = "";
+		sessionOfCoalescingGroup = nullptr;
+	}
+	void startCoalescingGroup(std::string typeOfCommand, std::pair<int, int> changedRange, int sizeOfChange) {
+		typeOfCoalescingGroup = typeOfCommand;
+		sessionOfCoalescingGroup = Editor::getCurrentSession();
+		timeOfLastCoalescing = std::chrono::steady_clock::now();
+		startOfCoalescingRange = changedRange.first;
+		endOfCoalescingRange = changedRange.second;
+		sizeOfCoalescedData = sizeOfChange;
+	}
+	bool tryToCoalesceWithLastCommand(std::string typeOfCommand) {
+		//замість нового запису історії оновлює знімок тексту в останньому, якщо команда продовжує попередню
+		//(та сама сесія й тип, невелика пауза, суміжна ділянка тексту); скасування повертає стан до початку групи
+		Session* session = Editor::getCurrentSession();
+
+		//будь-яка інша команда закриває групу, інакше наступна вставка потрапила б у її запис історії
+		if (!isCoalescingEnabled || (typeOfCommand != "Paste" && typeOfCommand != "Delete")) {
+			resetCoalescingGroup();
+			return false;
+		}
+
+		//змінену ділянку вже записала сама команда, тому тексти до і після неї не копіюються й не порівнюються
+		Command* lastCommand = session->sizeOfCommandsHistory() > 0 ?
+			session->getCommandByIndex(session->sizeOfCommandsHistory() - 1) : nullptr;
+		Utf8Index::Splice splice = Editor::getLastSplice();
+		std::pair<int, int> changedRange((int)splice.position, (int)(splice.position + splice.insertedLength));
+		int sizeOfChange = typeOfCommand == "Paste" ? (int)splice.insertedLength : (int)splice.removedLength;
+
+		auto timeSinceLastCommand = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - timeOfLastCoalescing).count();
+
+		bool canBeCoalesced = lastCommand &&
+			typeOfCoalescingGroup == typeOfCommand &&
+			sessionOfCoalescingGroup == session &&
+			session->getCurIndexInCommHistory() == session->sizeOfCommandsHistory() - 1 &&
+			timeSinceLastCommand <= COALESCING_TIME_WINDOW_IN_MS &&
+			sizeOfCoalescedData + sizeOfChange <= COALESCING_SIZE_WINDOW &&
+			changedRange.first >= startOfCoalescingRange - 1 && changedRange.first <= endOfCoalescingRange;
+
+		if (!canBeCoalesced) {
+			startCoalescingGroup(typeOfCommand, changedRange, sizeOfChange);
+			return false;
+		}
+
+		lastCommand->setTextToProcess(*(Editor::getCurrentText()));
+
+		int shiftOfText = (int)splice.insertedLength - (int)splice.removedLength;
+		if (endOfCoalescingRange > changedRange.first)
+			endOfCoalescingRange = std::max(endOfCoalescingRange + shiftOfText, changedRange.first);
+		startOfCoalescingRange = std::min(startOfCoalescingRange, changedRange.first);
+		endOfCoalescingRange = std::max(endOfCoalescingRange, changedRange.second);
+		sizeOfCoalescedData += sizeOfChange;
+		timeOfLastCoalescing = std::chrono::steady_clock::now();
+
+		return true;
+	}
+
+	void executeAndRecordCommand(std::string typeOfCommand, int startPosition, int endPosition, std::string textToPaste) {
+		if (Editor::getCurrentSession()->isInTransaction()) {
+			invokeCommandInTransaction(typeOfCommand, startPosition, endPosition, textToPaste);
+			return;
+		}
+
+		deleteForwardCommandsIfNecessary(typeOfCommand);
+		setParametersForCommand(typeOfCommand, startPosition, endPosition, textToPaste);
+
+		{
+			ProfilerScope executionProfilerScope("Command::execute");
+			getCommandFromManagerByKey(typeOfCommand)->execute();
+		}
+
+		ProfilerScope recordingProfilerScope("CommandsManager::recordHistory");
+		wasLastCommandCoalesced = false;
+		if (!isNotUndoOrRedoCommand(typeOfCommand))
+			resetCoalescingGroup();
+		else if (typeOfCommand != "Copy" && tryToCoalesceWithLastCommand(typeOfCommand)) {
+			wasLastCommandCoalesced = true;
+			return;
+		}
+
+		if (isNotUndoOrRedoCommand(typeOfCommand) && typeOfCommand != "Copy")
+			Editor::getCurrentSession()->addCommandAsLast(getCommandFromManagerByKey(typeOfCommand));
+
+		if(typeOfCommand == "Undo")
+			Editor::getCurrentSession()->setCurIndexInCommHistory(Editor::getCurrentSession()->getCurIndexInCommHistory() - 1);
+		else
+			if (typeOfCommand != "Copy")
+				Editor::getCurrentSession()->setCurIndexInCommHistory(Editor::getCurrentSession()->getCurIndexInCommHistory() + 1);
+	}
+
+public:
+	CommandsManager(Editor* editor) {
+		manager.push(std::pair("Copy", new CopyCommand(editor)));
+		manager.push(std::pair("Paste", new PasteCommand(editor)));
+		manager.push(std::pair("Cut", new CutCommand(editor)));
+		manager.push(std::pair("Delete", new DeleteCommand(editor)));
+		manager.push(std::pair("Undo", new UndoCommand()));
+		manager.push(std::pair("Redo", new RedoCommand()));
+		manager.push(std::pair("SortLines", new SortLinesCommand(editor)));
+		manager.push(std::pair("UniqueLines", new UniqueLinesCommand(editor)));
+		manager.push(std::pair("KeepLines", new FilterLinesCommand(editor, true)));
+		manager.push(std::pair("DropLines", new FilterLinesCommand(editor, false)));
+		manager.push(std::pair("ExternalChange", new ExternalChangeCommand(editor)));
+		for (int i = 0; i < TextTransforms::COUNT_OF_TRANSFORMS; i++)
+			manager.push(std::pair(TextTransforms::NAMES[i], new TransformCommand(editor, (TextTransforms::Transform)i)));
+
+		isCoalescingEnabled = true;
+		wasLastCommandCoalesced = false;
+		resetCoalescingGroup();
+	}
+	~CommandsManager() {
+		while (!manager.empty())
+		{
+			delete manager.top().second;
+			manager.pop();
+		}
+	}
+
+	bool isThereAnyCommandForward() {
+		return Editor::getCurrentSession()->sizeOfCommandsHistory() != 0 &&
+			Editor::getCurrentSession()->getCurIndexInCommHistory() < Editor::getCurrentSession()->sizeOfCommandsHistory() - 1;
+	}
+	void invokeCommandInTransaction(std::string typeOfCommand, int startPosition, int endPosition, std::string textToPaste) {
+		//у пакеті команди лише змінюють текст, запис в історію робить Session::commitTransaction
+		if (!isNotUndoOrRedoCommand(typeOfCommand))
+			return;
+
+		resetCoalescingGroup();
+		wasLastCommandCoalesced = false;
+		setParametersForCommand(typeOfCommand, startPosition, endPosition, textToPaste);
+		getCommandFromManagerByKey(typeOfCommand)->execute();
+	}
+	void setCoalescingEnabled(bool isCoalescingEnabled) {
+		this->isCoalescingEnabled = isCoalescingEnabled;
+		resetCoalescingGroup();
+	}
+	bool isLastCommandCoalesced() { return wasLastCommandCoalesced; }
+
+	bool invokeCommand(std::string typeOfCommand, int startPosition = 0, int endPosition = 0, std::string textToPaste = "") {
+		//копіювання лише читає опубліковану версію тексту і не торкається історії, тому не чекає на інші команди сеансу;
+		//решта команд виконуються по одній на сеанс і публікують нову версію тексту;
+		//повертає false, якщо команду не виконано (нема що скасувати або не прочитався витіснений знімок історії)
+		ProfilerScope profilerScope("CommandsManager::invokeCommand");
+		Session* session = Editor::getCurrentSession();
+
+		if (typeOfCommand == "Copy") {
+			CommandsRecorder::record(session, typeOfCommand, startPosition, endPosition);
+			Command* copyCommand = getCommandFromManagerByKey(typeOfCommand);
+			copyCommand->setParameters(typeOfCommand, nullptr, nullptr, startPosition, endPosition, "");
+			copyCommand->execute();
+			return true;
+		}
+
+		std::lock_guard<std::mutex> writerLock(session->getWriterMutex());
+		//історію могли стиснути у фоні після перевірки викликача, тому базовий знімок тут не скасовується
+		if (typeOfCommand == "Undo" && !session->canUndo())
+			return false;
+		CommandsRecorder::record(session, typeOfCommand, startPosition, endPosition,
+			typeOfCommand == "Paste" || typeOfCommand == "KeepLines" || typeOfCommand == "DropLines" || typeOfCommand == "ExternalChange" ? textToPaste : "");
+		std::shared_ptr<const std::string> textBefore = ReplicationLog::isReplicating() ? session->getTextSnapshot() : nullptr;
+		Editor::resetLastSplice();
+		try {
+			executeAndRecordCommand(typeOfCommand, startPosition, endPosition, textToPaste);
+		}
+		catch (const std::ios_base::failure&) {
+			//знімок читається до того, як текст чи позиція в історії змінюються, тому сеанс лишається в попередньому стані
+			return false;
+		}
+		if (Editor::isUtf8Mode())
+			session->getUtf8Index()->applySplice(*(Editor::getCurrentText()), Editor::getLastSplice());
+		session->publishText(*(Editor::getCurrentText()));
+		//зміни пакета команд відправляються в журнал реплікації одним записом при підтвердженні
+		if (textBefore && !session->isInTransaction())
+			ReplicationLog::recordChange(session, *textBefore, *(Editor::getCurrentText()), Editor::getLastSplice());
+		return true;
+	}
 };
 
-class UndoCommand : public Command {
+const int CommandsManager::COALESCING_TIME_WINDOW_IN_MS = 1000,
+CommandsManager::COALESCING_SIZE_WINDOW = 4096;
+
+class HistoryCompactor {
+private:
+	static const int INTERVAL_OF_CHECKS_IN_MS; //як часто перевіряти, чи не вийшла історія сеансів за межі політики
+
+	Editor* editor; //редактор, сеанси якого обслуговуються
+	std::thread worker; //фоновий потік стискання
+	std::mutex stopMutex; //захищає прапорець зупинки
+	std::condition_variable stopCondition; //будить потік, щоб він завершився без очікування інтервалу
+	bool isStopRequested; //чи треба завершити фоновий потік
+	std::atomic<int> countOfCompactions; //скільки разів історію сеансів було стиснуто
+	std::atomic<long long> countOfSquashedCommands; //скільки записів історії злито в базові знімки
+	std::atomic<unsigned long long> countOfFreedBytes; //скільки байтів пам'яті звільнено витісненням історії на диск
+
+	void run() {
+		std::unique_lock<std::mutex> lock(stopMutex);
+		while (!stopCondition.wait_for(lock, std::chrono::milliseconds(INTERVAL_OF_CHECKS_IN_MS), [this] { return isStopRequested; })) {
+			lock.unlock();
+			compactSessions();
+			lock.lock();
+		}
+	}
+
 public:
-	~UndoCommand() {
-		if (commandToUndoOrRedo)
-			delete (commandToUndoOrRedo);
+	struct Statistics {
+		int countOfCompactions;
+		long long countOfSquashedCommands;
+		unsigned long long countOfFreedBytes;
+	};
+
+	HistoryCompactor() {
+		editor = nullptr;
+		isStopRequested = false;
+		countOfCompactions = 0;
+		countOfSquashedCommands = 0;
+		countOfFreedBytes = 0;
 	}
+	~HistoryCompactor() { stop(); }
 
-	void execute() override;
-	void undo() override;
-	Command* copy() override;
+	void start(Editor* editor) {
+		stop();
+		this->editor = editor;
+		isStopRequested = false;
+		worker = std::thread(&HistoryCompactor::run, this);
+	}
+	void stop() {
+		if (!worker.joinable())
+			return;
+		{
+			std::lock_guard<std::mutex> lock(stopMutex);
+			isStopRequested = true;
+		}
+		stopCondition.notify_all();
+		worker.join();
+	}
+	void compactSessions() {
+		//імена сеансів збираються під блокуванням списку, а стискається кожен сеанс уже без нього, щоб запис тексту
+		//(SessionsHistory::updateSession) не чекав на стискання; сеанс, з яким саме працює команда, пропускається до наступної перевірки
+		for (std::string& name : editor->getSessionsHistory()->getNamesOfSessions()) {
+			std::unique_lock<std::mutex> writerLock;
+			Session* session = editor->getSessionsHistory()->tryToLockSession(name, writerLock);
+			if (!session)
+				continue;
+			int countOfSquashed = session->compactLockedHistory(editor);
+			if (countOfSquashed > 0) {
+				//довжина історії - одна з властивостей, за якими впорядковані перегляди сеансів
+				editor->getSessionsHistory()->updateSession(session, session->getSizeOfData(), session->sizeOfCommandsHistory(), session->getModificationTime());
+				countOfCompactions++;
+				countOfSquashedCommands += countOfSquashed;
+			}
+		}
+		spillSessions();
+	}
+	void spillSessions() {
+		//якщо історії всіх сеансів разом більші за бюджет, найстаріші записи витісняються на диск, доки не вмістяться
+		unsigned long long budgetInBytes = Session::getHistoryMemoryBudget(), residentBytes = 0;
+		if (budgetInBytes == 0)
+			return;
+
+		//сеанс, з яким саме працює команда, не враховується: його історію зараз не можна читати
+		std::vector<std::string> namesOfSessions = editor->getSessionsHistory()->getNamesOfSessions();
+		for (std::string& name : namesOfSessions) {
+			std::unique_lock<std::mutex> writerLock;
+			Session* session = editor->getSessionsHistory()->tryToLockSession(name, writerLock);
+			if (session)
+				residentBytes += session->getArenaStatistics().usedBytes;
+		}
+		for (std::string& name : namesOfSessions) {
+			if (residentBytes <= budgetInBytes)
+				break;
+			std::unique_lock<std::mutex> writerLock;
+			Session* session = editor->getSessionsHistory()->tryToLockSession(name, writerLock);
+			if (!session)
+				continue;
+			unsigned long long freedBytes = session->spillHistory(residentBytes - budgetInBytes);
+			residentBytes -= std::min(freedBytes, residentBytes);
+			countOfFreedBytes += freedBytes;
+		}
+	}
+
+	Statistics getStatistics() { return { countOfCompactions, countOfSquashedCommands, countOfFreedBytes }; }
 };
 
-class RedoCommand : public Command {
+const int HistoryCompactor::INTERVAL_OF_CHECKS_IN_MS = 2000;
+
+class ReplicaApplier {
+	//працює в резервній директорії: дочитує журнал реплікації і застосовує нові записи до своїх копій сеансів
+private:
+	static const int INTERVAL_OF_POLLS_IN_MS; //як часто перевіряти, чи не з'явилися в журналі нові записи
+	static const std::string PENDING_FILENAME; //нові тексти змінених сеансів разом з позицією в журналі, поки вони записуються
+
+	Editor* editor; //редактор репліки
+	CommandsManager* commandsManager; //зміни записуються в історію сеансів репліки
+	std::map<Session*, std::string*> textsOfSessions; //відкриті тексти сеансів репліки
+	std::unordered_set<Session*> changedSessions; //сеанси, змінені з останнього запису на диск
+	std::string identifierOfLog; //ідентифікатор журналу, який застосовується
+	unsigned long long appliedOffset; //до якого байта журнал уже застосовано
+	std::thread worker; //фоновий потік застосування
+	std::mutex stopMutex; //захищає прапорець зупинки
+	std::condition_variable stopCondition; //будить потік, щоб він завершився без очікування інтервалу
+	bool isStopRequested; //чи треба завершити фоновий потік
+	std::atomic<long long> countOfAppliedRecords; //скільки записів журналу застосовано
+	std::atomic<long long> countOfRejectedRecords; //скільки записів не вдалося застосувати
+
+	void run() {
+		std::unique_lock<std::mutex> lock(stopMutex);
+		while (!stopCondition.wait_for(lock, std::chrono::milliseconds(INTERVAL_OF_POLLS_IN_MS), [this] { return isStopRequested; })) {
+			lock.unlock();
+			applyNewRecords();
+			lock.lock();
+		}
+		lock.unlock();
+		applyNewRecords();
+	}
+	Session* openSession(std::string name) {
+		Session* session = editor->getSessionsHistory()->getSessionByName(name);
+		if (!session) {
+			session = new Session(name);
+			FilesManager::createSessionFiles(session);
+			editor->getSessionsHistory()->addSessionToEnd(session);
+		}
+
+		if (textsOfSessions.find(session) == textsOfSessions.end()) {
+			std::string textFromFile = FilesManager::readSessionDataByName(session->getName());
+			FilesManager::loadSessionHistory(editor, session);
+			if (Editor::isUtf8Mode())
+				session->getUtf8Index()->rebuild(textFromFile);
+			textsOfSessions[session] = new std::string(textFromFile);
+			session->publishText(textFromFile);
+		}
+		Editor::setCurrentSession(session);
+		Editor::setCurrentText(textsOfSessions[session]);
+		return session;
+	}
+	void closeSession(Session* session) {
+		if (Editor::getCurrentSession() == session) {
+			Editor::setCurrentSession(nullptr);
+			Editor::setCurrentText(nullptr);
+		}
+		auto text = textsOfSessions.find(session);
+		if (text != textsOfSessions.end()) {
+			delete text->second;
+			textsOfSessions.erase(text);
+		}
+		changedSessions.erase(session);
+	}
+	bool applyRecord(const CommandsRecorder::Request& request) {
+		if (request.type == "MODE") {
+			Editor::setUtf8Enabled(request.payload == "UTF8");
+			for (auto& [session, text] : textsOfSessions)
+				if (Editor::isUtf8Mode())
+					session->getUtf8Index()->rebuild(*text);
+			return true;
+		}
+		if (request.type == "CREATESESSION") {
+			if (!editor->getSessionsHistory()->getSessionByName(request.payload)) {
+				Session* session = new Session(request.payload);
+				FilesManager::createSessionFiles(session);
+				editor->getSessionsHistory()->addSessionToEnd(session);
+			}
+			return true;
+		}
+		if (request.type == "DELETESESSION") {
+			Session* session = editor->getSessionsHistory()->getSessionByName(request.payload);
+			if (session) {
+				closeSession(session);
+				editor->getSessionsHistory()->deleteSessionByName(request.payload);
+			}
+			FilesManager::deleteSessionFiles(request.payload);
+			return true;
+		}
+		if (request.type == "OPEN")
+			return openSession(request.payload) != nullptr;
+
+		Session* session = Editor::getCurrentSession();
+		if (!session || (request.type != "LOAD" && request.type != "EXTERNALCHANGE"))
+			return false;
+		std::string* text = Editor::getCurrentText();
+		if (request.type == "LOAD") {
+			if (*text != request.payload)
+				commandsManager->invokeCommand("ExternalChange", 0, (int)text->size(), request.payload);
+		}
+		else {
+			if (request.startPosition < 0 || request.startPosition > request.endPosition || request.endPosition > (long long)text->size())
+				return false;
+			commandsManager->invokeCommand("ExternalChange", (int)request.startPosition, (int)request.endPosition, request.payload);
+		}
+		changedSessions.insert(session);
+		return true;
+	}
+	static bool replaceFile(std::string filepath, const std::string& data) {
+		//новий вміст спочатку повністю пишеться поруч, а потім одним перейменуванням замінює старий
+		{
+			std::ofstream file(filepath + ".tmp", std::ios::binary | std::ios::trunc);
+			if (!(file << data).flush())
+				return false;
+		}
+		std::error_code errorCode;
+		std::filesystem::rename(filepath + ".tmp", filepath, errorCode);
+		return !errorCode;
+	}
+	static void applyPendingChanges() {
+		//зміни журналу позиційні й не можуть застосовуватись двічі, тому тексти та позиція в журналі
+		//спершу разом потрапляють у файл очікування, а після збою записуються з нього повторно
+		std::ifstream pendingFile(PENDING_FILENAME, std::ios::binary);
+		if (!pendingFile.is_open())
+			return;
+
+		std::string appliedPosition, name;
+		CommandsRecorder::Request request;
+		getline(pendingFile, appliedPosition);
+		while (CommandsRecorder::readRequest(pendingFile, request))
+			if (request.type == "OPEN")
+				name = request.payload;
+			else if (request.type == "LOAD" && !name.empty())
+				FilesManager::writeSessionData(name, request.payload);
+		pendingFile.close();
+
+		replaceFile(ReplicationLog::APPLIED_FILENAME, appliedPosition);
+		std::filesystem::remove(PENDING_FILENAME);
+	}
+	void writeChanges() {
+		std::string pendingChanges = identifierOfLog + " " + std::to_string(appliedOffset) + "\n";
+		for (Session* session : changedSessions)
+			pendingChanges += CommandsRecorder::formatRequest({ "OPEN", 0, 0, session->getName() }) +
+			CommandsRecorder::formatRequest({ "LOAD", 0, 0, *textsOfSessions[session] });
+
+		//якщо файл очікування не записався, тексти лишаються зміненими й потраплять у наступний
+		if (!replaceFile(PENDING_FILENAME, pendingChanges))
+			return;
+		changedSessions.clear();
+		applyPendingChanges();
+	}
+
 public:
-	~RedoCommand() {
-		if (commandToUndoOrRedo)
-			delete (commandToUndoOrRedo);
+	struct Statistics {
+		long long countOfAppliedRecords;
+		long long countOfRejectedRecords;
+		unsigned long long appliedOffset;
+	};
+
+	ReplicaApplier() {
+		editor = nullptr;
+		commandsManager = nullptr;
+		appliedOffset = 0;
+		isStopRequested = false;
+		countOfAppliedRecords = 0;
+		countOfRejectedRecords = 0;
 	}
+	~ReplicaApplier() { stop(); }
 
-	void execute() override;
-	void undo() override;
-	Command* copy() override;
+	void start(Editor* editor) {
+		stop();
+		this->editor = editor;
+		commandsManager = new CommandsManager(editor);
+		commandsManager->setCoalescingEnabled(false);
+		applyPendingChanges();
+		std::ifstream(ReplicationLog::APPLIED_FILENAME) >> identifierOfLog >> appliedOffset;
+		isStopRequested = false;
+		worker = std::thread(&ReplicaApplier::run, this);
+	}
+	void stop() {
+		if (!worker.joinable())
+			return;
+		{
+			std::lock_guard<std::mutex> lock(stopMutex);
+			isStopRequested = true;
+		}
+		stopCondition.notify_all();
+		worker.join();
+
+		while (!textsOfSessions.empty())
+			closeSession(textsOfSessions.begin()->first);
+		delete commandsManager;
+		commandsManager = nullptr;
+	}
+	void applyNewRecords() {
+		//запис застосовується лише цілим: обірваний рядок або неповний текст дочитаються при наступній перевірці
+		std::ifstream log(ReplicationLog::LOG_FILENAME, std::ios::binary);
+		CommandsRecorder::Request request;
+		if (!log.is_open() || !CommandsRecorder::readRequest(log, request) || log.eof() || request.type != "LOG")
+			return;
+		if (request.payload != identifierOfLog) {
+			//основний екземпляр почав новий журнал
+			identifierOfLog = request.payload;
+			appliedOffset = log.tellg();
+		}
+		log.seekg(appliedOffset);
+
+		bool wasAnyApplied = false;
+		while (CommandsRecorder::readRequest(log, request) && !log.eof()) {
+			if (applyRecord(request))
+				countOfAppliedRecords++;
+			else
+				countOfRejectedRecords++;
+			appliedOffset = log.tellg();
+			wasAnyApplied = true;
+		}
+		if (wasAnyApplied)
+			writeChanges();
+	}
+
+	Statistics getStatistics() { return { countOfAppliedRecords, countOfRejectedRecords, appliedOffset }; }
 };
 
-class FilesManager {
-private:
-	friend class Editor;
+const int ReplicaApplier::INTERVAL_OF_POLLS_IN_MS = 50;
+const std::string ReplicaApplier::PENDING_FILENAME = "Replication.pending";
+
+class EditingServer {
+private:
+	static const int POLL_TIMEOUT_IN_MS; //як часто, за відсутності запитів, змінені сеанси записуються на диск
+	static const size_t MAX_SIZE_OF_REQUEST; //обмеження на розмір одного запиту
+
+	struct Client {
+		SOCKET socket; //сокет клієнта
+		std::string input, output; //ще не оброблені байти запитів та ще не надіслані байти відповідей
+		Session* session; //сеанс, відкритий клієнтом
+		bool isClosing; //закрити з'єднання після надсилання відповідей
+	};
+
+	Editor* editor; //редактор, в якому відбувається редагування
+	CommandsManager* commandsManager; //менеджер команд, спільний для всіх клієнтів
+	SOCKET listeningSocket; //сокет, на якому сервер приймає з'єднання
+	std::vector<Client> clients; //підключені клієнти
+	std::map<Session*, std::string*> buffersOfSessions; //тексти відкритих сеансів, спільні для клієнтів одного сеансу
+	std::map<Session*, bool> dirtySessions; //сеанси, зміни яких ще не записані на диск
+	std::map<Session*, SOCKET> ownersOfTransactions; //сеанс -> клієнт, який розпочав у ньому пакет команд
+	std::chrono::steady_clock::time_point timeOfLastFlush; //коли змінені сеанси востаннє записувались на диск
+	bool isRunning; //чи працює цикл подій
+
+	static bool setNonBlocking(SOCKET socket) {
+		u_long mode = 1;
+		return ioctlsocket(socket, FIONBIO, &mode) == 0;
+	}
+	static std::string makeResponse(bool isSuccessful, long long latencyUs, std::string payload) {
+		return (isSuccessful ? "OK " : "ERR ") + std::to_string(latencyUs) + " " + std::to_string(payload.size()) + "\n" + payload;
+	}
+
+	Session* openSession(std::string name) {
+		Session* session = editor->getSessionsHistory()->getSessionByName(name);
+		if (!session) {
+			session = new Session();
+			if (!session->setName(name)) {
+				delete session;
+				return nullptr;
+			}
+			FilesManager::createSessionFiles(session);
+			ReplicationLog::recordCreation(session->getName());
+			editor->getSessionsHistory()->addSessionToEnd(session);
+		}
+
+		if (buffersOfSessions.find(session) == buffersOfSessions.end()) {
+			std::string textFromFile = FilesManager::readSessionDataByName(session->getName());
+			if (Editor::isUtf8Mode() && !Utf8Index::isValid(textFromFile))
+				return nullptr;
+
+			FilesManager::loadSessionHistory(editor, session);
+			if (Editor::isUtf8Mode())
+				session->getUtf8Index()->rebuild(textFromFile);
+			buffersOfSessions[session] = new std::string(textFromFile);
+			session->publishText(*buffersOfSessions[session]);
+		}
+		return session;
+	}
+	void rollbackTransaction(Session* session) {
+		//пакет скасовується над текстом свого сеансу, а не над текстом, з яким працював останній запит
+		Editor::setCurrentSession(session);
+		Editor::setCurrentText(buffersOfSessions[session]);
+		if (session->rollbackTransaction())
+			dirtySessions[session] = true;
+		ownersOfTransactions.erase(session);
+	}
+	void closeClient(Client& client) {
+		//пакет, який клієнт розпочав і не завершив, скасовується, інакше сеанс більше ніколи не записався б на диск
+		std::vector<Session*> sessionsOfClient;
+		for (auto& [session, owner] : ownersOfTransactions)
+			if (owner == client.socket)
+				sessionsOfClient.push_back(session);
+		for (Session* session : sessionsOfClient)
+			rollbackTransaction(session);
+		closesocket(client.socket);
+		client.socket = INVALID_SOCKET;
+	}
+	void flushDirtySessions() {
+		timeOfLastFlush = std::chrono::steady_clock::now();
+		for (auto& [session, isDirty] : dirtySessions)
+			if (isDirty && !session->isInTransaction())
+				isDirty = !FilesManager::writeSessionData(session->getName(), *session->getTextSnapshot());
+	}
+
+	bool executeRequest(Client& client, std::string typeOfRequest, std::istringstream& arguments, std::string payload, std::string& result) {
+		//повертає true при успіху; result - дані відповіді або повідомлення про помилку
+		if (typeOfRequest == "OPEN") {
+			std::string name;
+			getline(arguments >> std::ws, name);
+			client.session = openSession(name);
+			result = client.session ? client.session->getName() : "неправильне ім'я сеансу або текст не в UTF-8";
+			return client.session != nullptr;
+		}
+		if (typeOfRequest == "QUIT" || typeOfRequest == "SHUTDOWN") {
+			client.isClosing = true;
+			isRunning = typeOfRequest != "SHUTDOWN";
+			return true;
+		}
+		if (typeOfRequest == "STATS") {
+			result = "requests " + std::to_string(Profiler::getCountOf("EditingServer::request")) +
+				" p50Ns " + std::to_string(Profiler::getPercentileOf("EditingServer::request", 50)) +
+				" p99Ns " + std::to_string(Profiler::getPercentileOf("EditingServer::request", 99)) +
+				" p999Ns " + std::to_string(Profiler::getPercentileOf("EditingServer::request", 99.9));
+			return true;
+		}
+		if (!client.session) {
+			result = "спочатку потрібно відкрити сеанс";
+			return false;
+		}
+
+		Session* session = client.session;
+		std::string* text = buffersOfSessions[session];
+		Editor::setCurrentSession(session);
+		Editor::setCurrentText(text);
+
+		if (typeOfRequest == "GET") {
+			result = *session->getTextSnapshot();
+			return true;
+		}
+		if (typeOfRequest == "BEGIN" || typeOfRequest == "COMMIT" || typeOfRequest == "ROLLBACK") {
+			//пакет команд сеансу належить клієнту, який його розпочав: лише він може його завершити
+			auto ownersIter = ownersOfTransactions.find(session);
+			if (ownersIter != ownersOfTransactions.end() && ownersIter->second != client.socket) {
+				result = "пакет команд сеансу розпочав інший клієнт";
+				return false;
+			}
+			bool isSuccessful = typeOfRequest == "BEGIN" ? session->beginTransaction() :
+				typeOfRequest == "COMMIT" ? session->commitTransaction(editor) : session->rollbackTransaction();
+			if (!isSuccessful)
+				result = "немає відповідного пакета команд";
+			else if (typeOfRequest == "BEGIN")
+				ownersOfTransactions[session] = client.socket;
+			else
+				ownersOfTransactions.erase(session);
+			return isSuccessful;
+		}
+		if (typeOfRequest == "UNDO" || typeOfRequest == "REDO") {
+			bool canBeExecuted = !session->isInTransaction() && (typeOfRequest == "UNDO" ?
+				session->canUndo() :
+				commandsManager->isThereAnyCommandForward());
+			if (!canBeExecuted) {
+				result = "немає команди, яку можна було б виконати";
+				return false;
+			}
+			if (!commandsManager->invokeCommand(typeOfRequest == "UNDO" ? "Undo" : "Redo")) {
+				result = "не вдалося прочитати знімок історії з диска";
+				return false;
+			}
+			dirtySessions[session] = true;
+			return true;
+		}
+		if (typeOfRequest == "SORTLINES" || typeOfRequest == "UNIQUELINES" || typeOfRequest == "KEEPLINES" || typeOfRequest == "DROPLINES") {
+			//команди над рядками обробляють увесь текст, тому позицій не мають; у KEEPLINES і DROPLINES текст запиту - зразок
+			if ((typeOfRequest == "KEEPLINES" || typeOfRequest == "DROPLINES") && payload.empty()) {
+				result = "зразок порожній";
+				return false;
+			}
+			if (Editor::isUtf8Mode() && !Utf8Index::isValid(payload)) {
+				result = "текст не в UTF-8";
+				return false;
+			}
+			commandsManager->invokeCommand(typeOfRequest == "SORTLINES" ? "SortLines" : typeOfRequest == "UNIQUELINES" ? "UniqueLines" :
+				typeOfRequest == "KEEPLINES" ? "KeepLines" : "DropLines", 0, 0, payload);
+			dirtySessions[session] = true;
+			return true;
+		}
+		if (int transform = TextTransforms::findTransform(typeOfRequest); transform != -1) {
+			commandsManager->invokeCommand(TextTransforms::NAMES[transform]);
+			dirtySessions[session] = true;
+			return true;
+		}
+
+		std::string typeOfCommand = typeOfRequest == "PASTE" ? "Paste" : typeOfRequest == "DELETE" ? "Delete" :
+			typeOfRequest == "CUT" ? "Cut" : typeOfRequest == "COPY" ? "Copy" : "";
+		long long startPosition, endPosition;
 
-	static const std::string METADATA_DIRECTORY, //директорія папки метаданих
-		DATA_DIRECTORY; //директорія, де безпосередньо збергаються текстові файли, які ми редагуємо в програмі
+		if (typeOfCommand.empty() || !(arguments >> startPosition >> endPosition)) {
+			result = "невідомий запит";
+			return false;
+		}
+		size_t sizeOfText = typeOfCommand == "Copy" ? session->getTextSnapshot()->size() : text->size();
+		if (Editor::isUtf8Mode()) {
+			//у режимі UTF-8 клієнт вказує номери символів, а команди працюють з байтами
+			if (!Utf8Index::isValid(payload)) {
+				result = "текст не в UTF-8";
+				return false;
+			}
+			sizeOfText = session->getUtf8Index()->getCountOfCodePoints();
+		}
+		if (!arePositionsValid(typeOfCommand, startPosition, endPosition, sizeOfText)) {
+			result = "позиції виходять за межі тексту";
+			return false;
+		}
+		if (Editor::isUtf8Mode()) {
+			if (startPosition >= 0)
+				startPosition = session->getUtf8Index()->getByteOffset(*text, startPosition);
+			if (endPosition >= 0)
+				endPosition = session->getUtf8Index()->getByteOffset(*text, endPosition);
+		}
 
-	static std::stack<std::string> getFilepathsForMetadata(std::string directory) {
-		std::stack<std::string> filesFromMetadataDirectory;
+		commandsManager->invokeCommand(typeOfCommand, (int)startPosition, (int)endPosition, payload);
+		if (typeOfCommand == "Copy" || typeOfCommand == "Cut")
+			result = session->getDataFromClipboardByIndex(session->sizeOfClipboard() - 1);
+		if (typeOfCommand != "Copy")
+			dirtySessions[session] = true;
+		return true;
+	}
+	bool tryToExecuteNextRequest(Client& client) {
+		//запит - рядок "КОМАНДА аргументи"; у PASTE, KEEPLINES і DROPLINES останній аргумент - довжина тексту, який іде одразу після рядка
+		size_t endOfLine = client.input.find('\n');
+		if (endOfLine == std::string::npos) {
+			if (client.input.size() > MAX_SIZE_OF_REQUEST)
+				client.isClosing = true;
+			return false;
+		}
 
-		auto iteratorOnFiles = std::filesystem::directory_iterator(directory);
+		auto start = std::chrono::steady_clock::now();
+		ProfilerScope profilerScope("EditingServer::request");
+
+		std::istringstream arguments(client.input.substr(0, endOfLine));
+		std::string typeOfRequest, payload, result;
+		size_t sizeOfRequest = endOfLine + 1;
+
+		arguments >> typeOfRequest;
+		if (typeOfRequest == "PASTE" || typeOfRequest == "KEEPLINES" || typeOfRequest == "DROPLINES") {
+			long long startPosition, endPosition;
+			size_t sizeOfPayload = 0;
+			std::istringstream argumentsOfPaste(arguments.str());
+			argumentsOfPaste >> typeOfRequest;
+			if (typeOfRequest == "PASTE")
+				argumentsOfPaste >> startPosition >> endPosition;
+			argumentsOfPaste >> sizeOfPayload;
+			if (sizeOfPayload > MAX_SIZE_OF_REQUEST) {
+				client.isClosing = true;
+				return false;
+			}
+			if (client.input.size() < sizeOfRequest + sizeOfPayload)
+				return false;
+			payload = client.input.substr(sizeOfRequest, sizeOfPayload);
+			sizeOfRequest += sizeOfPayload;
+		}
 
-		for (const auto& entry : iteratorOnFiles)
-				filesFromMetadataDirectory.push(entry.path().string());
+		bool isSuccessful = executeRequest(client, typeOfRequest, arguments, payload, result);
+		client.input.erase(0, sizeOfRequest);
 
-		return filesFromMetadataDirectory;
+		auto latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		client.output += makeResponse(isSuccessful, latencyUs, result);
+		return true;
 	}
-	static std::string readDataByDelimiter(std::ifstream* ifs_session, std::string delimiter) {
-		std::string line, text;
-		int counterOfLines = 0;
 
-		getline(*ifs_session, line);
-		while (getline(*ifs_session, line)) {
-			if (line == delimiter)
-				break;
-			counterOfLines++;
-			if (counterOfLines > 1)
-				line = "\n" + line;
-			text += line;
+	void acceptClients() {
+		SOCKET clientSocket;
+		while ((clientSocket = accept(listeningSocket, nullptr, nullptr)) != INVALID_SOCKET) {
+			setNonBlocking(clientSocket);
+			clients.push_back({ clientSocket, "", "", nullptr, false });
 		}
-
-		return text;
 	}
+	bool receiveFromClient(Client& client) {
+		char buffer[64 * 1024];
+		int countOfBytes;
 
-	static void deleteMetadataForDeletedSessions(SessionsHistory* sessionsHistory, std::string directory) {
-		if (!std::filesystem::exists(directory))
-			return;
-
-		std::stack<std::string> filesFromMetadataDirectory = getFilepathsForMetadata(directory);
-		std::string sessionFilepath;
-		bool isPartOfRealtimeSessions;
+		while ((countOfBytes = recv(client.socket, buffer, sizeof(buffer), 0)) > 0)
+			client.input.append(buffer, countOfBytes);
 
-		for (int i = 0; i < filesFromMetadataDirectory.size(); i++)
-		{
-			isPartOfRealtimeSessions = false;
-			for (int j = 0; j < sessionsHistory->size(); j++)
-			{
-				sessionFilepath = directory + sessionsHistory->getSessionByIndex(j)->getName();
-				if (filesFromMetadataDirectory._Get_container()[i] == sessionFilepath)
-					isPartOfRealtimeSessions = true;
-			}
+		if (countOfBytes < 0 && WSAGetLastError() != WSAEWOULDBLOCK)
+			return false;
 
-			if (!isPartOfRealtimeSessions)
-				remove(filesFromMetadataDirectory._Get_container()[i].c_str());
+		//клієнт, який закрив свій бік з'єднання, все одно отримує відповіді на повні запити, надіслані перед цим
+		while (!client.isClosing && tryToExecuteNextRequest(client));
+		if (countOfBytes == 0)
+			client.isClosing = true;
+		return true;
+	}
+	bool sendToClient(Client& client) {
+		while (!client.output.empty()) {
+			int countOfBytes = send(client.socket, client.output.data(), (int)std::min(client.output.size(), (size_t)INT_MAX), 0);
+			if (countOfBytes == SOCKET_ERROR)
+				return WSAGetLastError() == WSAEWOULDBLOCK;
+			client.output.erase(0, countOfBytes);
 		}
-		
+		return !client.isClosing;
 	}
 
-	static void writeSessionsMetadata(SessionsHistory* sessionsHistory) {
-		deleteMetadataForDeletedSessions(sessionsHistory, METADATA_DIRECTORY);
-
-		if (!std::filesystem::exists(METADATA_DIRECTORY))
-			std::filesystem::create_directories(METADATA_DIRECTORY);
-
-		for (int i = 0; i < sessionsHistory->size(); i++)
-			writeSessionMetadata(sessionsHistory, i);
+public:
+	static bool arePositionsValid(std::string typeOfCommand, long long startPosition, long long endPosition, long long sizeOfText) {
+		//-1 на початку ділянки вставки допустиме лише разом з -1 у кінці (вставка без ділянки)
+		if (typeOfCommand == "Paste")
+			return (startPosition >= 0 || (startPosition == -1 && endPosition == -1)) && endPosition >= -1 &&
+			startPosition <= sizeOfText && endPosition <= sizeOfText &&
+			(startPosition == endPosition || endPosition == -1 || endPosition == sizeOfText || startPosition <= endPosition);
+		return 0 <= startPosition && startPosition <= endPosition && endPosition < sizeOfText;
 	}
-	static void writeSessionMetadata(SessionsHistory* sessionsHistory, int index) {
-		Session* session = sessionsHistory->getSessionByIndex(index);
 
-		std::ofstream ofs_session(METADATA_DIRECTORY + session->getName());
+	EditingServer(Editor* editor) {
+		this->editor = editor;
+		commandsManager = new CommandsManager(editor);
+		listeningSocket = INVALID_SOCKET;
+		isRunning = false;
+	}
+	~EditingServer() {
+		for (auto& [session, text] : buffersOfSessions)
+			delete text;
+		delete commandsManager;
+	}
 
-		ofs_session << session->sizeOfCommandsHistory() << std::endl;
-		ofs_session << session->getCurIndexInCommHistory() << std::endl;
+	bool run(std::string socketPath) {
+		//однопотоковий цикл подій на WSAPoll: запити різних клієнтів виконуються по черзі, тому статичний
+		//стан редактора (поточний сеанс і текст) просто перемикається перед кожним запитом
+		WSADATA wsaData;
+		if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+			return false;
 
-		for (int j = 0; j < session->sizeOfCommandsHistory(); j++)
-			writeCommandMetadata(&ofs_session, session, j);
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		if (socketPath.size() >= sizeof(address.sun_path))
+			return false;
+		std::copy(socketPath.begin(), socketPath.end(), address.sun_path);
+
+		std::filesystem::remove(socketPath);
+		listeningSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listeningSocket == INVALID_SOCKET ||
+			bind(listeningSocket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+			listen(listeningSocket, SOMAXCONN) == SOCKET_ERROR || !setNonBlocking(listeningSocket)) {
+			if (listeningSocket != INVALID_SOCKET)
+				closesocket(listeningSocket);
+			WSACleanup();
+			return false;
+		}
 
-		ofs_session.close();
-	}
-	static void writeCommandMetadata(std::ofstream* ofs_session, Session* session, int index) {
-		std::string typeOfCommand, nameOfCommandClass, delimiter = "---\n";
-		Command* command = session->getCommandByIndex(index);
+		Profiler::setEnabled(true);
+		timeOfLastFlush = std::chrono::steady_clock::now();
+		isRunning = true;
+		std::vector<WSAPOLLFD> descriptors;
 
-		nameOfCommandClass = std::string(typeid(*command).name());
+		while (isRunning) {
+			descriptors.assign(1, { listeningSocket, POLLIN, 0 });
+			for (Client& client : clients)
+				descriptors.push_back({ client.socket, (short)(POLLIN | (client.output.empty() ? 0 : POLLOUT)), 0 });
 
-		if (nameOfCommandClass == "class PasteCommand")
-			typeOfCommand = "PasteCommand";
-		else if (nameOfCommandClass == "class CutCommand")
-			typeOfCommand = "CutCommand";
-		else
-			typeOfCommand = "DeleteCommand";
+			int countOfReadyDescriptors = WSAPoll(descriptors.data(), (unsigned long)descriptors.size(), POLL_TIMEOUT_IN_MS);
+			if (std::chrono::steady_clock::now() - timeOfLastFlush >= std::chrono::milliseconds(POLL_TIMEOUT_IN_MS))
+				flushDirtySessions();
+			if (countOfReadyDescriptors <= 0)
+				continue;
 
-		*ofs_session << typeOfCommand << std::endl << delimiter;
+			if (descriptors[0].revents & POLLIN)
+				acceptClients();
 
-		if (command->getTextToProcess() != "")
-			*ofs_session << command->getTextToProcess() << std::endl;
+			for (size_t i = 1; i < descriptors.size(); i++) {
+				Client& client = clients[i - 1];
+				bool isAlive = true;
 
-		*ofs_session << delimiter;
-	}
+				if (descriptors[i].revents & (POLLIN | POLLERR | POLLHUP))
+					isAlive = receiveFromClient(client);
+				if (isAlive)
+					isAlive = sendToClient(client);
+				if (!isAlive)
+					closeClient(client);
+			}
 
-	static void readSessionsMetadata(Editor* editor) {
-		if (!std::filesystem::exists(METADATA_DIRECTORY))
-			return;
+			clients.erase(std::remove_if(clients.begin(), clients.end(), [](Client& client) {
+				return client.socket == INVALID_SOCKET;
+				}), clients.end());
+		}
 
-		std::stack<std::string> available_sessions;
+		for (Client& client : clients) {
+			sendToClient(client);
+			closeClient(client);
+		}
+		clients.clear();
+		closesocket(listeningSocket);
+		std::filesystem::remove(socketPath);
+		WSACleanup();
+
+		for (auto& [session, text] : buffersOfSessions)
+			if (session->isInTransaction())
+				rollbackTransaction(session);
+		flushDirtySessions();
+		return true;
+	}
+};
 
-		available_sessions = getFilepathsForMetadata(METADATA_DIRECTORY);
+const int EditingServer::POLL_TIMEOUT_IN_MS = 100;
+const size_t EditingServer::MAX_SIZE_OF_REQUEST = 64 * 1024 * 1024;
 
-		for (int i = 0; i < available_sessions.size(); i++)
-			readSessionMetadata(editor, available_sessions._Get_container()[i]);
+class LoadGenerator {
+private:
+	struct Response {
+		bool isSuccessful; //чи відповів сервер "OK"
+		long long serverLatencyUs; //затримка, виміряна сервером
+		std::string payload; //дані відповіді
+	};
+
+	static bool sendAll(SOCKET socket, std::string data) {
+		while (!data.empty()) {
+			int countOfBytes = send(socket, data.data(), (int)data.size(), 0);
+			if (countOfBytes <= 0)
+				return false;
+			data.erase(0, countOfBytes);
+		}
+		return true;
 	}
-	static void readSessionMetadata(Editor* editor, std::string filepath) {
-		std::string line;
-		filepath.erase(0, METADATA_DIRECTORY.size());
-		Session* session = new Session(filepath);
-		int countOfCommands;
+	static bool receiveResponse(SOCKET socket, std::string& input, Response& response) {
+		char buffer[64 * 1024];
+		size_t endOfLine;
+
+		while (true) {
+			endOfLine = input.find('\n');
+			if (endOfLine != std::string::npos) {
+				std::istringstream header(input.substr(0, endOfLine));
+				std::string status;
+				size_t sizeOfPayload = 0;
+				header >> status >> response.serverLatencyUs >> sizeOfPayload;
+				if (input.size() >= endOfLine + 1 + sizeOfPayload) {
+					response.isSuccessful = status == "OK";
+					response.payload = input.substr(endOfLine + 1, sizeOfPayload);
+					input.erase(0, endOfLine + 1 + sizeOfPayload);
+					return true;
+				}
+			}
 
-		std::ifstream ifs_session(METADATA_DIRECTORY + filepath);
+			int countOfBytes = recv(socket, buffer, sizeof(buffer), 0);
+			if (countOfBytes <= 0)
+				return false;
+			input.append(buffer, countOfBytes);
+		}
+	}
+	static SOCKET connectToServer(std::string socketPath) {
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		if (socketPath.size() >= sizeof(address.sun_path))
+			return INVALID_SOCKET;
+		std::copy(socketPath.begin(), socketPath.end(), address.sun_path);
+
+		SOCKET clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (clientSocket != INVALID_SOCKET && connect(clientSocket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+			closesocket(clientSocket);
+			return INVALID_SOCKET;
+		}
+		return clientSocket;
+	}
+	static void runClient(std::string socketPath, int indexOfClient, int countOfRequests,
+		std::vector<long long>* latenciesNs, std::vector<long long>* serverLatenciesUs, int* countOfErrors) {
+		//кожен клієнт редагує власний сеанс: 80% вставок у кінець, 15% видалень з кінця, 5% читань тексту
+		SOCKET clientSocket = connectToServer(socketPath);
+		std::string input, textToPaste = "load-generator;";
+		Response response;
+		long long sizeOfText = 0;
+
+		if (clientSocket == INVALID_SOCKET) {
+			*countOfErrors = countOfRequests;
+			return;
+		}
 
-		getline(ifs_session, line);
-		countOfCommands = stoi(line);
+		if (!sendAll(clientSocket, "OPEN load_" + std::to_string(indexOfClient) + "\nGET\n") ||
+			!receiveResponse(clientSocket, input, response) || !receiveResponse(clientSocket, input, response)) {
+			*countOfErrors = countOfRequests;
+			closesocket(clientSocket);
+			return;
+		}
+		sizeOfText = response.payload.size();
 
-		getline(ifs_session, line);
-		session->setCurIndexInCommHistory(stoi(line));
+		for (int i = 0; i < countOfRequests; i++) {
+			std::string request;
+			int kindOfRequest = i % 20;
 
-		for (int j = 0; j < countOfCommands; j++)
-			readCommandMetadata(editor, &ifs_session, session);
+			if (kindOfRequest < 16 || sizeOfText < (long long)textToPaste.size()) {
+				long long position = std::max(sizeOfText - 1, 0LL);
+				request = "PASTE " + std::to_string(position) + " " + std::to_string(position) + " " + std::to_string(textToPaste.size()) + "\n" + textToPaste;
+				sizeOfText += textToPaste.size();
+			}
+			else if (kindOfRequest < 19) {
+				request = "DELETE " + std::to_string(sizeOfText - textToPaste.size()) + " " + std::to_string(sizeOfText - 1) + "\n";
+				sizeOfText -= textToPaste.size();
+			}
+			else
+				request = "GET\n";
 
-		editor->getSessionsHistory()->addSessionToEnd(session);
+			auto start = std::chrono::steady_clock::now();
+			if (!sendAll(clientSocket, request) || !receiveResponse(clientSocket, input, response)) {
+				*countOfErrors += countOfRequests - i;
+				break;
+			}
+			latenciesNs->push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+			serverLatenciesUs->push_back(response.serverLatencyUs);
+			if (!response.isSuccessful)
+				(*countOfErrors)++;
+		}
 
-		ifs_session.close();
+		sendAll(clientSocket, "QUIT\n");
+		closesocket(clientSocket);
+	}
+	static long long getPercentile(std::vector<long long>& values, double percentile) {
+		if (values.empty())
+			return 0;
+		size_t index = std::min(values.size() - 1, (size_t)(values.size() * percentile / 100.0));
+		return values[index];
 	}
-	static void readCommandMetadata(Editor* editor, std::ifstream* ifs_session, Session* session) {
-		std::string typeOfCommand, text;
-		Command* command,* previousCommand;
 
-		getline(*ifs_session, typeOfCommand);
-		if (typeOfCommand == "CutCommand")
-			command = new CutCommand(editor);
-		else if (typeOfCommand == "PasteCommand")
-			command = new PasteCommand(editor);
-		else
-			command = new DeleteCommand(editor);
+public:
+	static bool run(std::string socketPath, int countOfClients, int countOfRequests) {
+		WSADATA wsaData;
+		if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+			return false;
 
-		if (session->sizeOfCommandsHistory() > 0)
-		{
-			previousCommand = session->getCommandByIndex(session->sizeOfCommandsHistory() - 1);
-			command->setPreviousCommand(previousCommand);
+		std::vector<std::vector<long long>> latenciesNs(countOfClients), serverLatenciesUs(countOfClients);
+		std::vector<int> countsOfErrors(countOfClients);
+		std::vector<std::thread> threads;
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < countOfClients; i++)
+			threads.emplace_back(runClient, socketPath, i, countOfRequests, &latenciesNs[i], &serverLatenciesUs[i], &countsOfErrors[i]);
+		for (std::thread& thread : threads)
+			thread.join();
+		double durationInSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::vector<long long> allLatenciesNs, allServerLatenciesUs;
+		int countOfErrors = 0;
+		for (int i = 0; i < countOfClients; i++) {
+			allLatenciesNs.insert(allLatenciesNs.end(), latenciesNs[i].begin(), latenciesNs[i].end());
+			allServerLatenciesUs.insert(allServerLatenciesUs.end(), serverLatenciesUs[i].begin(), serverLatenciesUs[i].end());
+			countOfErrors += countsOfErrors[i];
 		}
+		std::sort(allLatenciesNs.begin(), allLatenciesNs.end());
+		std::sort(allServerLatenciesUs.begin(), allServerLatenciesUs.end());
+
+		std::cout << "\nКлієнтів: " << countOfClients << ", запитів: " << allLatenciesNs.size() << ", помилок: " << countOfErrors;
+		std::cout << "\nПропускна здатність: " << (long long)(allLatenciesNs.size() / durationInSeconds) << " запитів/с";
+		std::cout << "\nЗатримка клієнта (мкс): p50 " << getPercentile(allLatenciesNs, 50) / 1000.0
+			<< ", p99 " << getPercentile(allLatenciesNs, 99) / 1000.0 << ", p99.9 " << getPercentile(allLatenciesNs, 99.9) / 1000.0;
+		std::cout << "\nЗатримка сервера (мкс): p50 " << getPercentile(allServerLatenciesUs, 50)
+			<< ", p99 " << getPercentile(allServerLatenciesUs, 99) << ", p99.9 " << getPercentile(allServerLatenciesUs, 99.9) << "\n";
+
+		WSACleanup();
+		return countOfErrors == 0;
+	}
+};
 
-		text = readDataByDelimiter(ifs_session, "---");
-		command->setTextToProcess(text);
+class ReplayEngine {
+public:
+	virtual ~ReplayEngine() { }
+
+	virtual std::string getName() = 0;
+	//false - запит відхилено (неправильні позиції, немає команди для скасування тощо); result - скопійовані дані
+	virtual bool execute(const CommandsRecorder::Request& request, std::string& result) = 0;
+	virtual std::string getText() = 0;
+};
 
-		session->addCommandAsLast(command);
+class CommandsManagerEngine : public ReplayEngine {
+private:
+	Editor* editor; //редактор, в якому відтворюються запити
+	CommandsManager* commandsManager; //менеджер команд, який перевіряється
+	std::map<std::string, std::pair<Session*, std::string*>> sessions; //відкриті сеанси та їхні тексти
+	Session* session; //поточний сеанс
+	std::string* text; //текст поточного сеансу
+
+	static std::string getTypeOfCommand(std::string typeOfRequest) {
+		return typeOfRequest == "PASTE" ? "Paste" : typeOfRequest == "DELETE" ? "Delete" :
+			typeOfRequest == "CUT" ? "Cut" : typeOfRequest == "COPY" ? "Copy" : "";
+	}
+	static std::string getTypeOfLinesCommand(std::string typeOfRequest) {
+		return typeOfRequest == "SORTLINES" ? "SortLines" : typeOfRequest == "UNIQUELINES" ? "UniqueLines" :
+			typeOfRequest == "KEEPLINES" ? "KeepLines" : typeOfRequest == "DROPLINES" ? "DropLines" : "";
 	}
 
 public:
-	static std::string getSessionsDirectory() {
-		return DATA_DIRECTORY;
+	CommandsManagerEngine() {
+		//об'єднання команд залежить від часу між ними, тому під час відтворення воно вимкнене
+		editor = new Editor();
+		commandsManager = new CommandsManager(editor);
+		commandsManager->setCoalescingEnabled(false);
+		session = nullptr;
+		text = nullptr;
+	}
+	~CommandsManagerEngine() {
+		delete commandsManager;
+		for (auto& [name, sessionAndText] : sessions)
+			delete sessionAndText.second;
+		editor->setCurrentText(nullptr);
+		delete editor;
 	}
 
-	static std::string readSessionData(std::string fullFilepath) {
-		std::string text, line;
-
-		std::ifstream file(fullFilepath);
-
-		int counterOfLines = 0;
+	std::string getName() { return "CommandsManager"; }
+	std::string getText() { return text ? *text : ""; }
 
-		while (getline(file, line))
-		{
-			counterOfLines++;
-			if (counterOfLines > 1)
-				line = "\n" + line;
-			text += line;
+	bool execute(const CommandsRecorder::Request& request, std::string& result) {
+		if (request.type == "MODE")
+			return true;
+		if (request.type == "OPEN") {
+			if (sessions.find(request.payload) == sessions.end()) {
+				Session* newSession = new Session(request.payload);
+				editor->getSessionsHistory()->addSessionToEnd(newSession);
+				newSession->publishText("");
+				sessions[request.payload] = { newSession, new std::string() };
+			}
+			std::tie(session, text) = sessions[request.payload];
+			return true;
 		}
+		if (!session)
+			return false;
 
-		file.close();
+		Editor::setCurrentSession(session);
+		Editor::setCurrentText(text);
 
-		return text;
+		if (request.type == "LOAD") {
+			*text = request.payload;
+			if (Editor::isUtf8Mode())
+				session->getUtf8Index()->rebuild(*text);
+			session->publishText(*text);
+			return true;
+		}
+		return executeOnCurrentSession(editor, commandsManager, request, result);
 	}
 
-	static bool writeSessionData(std::string filename, std::string newData) {
-		std::ofstream file(DATA_DIRECTORY + filename);
+	static bool executeOnCurrentSession(Editor* editor, CommandsManager* commandsManager, const CommandsRecorder::Request& request, std::string& result) {
+		//запити редагування до поточного сеансу редактора; ним же користується тест навантаження з записом на диск
+		Session* session = Editor::getCurrentSession();
+		std::string* text = Editor::getCurrentText();
+		if (request.type == "BEGIN")
+			return session->beginTransaction();
+		if (request.type == "COMMIT")
+			return session->commitTransaction(editor, false);
+		if (request.type == "ROLLBACK")
+			return session->rollbackTransaction();
+		if (request.type == "UNDO" || request.type == "REDO") {
+			bool canBeExecuted = !session->isInTransaction() && (request.type == "UNDO" ?
+				session->canUndo() :
+				commandsManager->isThereAnyCommandForward());
+			return canBeExecuted && commandsManager->invokeCommand(request.type == "UNDO" ? "Undo" : "Redo");
+		}
+		if (!getTypeOfLinesCommand(request.type).empty()) {
+			commandsManager->invokeCommand(getTypeOfLinesCommand(request.type), 0, 0, request.payload);
+			return true;
+		}
+		if (int transform = TextTransforms::findTransform(request.type); transform != -1) {
+			commandsManager->invokeCommand(TextTransforms::NAMES[transform]);
+			return true;
+		}
+		if (request.type == "EXTERNALCHANGE") {
+			if (request.startPosition < 0 || request.startPosition > request.endPosition || request.endPosition > (long long)text->size())
+				return false;
+			commandsManager->invokeCommand("ExternalChange", (int)request.startPosition, (int)request.endPosition, request.payload);
+			return true;
+		}
 
-		if (!file.is_open())
+		std::string typeOfCommand = getTypeOfCommand(request.type);
+		if (typeOfCommand.empty() ||
+			!EditingServer::arePositionsValid(typeOfCommand, request.startPosition, request.endPosition, text->size()))
 			return false;
 
-		file << newData;
-		if(!newData.empty() && newData[newData.size() - 1] == '\n')
-			file << '\n';
-
-		file.close();
-
+		commandsManager->invokeCommand(typeOfCommand, (int)request.startPosition, (int)request.endPosition, request.payload);
+		if (typeOfCommand == "Copy" || typeOfCommand == "Cut")
+			result = session->getDataFromClipboardByIndex(session->sizeOfClipboard() - 1);
 		return true;
 	}
 };
 
-const std::string FilesManager::METADATA_DIRECTORY = "Metadata\\",
-FilesManager::DATA_DIRECTORY = "Data\\";
-
-void Editor::tryToLoadSessions() { FilesManager::readSessionsMetadata(this); }
-void Editor::tryToUnloadSessions() { FilesManager::writeSessionsMetadata(sessionsHistory); }
+class StreamingDocumentEngine : public ReplayEngine {
+	//еталон на StreamingDocument (рушій потокового режиму): текст - таблиця шматків над файлом на диску,
+	//а історія - список замін (позиція, видалені та вставлені байти), а не знімки тексту, як у редакторі
+private:
+	static const std::string DIRECTORY; //директорія, в якій лежать файли документів, поки йде відтворення
+
+	struct Change {
+		unsigned long long position; //з якої позиції починається заміна
+		std::string removedText, insertedText; //байти до та після заміни
+	};
+	struct Document {
+		StreamingDocument text; //текст документа
+		std::vector<std::vector<Change>> history; //записи історії: заміни, які вносить кожен з них
+		int currentIndex; //останній застосований запис (-1 - жодного)
+		bool isTransactionActive; //чи виконується пакет команд
+		std::vector<Change> changesOfTransaction; //заміни пакета, які стануть одним записом
+		std::string textBeforeTransaction; //текст до пакета
+	};
+
+	std::map<std::string, Document> documents; //відкриті документи
+	Document* document; //поточний документ
+	std::string nameOfDocument; //ім'я поточного документа
+
+	static std::string getFilepath(std::string name) { return DIRECTORY + name; }
+	bool loadDocument(std::string name, const std::string& text) {
+		//оригінал StreamingDocument - файл, тому текст спершу записується на диск; старий документ закривається до перезапису файлу
+		documents[name].text = StreamingDocument();
+		std::error_code errorCode;
+		std::filesystem::create_directories(DIRECTORY, errorCode);
+		std::ofstream file(getFilepath(name), std::ios::binary | std::ios::trunc);
+		file.write(text.data(), text.size());
+		file.close();
+		return !file.fail() && documents[name].text.open(getFilepath(name));
+	}
 
-Editor::Editor() { this->sessionsHistory = new SessionsHistory(); }
+	//межі символів визначаються так само, як у редакторі: у режимі UTF-8 за першими байтами символів;
+	//у неправильному UTF-8 байтів-продовжень може бути більше трьох, тому вікно читання росте
+	size_t getLengthOfCharacterAt(unsigned long long position) {
+		if (!Editor::isUtf8Mode())
+			return 1;
+		for (size_t sizeOfWindow = 4; ; sizeOfWindow *= 2) {
+			std::string window = document->text.read(position, sizeOfWindow);
+			size_t length = Utf8Index::getLengthOfCharacterAt(window, 0);
+			if (length < window.size() || window.size() < sizeOfWindow)
+				return length;
+		}
+	}
+	unsigned long long getStartOfLastCharacter() {
+		unsigned long long size = document->text.getSize();
+		if (size == 0)
+			return 0;
+		if (!Editor::isUtf8Mode())
+			return size - 1;
+		for (size_t sizeOfWindow = 4; ; sizeOfWindow *= 2) {
+			unsigned long long startOfTail = size - std::min<unsigned long long>(size, sizeOfWindow);
+			size_t startInTail = Utf8Index::getStartOfLastCharacter(document->text.read(startOfTail, sizeOfWindow));
+			if (startInTail > 0 || startOfTail == 0)
+				return startOfTail + startInTail;
+		}
+	}
 
-void Editor::copy(std::string textToProcess, int startPosition, int endPosition) {
-	std::string dataToCopy = textToProcess.substr(startPosition, endPosition - startPosition + 1);
-	currentSession->addDataToClipboard(dataToCopy);
-}
-void Editor::paste(std::string* textToProcess, int startPosition, int endPosition, std::string textToPaste) {
-	if (startPosition == endPosition) {
-		if(startPosition == 0)
-			*textToProcess = textToPaste + *textToProcess;
-		else if(startPosition == textToProcess->size() - 1)
-			*textToProcess += textToPaste;
-		else
-			(*textToProcess).replace(startPosition, endPosition - startPosition + 1, textToPaste);
+	void applyChange(const Change& change, bool isUndo) {
+		const std::string& textToRemove = isUndo ? change.insertedText : change.removedText;
+		document->text.remove(change.position, textToRemove.size());
+		document->text.insert(change.position, isUndo ? change.removedText : change.insertedText);
 	}
-	else
-	{
-		if(endPosition == -1)
-			(*textToProcess).replace(0, 1, textToPaste);
-		else if (endPosition == textToProcess->size()) 
-			(*textToProcess).replace(textToProcess->size() - 1, textToProcess->size() - 1, textToPaste);
+	void replace(unsigned long long position, unsigned long long removedLength, std::string_view textToInsert) {
+		Change change = { position, document->text.read(position, removedLength), std::string(textToInsert) };
+		applyChange(change, false);
+		if (document->isTransactionActive)
+			document->changesOfTransaction.push_back(change);
 		else
-			(*textToProcess).replace(startPosition, endPosition - startPosition + 1, textToPaste);
+			addToHistory({ change });
+	}
+	void addToHistory(std::vector<Change> changes) {
+		//скасування першого запису історії в редакторі дає порожній текст, тому перший запис будує текст з нуля
+		document->history.resize(document->currentIndex + 1);
+		if (document->currentIndex == -1)
+			changes = { { 0, "", getText() } };
+		document->history.push_back(changes);
+		document->currentIndex++;
 	}
-	*currentText = *textToProcess;
-}
-void Editor::cut(std::string* textToProcess, int startPosition, int endPosition) {
-	copy(*textToProcess, startPosition, endPosition);
-	remove(textToProcess, startPosition, endPosition);
-	*currentText = *textToProcess;
-}
-void Editor::remove(std::string* textToProcess, int startPosition, int endPosition) {
-	(*textToProcess).erase(startPosition, endPosition - startPosition + 1);
-	*currentText = *textToProcess;
-}
-
-Session* Editor::getCurrentSession() { return currentSession; }
-std::string* Editor::getCurrentText() { return currentText; }
-SessionsHistory* Editor::getSessionsHistory() { return sessionsHistory; }
-void Editor::setCurrentSession(Session* session) { currentSession = session; }
-void Editor::setCurrentText(std::string* text) { currentText = text; }
-
-void Editor::printCurrentText() {
-	system("cls");
-	std::cout << "\nЗміст файлу " << currentSession->getName() << ":\n";
-	*currentText != "" ? 
-		std::cout << "\"" << *currentText << "\"\n" : 
-		std::cout << "\nФайл пустий!\n";
-}
-
-SessionsHistory* Editor::sessionsHistory;
-Session* Editor::currentSession;
-std::string* Editor::currentText;
-
-CopyCommand::CopyCommand(Editor* editor) { this->editor = editor; }
-
-void CopyCommand::execute() { editor->copy(textToProcess, startPosition, endPosition); }
-void CopyCommand::undo() { }
-Command* CopyCommand::copy() { return nullptr; }
-
-DeleteCommand::DeleteCommand(Editor* editor) { this->editor = editor; }
-
-void DeleteCommand::execute() { editor->remove(&textToProcess, startPosition, endPosition); }
-void DeleteCommand::undo() { *(Editor::getCurrentText()) = previousCommand->getTextToProcess(); }
-Command* DeleteCommand::copy() { return new DeleteCommand(*this); }
-
-CutCommand::CutCommand(Editor* editor) { this->editor = editor; }
 
-void CutCommand::execute() { editor->cut(&textToProcess, startPosition, endPosition); }
-void CutCommand::undo() { *(Editor::getCurrentText()) = previousCommand->getTextToProcess(); }
-Command* CutCommand::copy() { return new CutCommand(*this); }
+	bool paste(long long startPosition, long long endPosition, std::string_view textToPaste) {
+		unsigned long long size = document->text.getSize(), startOfLastCharacter = getStartOfLastCharacter();
+		if (startPosition > endPosition && endPosition > -1 && startPosition < (long long)size)
+			std::swap(startPosition, endPosition);
+		if (startPosition == -1 && endPosition == -1)
+			startPosition = endPosition = 0;
+
+		unsigned long long position = startPosition, removedLength;
+		if (startPosition == endPosition) {
+			if (startPosition == 0)
+				removedLength = 0;
+			else if ((unsigned long long)startPosition >= startOfLastCharacter) {
+				position = size;
+				removedLength = 0;
+			}
+			else
+				removedLength = getLengthOfCharacterAt(startPosition);
+		}
+		else if (endPosition == -1) {
+			position = 0;
+			removedLength = getLengthOfCharacterAt(0);
+		}
+		else if (endPosition == (long long)size) {
+			position = startOfLastCharacter;
+			removedLength = size - startOfLastCharacter;
+		}
+		else
+			removedLength = endPosition + getLengthOfCharacterAt(endPosition) - startPosition;
 
-PasteCommand::PasteCommand(Editor* editor) { this->editor = editor; }
+		position = std::min(position, size);
+		replace(position, std::min(removedLength, size - position), textToPaste);
+		return true;
+	}
+	std::string processLines(std::string typeOfRequest, std::string pattern) {
+		//проста послідовна версія команд над рядками: окремі рядки-копії, звичайне сортування та множина
+		std::istringstream text(getText());
+		std::vector<std::string> lines, processedLines;
+		std::map<std::string, int> seenLines;
+		for (std::string line; getline(text, line); )
+			lines.push_back(line);
+
+		if (typeOfRequest == "SORTLINES")
+			std::sort(lines.begin(), lines.end());
+		for (std::string& line : lines)
+			if (typeOfRequest == "SORTLINES" ||
+				typeOfRequest == "UNIQUELINES" && seenLines[line]++ == 0 ||
+				typeOfRequest != "UNIQUELINES" && (line.find(pattern) != std::string::npos) == (typeOfRequest == "KEEPLINES"))
+				processedLines.push_back(line);
+
+		std::string result;
+		unsigned long long size = document->text.getSize();
+		bool hasFinalNewline = size > 0 && document->text.read(size - 1, 1) == "\n";
+		for (size_t i = 0; i < processedLines.size(); i++)
+			result += processedLines[i] + (i + 1 < processedLines.size() || hasFinalNewline ? "\n" : "");
+		return result;
+	}
+	void remove(long long startPosition, long long endPosition, std::string* removedData) {
+		unsigned long long removedLength = std::min<unsigned long long>(endPosition + getLengthOfCharacterAt(endPosition) - startPosition,
+			document->text.getSize() - startPosition);
+		if (removedData)
+			*removedData = document->text.read(startPosition, removedLength);
+		replace(startPosition, removedLength, "");
+	}
 
-void PasteCommand::execute() { editor->paste(&textToProcess, startPosition, endPosition, textToPaste); }
-void PasteCommand::undo() {
-	if (previousCommand)
-		*(Editor::getCurrentText()) = previousCommand->getTextToProcess();
-	else
-		*(Editor::getCurrentText()) = "";
-}
-Command* PasteCommand::copy() { return new PasteCommand(*this); }
+public:
+	StreamingDocumentEngine() { document = nullptr; }
+	~StreamingDocumentEngine() {
+		//файли документів потрібні лише під час відтворення
+		for (auto& [name, openedDocument] : documents) {
+			openedDocument.text = StreamingDocument();
+			std::filesystem::remove(getFilepath(name));
+		}
+		std::error_code errorCode;
+		std::filesystem::remove(DIRECTORY, errorCode);
+	}
 
-void UndoCommand::execute() { commandToUndoOrRedo->undo(); }
-void UndoCommand::undo() { }
-Command* UndoCommand::copy() { return nullptr; }
+	std::string getName() { return "StreamingDocument"; }
+	std::string getText() { return document ? document->text.read(0, document->text.getSize()) : ""; }
+	unsigned long long getSize() { return document ? document->text.getSize() : 0; }
 
-void RedoCommand::execute() { *(Editor::getCurrentText()) = commandToUndoOrRedo->getTextToProcess(); }
-void RedoCommand::undo() { }
-Command* RedoCommand::copy() { return nullptr; }
+	bool execute(const CommandsRecorder::Request& request, std::string& result) {
+		if (request.type == "MODE")
+			return true;
+		if (request.type == "OPEN") {
+			if (documents.find(request.payload) == documents.end()) {
+				documents[request.payload] = { StreamingDocument(), {}, -1, false, {}, "" };
+				if (!loadDocument(request.payload, ""))
+					return false;
+			}
+			document = &documents[request.payload];
+			nameOfDocument = request.payload;
+			return true;
+		}
+		if (!document)
+			return false;
 
-class CommandsManager {
-private:
-	std::stack<std::pair<std::string, Command*>> manager; //зберігач усіх команд, дозволяє зручно їми керувати за допомогою поліморфізму
+		if (request.type == "LOAD")
+			return loadDocument(nameOfDocument, request.payload);
+		if (request.type == "BEGIN") {
+			if (document->isTransactionActive)
+				return false;
+			document->isTransactionActive = true;
+			document->textBeforeTransaction = getText();
+			return true;
+		}
+		if (request.type == "COMMIT" || request.type == "ROLLBACK") {
+			if (!document->isTransactionActive)
+				return false;
+			document->isTransactionActive = false;
 
-	Command* getCommandFromManagerByKey(std::string typeOfCommand) {
-		for (int i = 0; i < manager.size(); i++)
-			if (manager._Get_container()[i].first == typeOfCommand)
-				return manager._Get_container()[i].second;
-	}
-	bool isNotUndoOrRedoCommand(std::string typeOfCommand) { return typeOfCommand != "Undo" && typeOfCommand != "Redo"; }
-	void setParametersForCommand(std::string typeOfCommand, int startPosition, int endPosition, std::string textToPaste) {
-		Command* commandToUndoOrRedo = nullptr, * previousCommand = nullptr;
+			bool isTextChanged = request.type == "COMMIT" && !document->changesOfTransaction.empty() &&
+				getText() != document->textBeforeTransaction;
+			if (isTextChanged)
+				addToHistory(document->changesOfTransaction);
+			else
+				//без змін історія лишається як була, тому заміни пакета відкочуються
+				for (auto change = document->changesOfTransaction.rbegin(); change != document->changesOfTransaction.rend(); change++)
+					applyChange(*change, true);
+			document->changesOfTransaction.clear();
+			return true;
+		}
+		if (request.type == "UNDO") {
+			if (document->isTransactionActive || document->currentIndex == -1)
+				return false;
+			const std::vector<Change>& changes = document->history[document->currentIndex--];
+			for (auto change = changes.rbegin(); change != changes.rend(); change++)
+				applyChange(*change, true);
+			return true;
+		}
+		if (request.type == "REDO") {
+			if (document->isTransactionActive || document->currentIndex + 1 >= (int)document->history.size())
+				return false;
+			for (const Change& change : document->history[++document->currentIndex])
+				applyChange(change, false);
+			return true;
+		}
 
-		if (typeOfCommand == "Undo")
-			commandToUndoOrRedo = Editor::getCurrentSession()->getCommandByIndex(Editor::getCurrentSession()->getCurIndexInCommHistory());
+		unsigned long long size = document->text.getSize();
+		if (request.type == "SORTLINES" || request.type == "UNIQUELINES" || request.type == "KEEPLINES" || request.type == "DROPLINES") {
+			replace(0, size, processLines(request.type, request.payload));
+			return true;
+		}
+		if (int transform = TextTransforms::findTransform(request.type); transform != -1) {
+			//еталон - скалярна версія перетворення, а скасування - звичайний запис історії замін
+			std::string text = getText();
+			TextTransforms::apply((TextTransforms::Transform)transform, text, Editor::isUtf8Mode(), nullptr, TextTransforms::SCALAR);
+			replace(0, size, text);
+			return true;
+		}
+		if (request.type == "EXTERNALCHANGE") {
+			if (request.startPosition < 0 || request.startPosition > request.endPosition || request.endPosition > (long long)size)
+				return false;
+			replace(request.startPosition, request.endPosition - request.startPosition, request.payload);
+			return true;
+		}
 
-		if(typeOfCommand == "Redo")
-			commandToUndoOrRedo = Editor::getCurrentSession()->getCommandByIndex(Editor::getCurrentSession()->getCurIndexInCommHistory() + 1);
+		std::string typeOfCommand = request.type == "PASTE" ? "Paste" : "Other";
+		if ((request.type != "PASTE" && request.type != "DELETE" && request.type != "CUT" && request.type != "COPY") ||
+			!EditingServer::arePositionsValid(typeOfCommand, request.startPosition, request.endPosition, size))
+			return false;
 
-		if (Editor::getCurrentSession()->getCurIndexInCommHistory() != -1 && isNotUndoOrRedoCommand(typeOfCommand))
-			previousCommand = Editor::getCurrentSession()->getCommandByIndex(Editor::getCurrentSession()->sizeOfCommandsHistory() - 1);
+		if (request.type == "PASTE")
+			return paste(request.startPosition, request.endPosition, request.payload);
+		if (request.type == "COPY")
+			result = document->text.read(request.startPosition, request.endPosition + getLengthOfCharacterAt(request.endPosition) - request.startPosition);
+		else
+			remove(request.startPosition, request.endPosition, request.type == "CUT" ? &result : nullptr);
+		return true;
+	}
+};
 
-		
+const std::string StreamingDocumentEngine::DIRECTORY = "Replay\\";
 
-		getCommandFromManagerByKey(typeOfCommand)->setParameters(typeOfCommand, previousCommand, commandToUndoOrRedo, startPosition, endPosition, textToPaste);
+class ReplayHarness {
+private:
+	static const int COUNT_OF_GENERATED_SESSIONS; //між скількома сеансами перемикається генератор
+	static const size_t MAX_SIZE_OF_GENERATED_PASTE; //найбільший текст вставки генератора
+	static const double ZIPF_EXPONENT; //наскільки популярність сеансів навантаження спадає з їхнім номером
+	static const int MAX_COUNT_OF_EDITS_IN_VISIT; //найбільша кількість правок за одне відкриття сеансу в навантаженні
+
+	struct Outcome {
+		bool isAccepted; //чи виконав рушій запит
+		std::string result; //скопійовані дані
+		size_t hashOfText, sizeOfText; //стан тексту після запиту
+	};
+
+	static std::vector<Outcome> replay(ReplayEngine* engine, const std::vector<CommandsRecorder::Request>& requests, long long& durationInNs) {
+		//час рахується лише для виконання запитів, без знімання стану для порівняння
+		std::vector<Outcome> outcomes(requests.size());
+		durationInNs = 0;
+		for (size_t i = 0; i < requests.size(); i++) {
+			auto start = std::chrono::steady_clock::now();
+			outcomes[i].isAccepted = engine->execute(requests[i], outcomes[i].result);
+			durationInNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+			std::string text = engine->getText();
+			outcomes[i].hashOfText = std::hash<std::string>()(text);
+			outcomes[i].sizeOfText = text.size();
+		}
+		return outcomes;
 	}
-	int getCountOfForwardCommands() {
-		return Editor::getCurrentSession()->sizeOfCommandsHistory() - 1 - Editor::getCurrentSession()->getCurIndexInCommHistory();
+	static std::string describeRequest(const CommandsRecorder::Request& request) {
+		std::string line = CommandsRecorder::formatRequest({ request.type, request.startPosition, request.endPosition,
+			request.type == "OPEN" || request.type == "MODE" ? request.payload : "" });
+		line.pop_back();
+		return line;
 	}
-	void deleteForwardCommandsIfNecessary(std::string typeOfCommand) {
-		if (typeOfCommand != "Undo" && typeOfCommand != "Redo" && isThereAnyCommandForward())
-		{
-			int countOfForwardCommands = getCountOfForwardCommands();
-			for (int i = 0; i < countOfForwardCommands; i++)
-				Editor::getCurrentSession()->deleteLastCommand();
-		}
+	static std::string generateText(std::mt19937& generator, size_t length, bool isUtf8) {
+		static const std::string_view utf8Characters[] = { "a", "B", " ", "\t", "\r", "\n", "ї", "€", "😀" },
+			bytesCharacters[] = { "a", "B", " ", "\t", "\r", "\n", "\xFF" };
+		std::string text;
+		for (size_t i = 0; i < length; i++)
+			text += isUtf8 ? utf8Characters[generator() % std::size(utf8Characters)] : bytesCharacters[generator() % std::size(bytesCharacters)];
+		return text;
 	}
 
 public:
-	CommandsManager(Editor* editor) {
-		manager.push(std::pair("Copy", new CopyCommand(editor)));
-		manager.push(std::pair("Paste", new PasteCommand(editor)));
-		manager.push(std::pair("Cut", new CutCommand(editor)));
-		manager.push(std::pair("Delete", new DeleteCommand(editor)));
-		manager.push(std::pair("Undo", new UndoCommand()));
-		manager.push(std::pair("Redo", new RedoCommand()));
+	static bool readRecording(std::string filepath, std::vector<CommandsRecorder::Request>& requests) {
+		std::ifstream file(filepath, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		CommandsRecorder::Request request;
+		while (CommandsRecorder::readRequest(file, request))
+			requests.push_back(request);
+		return file.eof();
 	}
-	~CommandsManager() {
-		while (!manager.empty())
-		{
-			delete manager.top().second;
-			manager.pop();
-		}
+	static bool writeRecording(std::string filepath, const std::vector<CommandsRecorder::Request>& requests) {
+		std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+		for (const CommandsRecorder::Request& request : requests)
+			file << CommandsRecorder::formatRequest(request);
+		return file.good();
 	}
 
-	bool isThereAnyCommandForward() {
-		return Editor::getCurrentSession()->sizeOfCommandsHistory() != 0 &&
-			Editor::getCurrentSession()->getCurIndexInCommHistory() < Editor::getCurrentSession()->sizeOfCommandsHistory() - 1;
+	static std::vector<CommandsRecorder::Request> generateRequests(int countOfRequests, unsigned int seed, bool isUtf8) {
+		//позиції обираються за поточним текстом еталонного рушія; частина запитів навмисно неправильна,
+		//щоб перевірити й однакове відхилення
+		std::mt19937 generator(seed);
+		std::vector<CommandsRecorder::Request> requests;
+		StreamingDocumentEngine model;
+		std::map<std::string, bool> openedSessions;
+		std::string result;
+
+		Editor::setUtf8Enabled(isUtf8);
+		requests.push_back({ "MODE", 0, 0, isUtf8 ? "UTF8" : "BYTES" });
+
+		auto addRequest = [&](CommandsRecorder::Request request) {
+			model.execute(request, result);
+			requests.push_back(request);
+		};
+		auto openSession = [&](std::string name) {
+			addRequest({ "OPEN", 0, 0, name });
+			if (!openedSessions[name]) {
+				openedSessions[name] = true;
+				addRequest({ "LOAD", 0, 0, generator() % 2 ? generateText(generator, generator() % 64, isUtf8) : "" });
+			}
+		};
+		auto getPosition = [&]() -> long long {
+			long long size = model.getSize();
+			if (generator() % 10 == 0) {
+				long long edgePositions[] = { -1, 0, size - 1, size, size + 1 };
+				return edgePositions[generator() % std::size(edgePositions)];
+			}
+			return size > 0 ? generator() % size : 0;
+		};
+
+		openSession("replay-1");
+		while ((int)requests.size() < countOfRequests) {
+			int kind = generator() % 100;
+			long long startPosition = getPosition(), endPosition;
+
+			if (kind < 2)
+				openSession("replay-" + std::to_string(1 + generator() % COUNT_OF_GENERATED_SESSIONS));
+			else if (kind < 7)
+				addRequest({ kind < 4 ? "BEGIN" : kind < 6 ? "COMMIT" : "ROLLBACK", 0, 0, "" });
+			else if (kind < 27)
+				addRequest({ kind < 19 ? "UNDO" : "REDO", 0, 0, "" });
+			else if (kind < 60) {
+				endPosition = generator() % 20 == 0 ? getPosition() :
+					std::min<long long>(startPosition + generator() % 32, (long long)model.getSize() - 1);
+				addRequest({ kind < 37 ? "COPY" : kind < 45 ? "CUT" : "DELETE", startPosition, endPosition, "" });
+			}
+			else if (kind < 63) {
+				std::string typeOfRequest = kind == 60 ? (generator() % 2 ? "SORTLINES" : "UNIQUELINES") : kind == 61 ? "KEEPLINES" : "DROPLINES";
+				addRequest({ typeOfRequest, 0, 0, kind == 60 ? "" : generateText(generator, 1 + generator() % 2, isUtf8) });
+			}
+			else if (kind < 66) {
+				std::string typeOfRequest = TextTransforms::NAMES[generator() % TextTransforms::COUNT_OF_TRANSFORMS];
+				for (char& symbol : typeOfRequest)
+					symbol = toupper(symbol);
+				addRequest({ typeOfRequest, 0, 0, "" });
+			}
+			else if (kind < 68) {
+				//зміна файлу іншою програмою; у режимі UTF-8 лише на межах тексту, щоб не розрізати символ
+				long long size = model.getSize();
+				if (isUtf8) {
+					startPosition = generator() % 2 ? 0 : size;
+					endPosition = generator() % 2 ? size : startPosition;
+				}
+				else
+					endPosition = std::min<long long>(startPosition + generator() % 16, size);
+				addRequest({ "EXTERNALCHANGE", startPosition, endPosition, generateText(generator, generator() % 9, isUtf8) });
+			}
+			else {
+				int kindOfRange = generator() % 4;
+				endPosition = kindOfRange == 0 ? startPosition : kindOfRange == 1 ? getPosition() :
+					startPosition + generator() % 8;
+				size_t sizeOfPaste = generator() % 20 == 0 ? generator() % MAX_SIZE_OF_GENERATED_PASTE : generator() % 9;
+				addRequest({ "PASTE", startPosition, endPosition, generateText(generator, sizeOfPaste, isUtf8) });
+			}
+		}
+		return requests;
 	}
-	void invokeCommand(std::string typeOfCommand, int startPosition = 0, int endPosition = 0, std::string textToPaste = "") {
 
-		deleteForwardCommandsIfNecessary(typeOfCommand);
-		setParametersForCommand(typeOfCommand, startPosition, endPosition, textToPaste);
-
-		getCommandFromManagerByKey(typeOfCommand)->execute();
+	static std::vector<CommandsRecorder::Request> generateWorkload(int countOfSessions, int countOfEdits, unsigned int seed, bool isUtf8) {
+		//сеанси відкриваються за законом Ціпфа (кілька популярних сеансів і довгий хвіст рідко відкритих),
+		//за кожне відкриття - серія правок: 80% вставок, 15% видалень, 5% скасувань
+		std::mt19937 generator(seed);
+		std::vector<double> weightsOfSessions(countOfSessions);
+		for (int i = 0; i < countOfSessions; i++)
+			weightsOfSessions[i] = 1.0 / std::pow(i + 1, ZIPF_EXPONENT);
+		std::discrete_distribution<int> chooseSession(weightsOfSessions.begin(), weightsOfSessions.end());
+
+		std::vector<CommandsRecorder::Request> requests;
+		StreamingDocumentEngine model;
+		std::string result;
+		auto addRequest = [&](CommandsRecorder::Request request) {
+			model.execute(request, result);
+			requests.push_back(request);
+		};
+
+		addRequest({ "MODE", 0, 0, isUtf8 ? "UTF8" : "BYTES" });
+		for (int countOfGenerated = 0; countOfGenerated < countOfEdits;) {
+			addRequest({ "OPEN", 0, 0, "workload-" + std::to_string(1 + chooseSession(generator)) });
+			int countOfEditsInVisit = 1 + generator() % MAX_COUNT_OF_EDITS_IN_VISIT;
+			for (int i = 0; i < countOfEditsInVisit && countOfGenerated < countOfEdits; i++, countOfGenerated++) {
+				int kind = generator() % 100;
+				long long size = model.getSize(), startPosition = size > 0 ? generator() % size : 0;
+				if (kind < 80 || (kind < 95 && size == 0))
+					addRequest({ "PASTE", startPosition, startPosition, generateText(generator, 8 + generator() % 57, isUtf8) });
+				else if (kind < 95)
+					addRequest({ "DELETE", startPosition, std::min<long long>(startPosition + generator() % 32, size - 1), "" });
+				else
+					addRequest({ "UNDO", 0, 0, "" });
+			}
+		}
+		return requests;
+	}
 
-		if (isNotUndoOrRedoCommand(typeOfCommand) && typeOfCommand != "Copy")
-			Editor::getCurrentSession()->addCommandAsLast(getCommandFromManagerByKey(typeOfCommand)->copy());
+	static bool compareEngines(const std::vector<CommandsRecorder::Request>& requests) {
+		//кожен рушій відтворює весь потік окремо, після чого результати порівнюються запит за запитом
+		bool isUtf8 = !requests.empty() && requests[0].type == "MODE" && requests[0].payload == "UTF8";
+		Editor::setUtf8Enabled(isUtf8);
+
+		std::vector<std::vector<Outcome>> outcomes;
+		std::vector<std::string> names;
+		for (int i = 0; i < 2; i++) {
+			ReplayEngine* engine = i == 0 ? (ReplayEngine*)new CommandsManagerEngine() : new StreamingDocumentEngine();
+			long long durationInNs;
+			names.push_back(engine->getName());
+			outcomes.push_back(replay(engine, requests, durationInNs));
+			delete engine;
+
+			std::cout << names.back() << ": " << requests.size() << " запитів за " << durationInNs / 1000000.0 << " мс ("
+				<< (long long)(requests.size() / std::max(durationInNs / 1e9, 1e-9)) << " запитів/с)\n";
+		}
 
-		if(typeOfCommand == "Undo")
-			Editor::getCurrentSession()->setCurIndexInCommHistory(Editor::getCurrentSession()->getCurIndexInCommHistory() - 1);
-		else
-			if (typeOfCommand != "Copy")
-				Editor::getCurrentSession()->setCurIndexInCommHistory(Editor::getCurrentSession()->getCurIndexInCommHistory() + 1);
+		for (size_t i = 0; i < requests.size(); i++) {
+			const Outcome& first = outcomes[0][i], & second = outcomes[1][i];
+			if (first.isAccepted != second.isAccepted || first.result != second.result ||
+				first.hashOfText != second.hashOfText || first.sizeOfText != second.sizeOfText) {
+				std::cout << "\nРозбіжність на запиті " << i + 1 << ": " << describeRequest(requests[i]) << "\n";
+				std::cout << "  " << names[0] << ": " << (first.isAccepted ? "виконано" : "відхилено") << ", розмір тексту " << first.sizeOfText << "\n";
+				std::cout << "  " << names[1] << ": " << (second.isAccepted ? "виконано" : "відхилено") << ", розмір тексту " << second.sizeOfText << "\n";
+				return false;
+			}
+		}
+		std::cout << "\nРезультати рушіїв збігаються.\n";
+		return true;
 	}
 };
 
+const int ReplayHarness::COUNT_OF_GENERATED_SESSIONS = 3;
+const size_t ReplayHarness::MAX_SIZE_OF_GENERATED_PASTE = 2000;
+const double ReplayHarness::ZIPF_EXPONENT = 1.0;
+const int ReplayHarness::MAX_COUNT_OF_EDITS_IN_VISIT = 16;
+
 class Program {
 private:
+	static const std::string PROFILE_FILEPATH, //файл для експорту статистики інструментування
+		TRACE_FILEPATH; //файл для експорту подій у форматі Chrome trace
+	static const int COUNT_OF_SEARCH_RESULTS; //скільки найкращих збігів показує пошук сеансів
+	static const int SIZE_OF_SESSIONS_PAGE; //скільки сеансів на одній сторінці впорядкованого перегляду
+	static const unsigned long long STREAMING_MODE_THRESHOLD; //з якого розміру файл редагується потоково, без завантаження в пам'ять
+	static const size_t SIZE_OF_STREAMING_PREVIEW; //скільки байтів з початку файлу показувати в потоковому режимі
+	static const std::string DEFAULT_SOCKET_PATH; //сокет сервера редагування за замовчуванням
+	static const std::string FUZZ_RECORDING_FILEPATH; //куди зберігається випадковий потік запитів для повторного відтворення
+	static const std::string WORKLOAD_RECORDING_FILEPATH; //куди зберігається згенероване навантаження для повторного відтворення
+	static const std::string WORKLOAD_DIRECTORY; //чиста директорія, в якій тест навантаження створює Data та Metadata
+	static const int WORKLOAD_MEMORY_SAMPLING_INTERVAL; //через скільки запитів тест навантаження заміряє робочий набір процесу
+
 	Editor* editor; //редактор
 	CommandsManager* commandsManager; //менеджер команд, за допомогою якого й викликаються усі команди
-
-	bool validateEnteredNumber(std::string option, short firstOption, short lastOption) {
-		if (option.empty())
+	SessionBuffersCache buffersCache; //тексти нещодавно відкритих сеансів, щоб не читати їх з диска щоразу
+	HistoryCompactor historyCompactor; //у фоні зливає стару історію сеансів за політикою зберігання та витісняє її на диск понад бюджет пам'яті
+	DataDirectoryWatcher dataWatcher; //повідомляє про файли сеансів, змінені іншими програмами
+	std::shared_ptr<const std::string> textOfOpenedSessionInFile; //що лежить у файлі відкритого сеансу, поки в буфері є незбережені об'єднані правки (nullptr - те саме, що в буфері)
+
+	bool validateEnteredNumber(std::string option, int firstOption, int lastOption) {
+		//довші рядки цифр не вміщаються в int і могли б переповнити stoull
+		if (option.empty() || option.size() > 10)
 			return false;
 
 		for (char num : option)
@@ -700,10 +7064,76 @@ private:
 
 		return isOptionVerified ? stoi(option) : -1;
 	}
-	void readDataFromFile() {
-		std::string filepath = FilesManager::getSessionsDirectory() + editor->getCurrentSession()->getName();
-		std::string textFromFile = FilesManager::readSessionData(filepath);
-		editor->setCurrentText(new std::string(textFromFile));
+	bool readDataFromFile() {
+		//текст, знайдений у кеші, вже актуальний: команди змінюють його на місці та публікують кожну нову версію,
+		//а тексти, файли яких змінила інша програма, викидаються з кешу перед пошуком
+		Session* session = editor->getCurrentSession();
+		textOfOpenedSessionInFile = nullptr;
+		applyExternalChanges(nullptr);
+		std::string* text = buffersCache.get(session);
+
+		if (!text) {
+			std::string textFromFile = FilesManager::readSessionDataByName(session->getName());
+			if (Editor::isUtf8Mode() && !Utf8Index::isValid(textFromFile)) {
+				printNotification("error", "текст сеансу не в кодуванні UTF-8!");
+				return false;
+			}
+
+			FilesManager::loadSessionHistory(editor, session);
+			if (Editor::isUtf8Mode())
+				session->getUtf8Index()->rebuild(textFromFile);
+			session->publishText(textFromFile);
+			text = buffersCache.put(session, std::move(textFromFile));
+			FilesManager::rememberDataState(session->getName());
+		}
+		else
+			FilesManager::updateAccessTime(session);
+		editor->setCurrentText(text);
+		return true;
+	}
+	void applyExternalChanges(Session* openedSession) {
+		//файли, змінені іншою програмою: відкритий текст отримує зміну як запис історії (тому її можна скасувати),
+		//а тексти інших сеансів викидаються з кешу, щоб наступне відкриття прочитало файл заново
+		bool wasOverflowed;
+		std::vector<std::string> filenames = dataWatcher.takeChangedFiles(wasOverflowed);
+		if (wasOverflowed)
+			filenames = FilesManager::getNamesOfRememberedData();
+
+		for (std::string& filename : filenames) {
+			Session* session = editor->getSessionsHistory()->getSessionByName(filename);
+			if (!session || !FilesManager::hasDataChangedExternally(filename))
+				continue;
+			if (session != openedSession) {
+				buffersCache.invalidate(session);
+				continue;
+			}
+
+			//незбережені об'єднані правки є лише в буфері, тому зміна шукається відносно тексту, який лежав у файлі,
+			//і лише потім переноситься в буфер
+			FilesManager::ExternalChange change;
+			if (!FilesManager::readExternalChange(filename, textOfOpenedSessionInFile ? *textOfOpenedSessionInFile : *editor->getCurrentText(), change))
+				continue;
+			if (change.isRejected) {
+				printNotification("error", "файл сеансу змінила інша програма, але новий текст не в кодуванні UTF-8, тому зміна не застосована!");
+				continue;
+			}
+
+			bool isMergedWithUnsavedEdits = true;
+			if (textOfOpenedSessionInFile) {
+				std::shared_ptr<std::string> newTextInFile = std::make_shared<std::string>(*textOfOpenedSessionInFile);
+				newTextInFile->replace(change.startPosition, change.endPosition - change.startPosition, change.text);
+				isMergedWithUnsavedEdits = FilesManager::moveExternalChangeOverUnsavedEdits(*textOfOpenedSessionInFile, *editor->getCurrentText(), change);
+				textOfOpenedSessionInFile = newTextInFile;
+			}
+
+			commandsManager->invokeCommand("ExternalChange", change.startPosition, change.endPosition, change.text);
+			if (!isMergedWithUnsavedEdits)
+				successNotification("зміна іншої програми зачепила незбережені правки, тому ця ділянка взята з файлу (правки повертає скасування)");
+			printNotification("success", "файл сеансу змінила інша програма, зміна записана в історію (" + (change.isAppend ?
+				"дописано байтів: " + std::to_string(change.text.size()) :
+				"замінено байти " + std::to_string(change.startPosition) + "-" + std::to_string(change.endPosition) +
+				" на " + std::to_string(change.text.size())) + ")!");
+		}
 	}
 	void pauseAndCleanConsole() {
 		system("pause");
@@ -741,7 +7171,9 @@ private:
 		std::cout << "3. За позицією\n";
 		std::cout << "4. За іменем\n";
 		std::cout << "5. Відсортувати сеанси за іменем\n";
-		choice = enterNumberInRange("Ваш вибір: ", 0, 5);
+		std::cout << "6. Знайти за частиною імені\n";
+		std::cout << "7. Переглянути сеанси у впорядкованому вигляді\n";
+		choice = enterNumberInRange("Ваш вибір: ", 0, 7);
 	}
 	void templateForExecutingMenusAboutSessions(std::function<void(int&)> mainFunc, std::function<void(int&)> menu,
 		std::function<bool()> actionFuncByName, std::function<void()> additionalFunc = nullptr) {
@@ -779,6 +7211,15 @@ private:
 						continue;
 					case 5:
 						sortSessions();
+						continue;
+					case 6:
+					case 7:
+						index = choice == 6 ? searchSession() : browseSortedSessions();
+						if (index == -1)
+							continue;
+						mainFunc(index);
+						if (additionalFunc)
+							additionalFunc();
 					}
 				}
 			}
@@ -840,8 +7281,13 @@ private:
 
 	bool makeActionOnContextByEnteredText(std::string typeOfCommand, std::string actionInPast,
 		std::string textToPaste = "", size_t startIndex = -2, size_t endIndex = -2) {
+		if (Editor::isUtf8Mode() && !Utf8Index::isValid(textToPaste)) {
+			printNotification("error", "текст для вставки не в кодуванні UTF-8!");
+			return false;
+		}
 		if (startIndex == -2 && endIndex == -2) {
-			if (editor->getCurrentText()->empty()) {
+			std::shared_ptr<const std::string> text = editor->getCurrentTextSnapshot();
+			if (text->empty()) {
 				printNotification("error", "немає тексту, який можна було б замінити!");
 				return false;
 			}
@@ -850,63 +7296,415 @@ private:
 
 			textForAction = getTextUsingKeyboard();
 
-			if (textForAction.empty()) {
-				printNotification("error", "текст не був введений!");
-				return false;
+			if (textForAction.empty()) {
+				printNotification("error", "текст не був введений!");
+				return false;
+			}
+
+			startIndex = text->find(textForAction);
+
+			if (startIndex == std::string::npos) {
+				printNotification("error", "текст не був знайдений!");
+				return false;
+			}
+
+			if (typeOfCommand == "Paste") {
+				if (startIndex == 0 && textForAction.size() == 1)
+					endIndex = -1;
+				else if (startIndex == text->size() - 1 && textForAction.size() == 1)
+					endIndex = text->size();
+				else
+					endIndex = startIndex + textForAction.size() - 1;
+			}
+			else {
+				if (textForAction.size() == 1)
+					endIndex = startIndex;
+				else
+					endIndex = startIndex + textForAction.size() - 1;
+			}
+		}
+
+		commandsManager->invokeCommand(typeOfCommand, startIndex, endIndex, textToPaste);
+		printNotification("success", "дані були успішно " + actionInPast + "!");
+		return true;
+	}
+
+	bool undoAction() {
+		if (editor->getCurrentSession()->isInTransaction()) {
+			printNotification("error", "під час пакета команд скасування недоступне!");
+			return false;
+		}
+		if (editor->getCurrentSession()->canUndo())
+		{
+			if (!commandsManager->invokeCommand("Undo")) {
+				printNotification("error", "не вдалося прочитати знімок історії з диска, команду не скасовано!");
+				return false;
+			}
+			printNotification("success", "команда була успішно скасована!");
+			return true;
+		}
+		printNotification("error", "немає дій, які можна було б скасувати!");
+		return false;
+	}
+	bool redoAction() {
+		if (editor->getCurrentSession()->isInTransaction()) {
+			printNotification("error", "під час пакета команд повторення недоступне!");
+			return false;
+		}
+		bool isThereAnyCommandForward = commandsManager->isThereAnyCommandForward();
+		if (isThereAnyCommandForward)
+		{
+			if (!commandsManager->invokeCommand("Redo")) {
+				printNotification("error", "не вдалося прочитати знімок історії з диска, команду не повторено!");
+				return false;
+			}
+			printNotification("success", "команда була успішно повторена!");
+
+		}
+		else
+			printNotification("error", "немає дій, які можна було б повторити!");
+		return isThereAnyCommandForward;
+	}
+	void linesActionsMenu(int& choice) {
+		std::cout << "\nЩо зробити з рядками:\n";
+		std::cout << "0. Назад\n";
+		std::cout << "1. Відсортувати\n";
+		std::cout << "2. Видалити повтори\n";
+		std::cout << "3. Залишити рядки, які містять текст\n";
+		std::cout << "4. Видалити рядки, які містять текст\n";
+		choice = enterNumberInRange("Ваш вибір: ", 0, 4);
+	}
+	bool executeLinesAction() {
+		int choice;
+		std::string pattern;
+
+		linesActionsMenu(choice);
+		if (choice <= 0)
+			return false;
+		if (choice >= 3) {
+			std::cout << "\nВведіть текст, який шукати в рядках: ";
+			getline(std::cin, pattern);
+			if (pattern.empty()) {
+				printNotification("error", "текст для пошуку порожній!");
+				return false;
+			}
+			if (Editor::isUtf8Mode() && !Utf8Index::isValid(pattern)) {
+				printNotification("error", "текст не в кодуванні UTF-8!");
+				return false;
+			}
+		}
+
+		std::string typesOfCommands[] = { "SortLines", "UniqueLines", "KeepLines", "DropLines" };
+		size_t sizeBefore = editor->getCurrentText()->size();
+		auto start = std::chrono::steady_clock::now();
+		commandsManager->invokeCommand(typesOfCommands[choice - 1], 0, 0, pattern);
+		auto durationInMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+		printNotification("success", "рядки були оброблені за " + std::to_string(durationInMs) + " мс (байтів: " +
+			std::to_string(sizeBefore) + " -> " + std::to_string(editor->getCurrentText()->size()) + ")!");
+		return true;
+	}
+	void transformsMenu(int& choice) {
+		std::cout << "\nЯк перетворити текст:\n";
+		std::cout << "0. Назад\n";
+		std::cout << "1. Великі літери\n";
+		std::cout << "2. Малі літери\n";
+		std::cout << "3. Прибрати пробіли в кінці рядків\n";
+		std::cout << "4. Кінці рядків CRLF -> LF\n";
+		std::cout << "5. Кінці рядків LF -> CRLF\n";
+		std::cout << "6. Табуляції -> пробіли\n";
+		std::cout << "7. Пробіли у відступах -> табуляції\n";
+		choice = enterNumberInRange("Ваш вибір: ", 0, TextTransforms::COUNT_OF_TRANSFORMS);
+	}
+	bool executeTransform() {
+		int choice;
+		transformsMenu(choice);
+		if (choice <= 0)
+			return false;
+
+		auto start = std::chrono::steady_clock::now();
+		commandsManager->invokeCommand(TextTransforms::NAMES[choice - 1]);
+		auto durationInMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+		//у пакеті команд запис в історію з'явиться лише після підтвердження, а фонове стискання історії
+		//могло вже злити запис у базовий знімок, тоді розмір даних для скасування не показується
+		Session* session = editor->getCurrentSession();
+		std::string message = "текст був перетворений за " + std::to_string(durationInMs) + " мс";
+		if (!session->isInTransaction()) {
+			std::lock_guard<std::mutex> writerLock(session->getWriterMutex());
+			int index = session->getCurIndexInCommHistory();
+			TransformCommand* transformCommand = index >= 0 ? dynamic_cast<TransformCommand*>(session->getCommandByIndex(index)) : nullptr;
+			if (transformCommand)
+				message += " (дані для скасування: " + std::to_string(transformCommand->getSizeOfUndoData()) + " байтів)";
+		}
+		printNotification("success", message + "!");
+		return true;
+	}
+	std::string getRetentionPolicyAsText(Session::RetentionPolicy policy) {
+		if (policy.isUnlimited())
+			return "без обмежень";
+		return "записів " + (policy.maxCountOfCommands ? std::to_string(policy.maxCountOfCommands) : "-") +
+			", МБ " + (policy.maxSizeInBytes ? std::to_string(policy.maxSizeInBytes / (1024 * 1024)) : "-") +
+			", годин " + (policy.maxAgeInSeconds ? std::to_string(policy.maxAgeInSeconds / 3600) : "-");
+	}
+	void retentionMenu(int& choice) {
+		Session* session = editor->getCurrentSession();
+		HistoryCompactor::Statistics statistics = historyCompactor.getStatistics();
+		Session::HistoryStatistics historyStatistics = session->getHistoryStatistics();
+		std::cout << "\nПолітика зберігання історії сеансу (" << (session->isRetentionPolicyOwn() ? "власна" : "загальна") << "): "
+			<< getRetentionPolicyAsText(session->getRetentionPolicy()) << "\n";
+		std::cout << "Фоново стиснуто історій: " << statistics.countOfCompactions << ", злито записів: " << statistics.countOfSquashedCommands << "\n";
+		std::cout << "Історія сеансу: у пам'яті " << historyStatistics.arena.usedBytes << " байт, витіснено на диск "
+			<< historyStatistics.sizeOfSpilledHistory << " байт (бюджет усіх сеансів: " << (Session::getHistoryMemoryBudget() ?
+				std::to_string(Session::getHistoryMemoryBudget() / (1024 * 1024)) + " МБ" : "без обмеження")
+			<< ", звільнено витісненням " << statistics.countOfFreedBytes << " байт)\n";
+		std::cout << "0. Назад\n";
+		std::cout << "1. Задати власну політику сеансу\n";
+		std::cout << "2. Повернути загальну політику\n";
+		std::cout << "3. Стиснути історію зараз\n";
+		choice = enterNumberInRange("Ваш вибір: ", 0, 3);
+	}
+	void executeRetentionAction() {
+		int choice, limits[3];
+		Session* session = editor->getCurrentSession();
+		std::string descriptions[] = { "Скільки записів залишати (0 - без обмеження): ",
+			"Скільки МБ пам'яті може займати історія (0 - без обмеження): ", "Скільки годин зберігати записи (0 - без обмеження): " };
+
+		retentionMenu(choice);
+		if (choice <= 0)
+			return;
+		if (choice == 1) {
+			for (int i = 0; i < 3; i++)
+				if ((limits[i] = enterNumberInRange(descriptions[i], 0, SHRT_MAX)) == -1)
+					return;
+			session->setRetentionPolicy({ limits[0], (unsigned long long)limits[1] * 1024 * 1024, (long long)limits[2] * 3600 });
+		}
+		if (choice == 2)
+			session->resetRetentionPolicy();
+
+		//записи, які вже вийшли за межі політики, зливаються одразу, не чекаючи фонового потоку
+		Session::HistoryStatistics statisticsBefore = session->getHistoryStatistics();
+		int countOfSquashed = session->compactHistory(editor);
+		if (countOfSquashed == 0) {
+			printNotification("success", "історія вже в межах політики (записів: " + std::to_string(statisticsBefore.countOfCommands) + ")!");
+			return;
+		}
+		Session::HistoryStatistics statisticsAfter = session->getHistoryStatistics();
+		editor->getSessionsHistory()->updateSession(session, session->getSizeOfData(), statisticsAfter.countOfCommands, session->getModificationTime());
+		printNotification("success", "злито записів: " + std::to_string(countOfSquashed) + ", записів історії " + std::to_string(statisticsBefore.countOfCommands) +
+			" -> " + std::to_string(statisticsAfter.countOfCommands) + ", байтів " + std::to_string(statisticsBefore.arena.usedBytes) + " -> " +
+			std::to_string(statisticsAfter.arena.usedBytes) + "!");
+	}
+	void beginTransaction() {
+		if (editor->getCurrentSession()->beginTransaction())
+			printNotification("success", "пакет команд був розпочатий, зміни запишуться в історію та файл після підтвердження!");
+		else
+			printNotification("error", "пакет команд вже розпочатий!");
+	}
+	bool commitTransaction() {
+		if (!editor->getCurrentSession()->isInTransaction()) {
+			printNotification("error", "немає розпочатого пакета команд!");
+			return false;
+		}
+		if (!editor->getCurrentSession()->commitTransaction(editor)) {
+			printNotification("error", "не вдалося зберегти зміни пакета команд у файл!");
+			return false;
+		}
+		printNotification("success", "пакет команд був успішно підтверджений!");
+		return true;
+	}
+	void rollbackTransaction() {
+		if (editor->getCurrentSession()->rollbackTransaction())
+			printNotification("success", "пакет команд був успішно скасований!");
+		else
+			printNotification("error", "немає розпочатого пакета команд!");
+	}
+	int searchSession() {
+		//повертає позицію вибраного сеансу (з 1) або -1
+		std::string query;
+		std::cout << "\nВведіть початок або частину імені сеансу: ";
+		getline(std::cin, query);
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::string> foundNames = editor->getSessionsHistory()->searchSessions(query, COUNT_OF_SEARCH_RESULTS);
+		auto durationInUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		if (query.empty() || foundNames.empty()) {
+			printNotification("error", "схожих сеансів не знайдено!");
+			return -1;
+		}
+
+		std::cout << "\nЗнайдені сеанси (" << durationInUs << " мкс):\n";
+		std::cout << "0. Назад\n";
+		for (int i = 0; i < foundNames.size(); i++)
+			std::cout << i + 1 << ". " << foundNames[i] << "\n";
+
+		int choice = enterNumberInRange("Ваш вибір: ", 0, foundNames.size());
+		if (choice <= 0)
+			return -1;
+		int index = editor->getSessionsHistory()->getIndexOfSession(foundNames[choice - 1]);
+		return index == -1 ? -1 : index + 1;
+	}
+	std::string getAgeAsText(long long time) {
+		long long age = std::chrono::duration_cast<std::chrono::seconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count() - time;
+		if (age < 60)
+			return "щойно";
+		if (age < 60 * 60)
+			return std::to_string(age / 60) + " хв тому";
+		if (age < 24 * 60 * 60)
+			return std::to_string(age / (60 * 60)) + " год тому";
+		return std::to_string(age / (24 * 60 * 60)) + " дн тому";
+	}
+	int browseSortedSessions() {
+		//повертає позицію вибраного сеансу (з 1) або -1;
+		//перегляди підтримуються при кожній зміні сеансів, тому сторінка береться за O(log n + розмір сторінки)
+		std::cout << "\nЗа чим впорядкувати сеанси:\n";
+		std::cout << "1. За іменем\n";
+		std::cout << "2. За розміром\n";
+		std::cout << "3. За довжиною історії\n";
+		std::cout << "4. За часом зміни\n";
+		int criterion = enterNumberInRange("Ваш вибір: ", 1, SortedSessionsView::COUNT_OF_CRITERIA);
+		if (criterion == -1)
+			return -1;
+
+		std::cout << "\n1. За зростанням\n";
+		std::cout << "2. За спаданням\n";
+		int direction = enterNumberInRange("Ваш вибір: ", 1, 2);
+		if (direction == -1)
+			return -1;
+
+		int countOfPages = (editor->getSessionsHistory()->size() + SIZE_OF_SESSIONS_PAGE - 1) / SIZE_OF_SESSIONS_PAGE;
+		int page = 0, choice;
+		do
+		{
+			auto start = std::chrono::steady_clock::now();
+			std::vector<Session*> sessionsOnPage = editor->getSessionsHistory()->getSortedPage((SortedSessionsView::Criterion)(criterion - 1),
+				page * SIZE_OF_SESSIONS_PAGE, SIZE_OF_SESSIONS_PAGE, direction == 2);
+			auto durationInUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+			system("cls");
+			std::cout << "Сторінка " << page + 1 << " з " << countOfPages << " (" << durationInUs << " мкс):\n";
+			for (int i = 0; i < sessionsOnPage.size(); i++)
+				std::cout << "\n" << page * SIZE_OF_SESSIONS_PAGE + i + 1 << ") " << sessionsOnPage[i]->getName()
+				<< " | " << sessionsOnPage[i]->getSizeOfData() << " байт | команд: " << sessionsOnPage[i]->getLengthOfHistory()
+				<< " | змінений " << getAgeAsText(sessionsOnPage[i]->getModificationTime());
+			std::cout << "\n\n0. Назад\n";
+			std::cout << "1. Наступна сторінка\n";
+			std::cout << "2. Попередня сторінка\n";
+			std::cout << "3. Вибрати сеанс зі сторінки\n";
+			choice = enterNumberInRange("Ваш вибір: ", 0, 3);
+
+			if (choice == 1 && page + 1 < countOfPages)
+				page++;
+			else if (choice == 2 && page > 0)
+				page--;
+			else if (choice == 3 && !sessionsOnPage.empty()) {
+				int number = enterNumberInRange("Введіть номер сеансу зі сторінки: ", page * SIZE_OF_SESSIONS_PAGE + 1,
+					page * SIZE_OF_SESSIONS_PAGE + sessionsOnPage.size());
+				if (number == -1)
+					continue;
+				int index = editor->getSessionsHistory()->getIndexOfSession(sessionsOnPage[number - page * SIZE_OF_SESSIONS_PAGE - 1]->getName());
+				return index == -1 ? -1 : index + 1;
 			}
+		} while (choice != 0);
 
-			startIndex = editor->getCurrentText()->find(textForAction);
+		return -1;
+	}
+	void searchTextInAllSessions() {
+		std::string phrase;
+		std::cout << "\nВведіть текст для пошуку (щонайменше " << ContentIndex::MIN_LENGTH_OF_PHRASE << " символи): ";
+		getline(std::cin, phrase);
 
-			if (startIndex == std::string::npos) {
-				printNotification("error", "текст не був знайдений!");
-				return false;
-			}
+		if (phrase.size() < ContentIndex::MIN_LENGTH_OF_PHRASE) {
+			printNotification("error", "текст для пошуку закороткий!");
+			return;
+		}
 
-			if (typeOfCommand == "Paste") {
-				if (startIndex == 0 && textForAction.size() == 1)
-					endIndex = -1;
-				else if (startIndex == editor->getCurrentText()->size() - 1 && textForAction.size() == 1)
-					endIndex = editor->getCurrentText()->size();
-				else
-					endIndex = startIndex + textForAction.size() - 1;
-			}
-			else {
-				if (textForAction.size() == 1)
-					endIndex = startIndex;
-				else
-					endIndex = startIndex + textForAction.size() - 1;
-			}
+		auto start = std::chrono::steady_clock::now();
+		std::vector<ContentIndex::Match> matches = FilesManager::searchInSessions(editor->getSessionsHistory(), phrase);
+		auto durationInUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		if (matches.empty()) {
+			printNotification("error", "текст не був знайдений в жодному сеансі!");
+			return;
 		}
 
-		commandsManager->invokeCommand(typeOfCommand, startIndex, endIndex, textToPaste);
-		printNotification("success", "дані були успішно " + actionInPast + "!");
-		return true;
+		std::cout << "\nТекст знайдений у " << matches.size() << " сеансах (" << durationInUs << " мкс):\n";
+		for (ContentIndex::Match& match : matches) {
+			std::cout << match.name << ": позиції";
+			for (unsigned long long offset : match.offsets)
+				std::cout << " " << offset;
+			std::cout << (match.isComplete ? "" : " ...") << "\n";
+		}
+		std::cout << "\n";
+		system("pause");
 	}
-
-	bool undoAction() {
-		if (editor->getCurrentSession()->sizeOfCommandsHistory() > 0 && editor->getCurrentSession()->getCurIndexInCommHistory() != -1)
-		{
-			commandsManager->invokeCommand("Undo");
-			printNotification("success", "команда була успішно скасована!");
-			return true;
+	void printDiff(std::string firstText, std::string secondText, std::string description) {
+		auto start = std::chrono::steady_clock::now();
+		std::vector<TextDiff::Hunk> hunks = TextDiff::compare(firstText, secondText);
+		auto durationInUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << "\n" << description << ": ";
+		if (hunks.empty())
+			std::cout << "тексти однакові (" << durationInUs << " мкс)\n\n";
+		else {
+			std::cout << "змінених ділянок " << hunks.size() << " (" << durationInUs << " мкс), позиції в байтах:\n";
+			TextDiff::print(firstText, secondText, hunks);
+			std::cout << "\n";
 		}
-		printNotification("error", "немає дій, які можна було б скасувати!");
-		return false;
 	}
-	bool redoAction() {
-		bool isThereAnyCommandForward = commandsManager->isThereAnyCommandForward();
-		if (isThereAnyCommandForward)
-		{
-			commandsManager->invokeCommand("Redo");
-			printNotification("success", "команда була успішно повторена!");
+	std::string getTextOfHistoryState(int indexOfState) {
+		//стан 0 - текст до першої команди історії, стан N - знімок після N-ї команди;
+		//історію тим часом міг стиснути фоновий потік, тому номер обмежується її поточною довжиною
+		Session* session = editor->getCurrentSession();
+		std::lock_guard<std::mutex> writerLock(session->getWriterMutex());
+		indexOfState = std::min(indexOfState, session->sizeOfCommandsHistory());
+		return indexOfState == 0 ? "" : session->getCommandByIndex(indexOfState - 1)->getTextToProcess();
+	}
+	void compareHistoryStates() {
+		int countOfCommands = editor->getCurrentSession()->sizeOfCommandsHistory();
+		if (countOfCommands == 0) {
+			printNotification("error", "історія команд порожня!");
+			return;
+		}
+
+		std::cout << "\nСтани історії: 0 - до першої команди, N - після N-ї команди (поточний - "
+			<< editor->getCurrentSession()->getCurIndexInCommHistory() + 1 << ")";
+		int firstState = enterNumberInRange("Введіть номер першого стану: ", 0, countOfCommands);
+		if (firstState == -1)
+			return;
+		int secondState = enterNumberInRange("Введіть номер другого стану: ", 0, countOfCommands);
+		if (secondState == -1)
+			return;
 
+		try {
+			printDiff(getTextOfHistoryState(firstState), getTextOfHistoryState(secondState),
+				"Стан " + std::to_string(firstState) + " -> стан " + std::to_string(secondState));
 		}
-		else
-			printNotification("error", "немає дій, які можна було б повторити!");
-		return isThereAnyCommandForward;
+		catch (const std::ios_base::failure&) {
+			printNotification("error", "не вдалося прочитати знімок історії з диска!");
+			return;
+		}
+		system("pause");
+	}
+	void compareSessions() {
+		std::string names[2];
+		for (int i = 0; i < 2; i++) {
+			std::cout << "\nВведіть ім'я " << (i == 0 ? "першого" : "другого") << " сеансу: ";
+			getline(std::cin, names[i]);
+			if (!editor->getSessionsHistory()->getSessionByName(names[i])) {
+				printNotification("error", "сеанса з таким іменем не існує!");
+				return;
+			}
+		}
+
+		printDiff(FilesManager::readSessionDataByName(names[0]), FilesManager::readSessionDataByName(names[1]), names[0] + " -> " + names[1]);
+		system("pause");
 	}
 	void sortSessions() {
 		editor->getSessionsHistory()->sortByName();
+		FilesManager::writeSessionsOrder(editor->getSessionsHistory(), true);
 		printNotification("success", "сеанси були успішно відсортовані!");
 	}
 
@@ -949,7 +7747,24 @@ private:
 		std::cout << "4. Вирізати текст\n";
 		std::cout << "5. Скасувати команду\n";
 		std::cout << "6. Повторити команду\n";
-		choice = enterNumberInRange("Ваш вибір: ", 0, 6);
+		std::cout << "7. Почати пакет команд\n";
+		std::cout << "8. Підтвердити пакет команд\n";
+		std::cout << "9. Скасувати пакет команд\n";
+		std::cout << "10. Порівняти стани історії\n";
+		std::cout << "11. Обробити рядки\n";
+		std::cout << "12. Перетворити текст\n";
+		std::cout << "13. Політика зберігання історії\n";
+		choice = enterNumberInRange("Ваш вибір: ", 0, 13);
+	}
+	void printProfilingMenu(int& choice) {
+		std::cout << "\nМеню інструментування (зараз " << (Profiler::isProfilingEnabled() ? "увімкнене" : "вимкнене") << "):\n";
+		std::cout << "0. Назад\n";
+		std::cout << "1. Увімкнути/вимкнути збір статистики\n";
+		std::cout << "2. Експортувати статистику в JSON\n";
+		std::cout << "3. Експортувати події в Chrome trace\n";
+		std::cout << "4. Очистити статистику\n";
+		std::cout << "5. Статистика арен сеансів\n";
+		choice = enterNumberInRange("Ваш вибір: ", 0, 5);
 	}
 	void printGettingSessionsMenu(int& choice) {
 		templateForMenusAboutSessions(choice, "отримати");
@@ -965,7 +7780,10 @@ private:
 		std::cout << "2. Створити сеанс\n";
 		std::cout << "3. Відкрити сеанс\n";
 		std::cout << "4. Видалити сеанс\n";
-		choice = enterNumberInRange("Ваш вибір: ", 0, 4);
+		std::cout << "5. Інструментування команд\n";
+		std::cout << "6. Пошук тексту в усіх сеансах\n";
+		std::cout << "7. Порівняти два сеанси\n";
+		choice = enterNumberInRange("Ваш вибір: ", 0, 7);
 	}
 
 	std::string executeGettingTextForAdding() {
@@ -1019,16 +7837,155 @@ private:
 			}
 		} while (true);
 	}
+	bool isFileForStreamingMode() {
+		std::error_code errorCode;
+		std::string filepath = FilesManager::getSessionsDirectory() + editor->getCurrentSession()->getName();
+		auto sizeOfFile = std::filesystem::file_size(filepath, errorCode);
+		return !errorCode && sizeOfFile >= STREAMING_MODE_THRESHOLD;
+	}
+	void printStreamingDocument(StreamingDocument* document) {
+		system("cls");
+		std::cout << "\nПотоковий режим, файл " << editor->getCurrentSession()->getName() << " (" << document->getSize() << " байт, "
+			<< document->getCountOfPieces() << " шматків, правки займають " << document->getSizeOfOverlay() << " байт)\n";
+		if (ReplicationLog::isReplicating())
+			std::cout << "Потокові правки не реплікуються: після збереження копія сеансу зникне з резервної директорії\n";
+		std::cout << "Початок файлу:\n\"" << document->read(0, SIZE_OF_STREAMING_PREVIEW)
+			<< (document->getSize() > SIZE_OF_STREAMING_PREVIEW ? "..." : "") << "\"\n";
+	}
+	void streamingModeMenu(int& choice) {
+		std::cout << "\nМеню потокового режиму (позиції - номери байтів):\n";
+		std::cout << "0. Назад\n";
+		std::cout << "1. Знайти текст\n";
+		std::cout << "2. Вставити текст за позицією\n";
+		std::cout << "3. Видалити текст\n";
+		std::cout << "4. Копіювати текст\n";
+		std::cout << "5. Вирізати текст\n";
+		std::cout << "6. Зберегти зміни\n";
+		choice = enterNumberInRange("Ваш вибір: ", 0, 6);
+	}
+	long long findTextInStreamingDocument(StreamingDocument* document, std::string& textForAction) {
+		textForAction = getTextUsingKeyboard();
+		if (textForAction.empty()) {
+			printNotification("error", "текст не був введений!");
+			return -1;
+		}
+
+		long long position = document->find(textForAction);
+		if (position == -1)
+			printNotification("error", "текст не був знайдений!");
+		return position;
+	}
+	bool executeStreamingAction(StreamingDocument* document, int choice) {
+		std::string textForAction;
+		long long position;
+
+		switch (choice)
+		{
+		case 1:
+			position = findTextInStreamingDocument(document, textForAction);
+			if (position != -1)
+				printNotification("success", "текст знайдений на позиції " + std::to_string(position) + "!");
+			return false;
+		case 2:
+			textForAction = getTextUsingKeyboard();
+			if (textForAction.empty()) {
+				printNotification("error", "текст не був введений!");
+				return false;
+			}
+			std::cout << "\nВведіть позицію від 0 до " << document->getSize() << ": ";
+			{
+				std::string enteredPosition;
+				getline(std::cin, enteredPosition);
+				if (enteredPosition.empty() || enteredPosition.find_first_not_of("0123456789") != std::string::npos ||
+					enteredPosition.size() > 19 || std::stoull(enteredPosition) > document->getSize()) {
+					printNotification("error", "позиція виходить за межі файлу!");
+					return false;
+				}
+				document->insert(std::stoull(enteredPosition), textForAction);
+			}
+			printNotification("success", "дані були успішно вставлені!");
+			return true;
+		case 3:
+		case 4:
+		case 5:
+			position = findTextInStreamingDocument(document, textForAction);
+			if (position == -1)
+				return false;
+			if (choice == 3)
+				document->remove(position, textForAction.size());
+			else
+				editor->getCurrentSession()->addDataToClipboard(choice == 4 ? textForAction : document->cut(position, textForAction.size()));
+			printNotification("success", choice == 3 ? "дані були успішно видалені!" : choice == 4 ? "дані були успішно скопійовані!" : "дані були успішно вирізані!");
+			return choice != 4;
+		}
+		return false;
+	}
+	bool saveStreamingDocument(StreamingDocument* document) {
+		//журнал реплікації передає правки лише текстів, які репліка тримає в пам'яті, тому потоковий сеанс
+		//після збереження прибирається з резервної директорії замість того, щоб його копія тихо застаріла
+		if (!document->save())
+			return false;
+		ReplicationLog::recordDeletion(editor->getCurrentSession()->getName());
+		return true;
+	}
+	void executeStreamingModeMenu() {
+		//великі файли не завантажуються в пам'ять: оригінал лишається на диску, а правки зберігаються в таблиці шматків;
+		//в історію команд такі правки не потрапляють
+		StreamingDocument document;
+		bool isThereUnsavedData = false;
+		int choice;
+
+		if (!document.open(FilesManager::getSessionsDirectory() + editor->getCurrentSession()->getName())) {
+			printNotification("error", "не вдалося відкрити файл!");
+			return;
+		}
+
+		do
+		{
+			printStreamingDocument(&document);
+			streamingModeMenu(choice);
+
+			switch (choice)
+			{
+			case -1: continue;
+			case 0:
+				if (isThereUnsavedData && !saveStreamingDocument(&document))
+					std::cout << "\nНе вдалося зберегти зміни!\n";
+				std::cout << "\nПовернення до Меню для отримання сеансу.\n\n";
+				system("pause");
+				return;
+			case 6:
+				if (saveStreamingDocument(&document)) {
+					isThereUnsavedData = false;
+					printNotification("success", "зміни були успішно збережені!");
+				}
+				else
+					printNotification("error", "не вдалося зберегти файл!");
+				continue;
+			default:
+				if (executeStreamingAction(&document, choice))
+					isThereUnsavedData = true;
+			}
+		} while (true);
+	}
 	void executeMakeActionsOnContentMenu() {
+		if (isFileForStreamingMode()) {
+			executeStreamingModeMenu();
+			return;
+		}
+
+		if (!readDataFromFile())
+			return;
+
 		commandsManager = new CommandsManager(editor);
-		bool wasTextSuccessfullyChanged;
+		bool wasTextSuccessfullyChanged, isThereUnsavedData = false;
 		int choice;
 
-		readDataFromFile();
-
 		do
 		{
 			wasTextSuccessfullyChanged = false;
+			applyExternalChanges(editor->getCurrentSession());
+			std::shared_ptr<const std::string> textBeforeAction = editor->getCurrentTextSnapshot();
 			editor->printCurrentText();
 			makeActionsOnContentMenu(choice);
 
@@ -1036,6 +7993,11 @@ private:
 			{
 			case 0:
 				std::cout << "\nПовернення до Меню для отримання сеансу.\n\n";
+				if (editor->getCurrentSession()->rollbackTransaction())
+					std::cout << "Незавершений пакет команд був скасований.\n\n";
+				if (isThereUnsavedData)
+					FilesManager::writeSessionData(editor->getCurrentSession()->getName(), *(editor->getCurrentTextSnapshot()));
+				textOfOpenedSessionInFile = nullptr;
 				system("pause");
 				delete (commandsManager);
 				return;
@@ -1056,9 +8018,112 @@ private:
 				break;
 			case 6:
 				wasTextSuccessfullyChanged = redoAction();
+				break;
+			case 7:
+				beginTransaction();
+				break;
+			case 8:
+				//підтверджений пакет переписує файл усім текстом, разом з незбереженими правками до нього
+				if (commitTransaction()) {
+					isThereUnsavedData = false;
+					textOfOpenedSessionInFile = nullptr;
+				}
+				break;
+			case 9:
+				rollbackTransaction();
+				break;
+			case 10:
+				compareHistoryStates();
+				break;
+			case 11:
+				wasTextSuccessfullyChanged = executeLinesAction();
+				break;
+			case 12:
+				wasTextSuccessfullyChanged = executeTransform();
+				break;
+			case 13:
+				executeRetentionAction();
+			}
+			//об'єднані з попередньою команди не переписують файл щоразу, дані збережуться наступною командою або при виході
+			if (editor->getCurrentSession()->isInTransaction())
+				continue;
+			if (wasTextSuccessfullyChanged && commandsManager->isLastCommandCoalesced()) {
+				if (!isThereUnsavedData)
+					textOfOpenedSessionInFile = textBeforeAction;
+				isThereUnsavedData = true;
+			}
+			else if (wasTextSuccessfullyChanged) {
+				FilesManager::writeSessionData(editor->getCurrentSession()->getName(), *(editor->getCurrentTextSnapshot()));
+				isThereUnsavedData = false;
+				textOfOpenedSessionInFile = nullptr;
+			}
+		} while (true);
+	}
+	void printArenasStatistics() {
+		FilesManager::LoadingStatistics loadingStatistics = FilesManager::getLastLoadingStatistics();
+		system("cls");
+		std::cout << "\nСеанси завантажені за " << loadingStatistics.durationInMs << " мс ("
+			<< loadingStatistics.countOfSessions << " сеансів, потоків: " << loadingStatistics.countOfThreads << ")\n";
+		if (FilesManager::isPackedStorageUsed())
+			std::cout << "Сховище Sessions.pack: " << FilesManager::getPackedStore()->getSizeOfFile() << " байт, з них застарілих записів "
+			<< FilesManager::getPackedStore()->getSizeOfGarbage() << " байт\n";
+		SessionBuffersCache::Statistics cacheStatistics = buffersCache.getStatistics();
+		std::cout << "Кеш текстів сеансів: влучань " << cacheStatistics.countOfHits << ", промахів " << cacheStatistics.countOfMisses
+			<< ", витіснено " << cacheStatistics.countOfEvictions << ", текстів " << cacheStatistics.countOfBuffers << " ("
+			<< cacheStatistics.sizeOfBuffers << " з " << cacheStatistics.budgetInBytes << " байт)\n";
+		if (ReplicationLog::isReplicating())
+			std::cout << "Журнал реплікації в " << ReplicationLog::getStandbyDirectory() << ": записів " << ReplicationLog::getCountOfRecords()
+			<< ", відправлено " << ReplicationLog::getCountOfShippedBytes() << " байт\n";
+		std::cout << "\nСтатистика арен сеансів (байти):\n";
+		for (int i = 0; i < editor->getSessionsHistory()->size(); i++) {
+			Session* session = editor->getSessionsHistory()->getSessionByIndex(i);
+			Session::HistoryStatistics historyStatistics = session->getHistoryStatistics();
+			SessionArena::Statistics statistics = historyStatistics.arena;
+			std::cout << "\n" << session->getName() << ": команд " << historyStatistics.countOfCommands
+				<< ", виділень " << statistics.countOfAllocations << ", зайнято " << statistics.usedBytes
+				<< ", пік " << statistics.peakUsedBytes << ", зарезервовано " << statistics.reservedBytes
+				<< " у " << statistics.countOfBlocks << " блоках, витіснено на диск " << historyStatistics.sizeOfSpilledHistory;
+		}
+		std::cout << "\n\n";
+		system("pause");
+	}
+	void executeProfilingMenu() {
+		int choice;
+
+		do
+		{
+			Profiler::printSummary();
+			printProfilingMenu(choice);
+
+			switch (choice)
+			{
+			case 0:
+				std::cout << "\nПовернення до Головного меню.\n\n";
+				system("pause");
+				return;
+			case 1:
+				Profiler::setEnabled(!Profiler::isProfilingEnabled());
+				printNotification("success", Profiler::isProfilingEnabled() ? "збір статистики увімкнений!" : "збір статистики вимкнений!");
+				break;
+			case 2:
+				if (Profiler::exportToJson(PROFILE_FILEPATH))
+					printNotification("success", "статистика збережена у файл " + PROFILE_FILEPATH + "!");
+				else
+					printNotification("error", "не вдалося відкрити файл " + PROFILE_FILEPATH + "!");
+				break;
+			case 3:
+				if (Profiler::exportToChromeTrace(TRACE_FILEPATH))
+					printNotification("success", "події збережені у файл " + TRACE_FILEPATH + "!");
+				else
+					printNotification("error", "не вдалося відкрити файл " + TRACE_FILEPATH + "!");
+				break;
+			case 4:
+				Profiler::reset();
+				printNotification("success", "статистика очищена!");
+				break;
+			case 5:
+				printArenasStatistics();
 			}
-			if (wasTextSuccessfullyChanged)
-				FilesManager::writeSessionData(editor->getCurrentSession()->getName(), *(editor->getCurrentText()));
 		} while (true);
 	}
 	void executeDeletingSessionsMenu() {
@@ -1157,12 +8222,8 @@ private:
 				return;
 			}
 
-			if (!std::filesystem::exists(FilesManager::getSessionsDirectory()))
-				std::filesystem::create_directories(FilesManager::getSessionsDirectory());
-
-			std::string filepath = FilesManager::getSessionsDirectory() + newSession->getName();
-			std::ofstream file(filepath);
-			file.close();
+			FilesManager::createSessionFiles(newSession);
+			ReplicationLog::recordCreation(newSession->getName());
 			editor->getSessionsHistory()->addSessionToEnd(newSession);
 			printNotification("success", "сеанс був успішно створений!");
 		}
@@ -1189,9 +8250,10 @@ private:
 	}
 	void deleteSessionByIndex(int index = -1) {
 		if (tryToEnterIndexForSession(index)) {
+			buffersCache.invalidate(editor->getSessionsHistory()->getSessionByIndex(index - 1));
 			std::string nameOfSession = editor->getSessionsHistory()->deleteSessionByIndex(index - 1);
-			std::string pathToSession = FilesManager::getSessionsDirectory() + nameOfSession;
-			remove(pathToSession.c_str());
+			FilesManager::deleteSessionFiles(nameOfSession);
+			ReplicationLog::recordDeletion(nameOfSession);
 
 			printNotification("success", "сеанс був успішно видалений!");
 		}
@@ -1200,24 +8262,388 @@ private:
 		std::string name;
 		std::cout << "\nВведіть ім'я сеансу: ";
 		getline(std::cin, name);
+		buffersCache.invalidate(editor->getSessionsHistory()->getSessionByName(name));
 		auto filename = editor->getSessionsHistory()->deleteSessionByName(name);
 		if (filename.empty())
 		{
 			printNotification("error", "сеанса з таким іменем не існує!");
 			return false;
 		}
-		std::string pathToSession = FilesManager::getSessionsDirectory() + filename;
-		remove(pathToSession.c_str());
+		FilesManager::deleteSessionFiles(filename);
+		ReplicationLog::recordDeletion(filename);
 
 		printNotification("success", "сеанс був успішно видалений!");
 		return true;
 	}
+	void printUsage() {
+		std::cout << "Використання:\n";
+		std::cout << "  Program.exe - інтерактивний режим\n";
+		std::cout << "  Program.exe --server [шлях до сокета] - сервер редагування для локальних клієнтів\n";
+		std::cout << "  Program.exe --load-client <шлях до сокета> <клієнтів> <запитів на клієнта> - генератор навантаження\n";
+		std::cout << "  Program.exe --packed [режим] - усі сеанси зберігаються в одному файлі Sessions.pack\n";
+		std::cout << "  Program.exe --utf8 [режим] - текст сеансів у UTF-8, позиції рахуються в символах\n";
+		std::cout << "  Program.exe --retention <записів> <МБ> <годин> [режим] - межі історії сеансів (0 - без обмеження), старіше зливається у знімок\n";
+		std::cout << "  Program.exe --history-budget <МБ> [режим] - скільки пам'яті можуть займати історії всіх сеансів, старіші записи витісняються на диск\n";
+		std::cout << "  Program.exe --replicate <резервна директорія> [режим] - відправляти зміни сеансів у журнал резервної директорії\n";
+		std::cout << "  Program.exe --replica <резервна директорія> - застосовувати журнал до копій сеансів у резервній директорії\n";
+		std::cout << "  Program.exe --record <файл запису> [режим] - записувати всі команди редагування у файл\n";
+		std::cout << "  Program.exe --replay <файл запису> - відтворити запис на всіх рушіях та порівняти результати\n";
+		std::cout << "  Program.exe --replay <директорія> - те саме для кожного запису директорії (регресійні записи - Replays)\n";
+		std::cout << "  Program.exe --diff <сеанс 1> <сеанс 2> - показати відмінності між текстами двох сеансів\n";
+		std::cout << "  Program.exe --fuzz <кількість запитів> [seed] - те саме для випадкового потоку (зберігається в fuzz.replay)\n";
+		std::cout << "  Program.exe --bench-workload <сеансів> <правок> [seed] - тест навантаження з записом на диск (зберігається в workload.replay)\n";
+		std::cout << "  Program.exe --bench-workload <файл запису> - той самий тест для записаного потоку\n";
+	}
+	int executeDiffMode(std::string firstName, std::string secondName) {
+		editor = new Editor();
+		editor->tryToLoadSessions();
+
+		bool doSessionsExist = editor->getSessionsHistory()->getSessionByName(firstName) && editor->getSessionsHistory()->getSessionByName(secondName);
+		if (doSessionsExist)
+			printDiff(FilesManager::readSessionDataByName(firstName), FilesManager::readSessionDataByName(secondName), firstName + " -> " + secondName);
+		else
+			std::cout << "Помилка: сеанса з таким іменем не існує!\n";
+
+		editor->tryToUnloadSessions();
+		delete editor;
+		return doSessionsExist ? 0 : 1;
+	}
+	int executeReplayMode(std::string filepath) {
+		//директорія - набір записів (регресійні записи лежать у Replays), кожен з яких відтворюється окремо
+		if (std::filesystem::is_directory(filepath)) {
+			std::vector<std::string> filepaths;
+			for (const auto& entry : std::filesystem::directory_iterator(filepath))
+				if (entry.path().extension() == ".replay")
+					filepaths.push_back(entry.path().string());
+			std::sort(filepaths.begin(), filepaths.end());
+
+			int countOfFailed = 0;
+			for (std::string& filepathOfRecording : filepaths) {
+				std::cout << "\n" << filepathOfRecording << ":\n";
+				countOfFailed += executeReplayMode(filepathOfRecording);
+			}
+			std::cout << "\nЗаписів: " << filepaths.size() << ", з розбіжностями: " << countOfFailed << "\n";
+			return filepaths.empty() || countOfFailed > 0 ? 1 : 0;
+		}
+
+		std::vector<CommandsRecorder::Request> requests;
+		if (!ReplayHarness::readRecording(filepath, requests)) {
+			std::cout << "Помилка: файл запису " << filepath << " не вдалося прочитати!\n";
+			return 1;
+		}
+		return ReplayHarness::compareEngines(requests) ? 0 : 1;
+	}
+	int executeFuzzMode(int countOfRequests, unsigned int seed) {
+		std::cout << "Випадковий потік з " << countOfRequests << " запитів, seed " << seed << "\n";
+		std::vector<CommandsRecorder::Request> requests = ReplayHarness::generateRequests(countOfRequests, seed, Editor::isUtf8Mode());
+		ReplayHarness::writeRecording(FUZZ_RECORDING_FILEPATH, requests);
+		return ReplayHarness::compareEngines(requests) ? 0 : 1;
+	}
+	bool startReplication() {
+		if (ReplicationLog::getStandbyDirectory().empty())
+			return true;
+		return ReplicationLog::start(editor->getSessionsHistory(), STREAMING_MODE_THRESHOLD);
+	}
+	int executeReplicaMode(std::string standbyDirectory) {
+		std::error_code errorCode;
+		std::filesystem::create_directories(standbyDirectory, errorCode);
+		std::filesystem::current_path(standbyDirectory, errorCode);
+		if (errorCode) {
+			std::cout << "Помилка: не вдалося відкрити резервну директорію " << standbyDirectory << "!\n";
+			return 1;
+		}
+
+		editor = new Editor();
+		editor->tryToLoadSessions();
+		ReplicaApplier applier;
+		applier.start(editor);
+		std::cout << "Репліка застосовує журнал " << standbyDirectory << "\\" << ReplicationLog::LOG_FILENAME << " (зупинити - Enter)\n";
+		std::cin.get();
+		applier.stop();
+
+		ReplicaApplier::Statistics statistics = applier.getStatistics();
+		std::cout << "Застосовано записів: " << statistics.countOfAppliedRecords << ", відхилено: " << statistics.countOfRejectedRecords
+			<< ", позиція в журналі: " << statistics.appliedOffset << " байт\n";
+		editor->tryToUnloadSessions();
+		delete editor;
+		return 0;
+	}
+	bool executeWorkloadRequest(const CommandsRecorder::Request& request, bool& isThereUnsavedData) {
+		//той самий шлях, що й у меню: відкриття сеансу через кеш текстів, команда з записом в історію,
+		//переписування файлу після кожної зміни, яка не об'єдналася з попередньою
+		if (request.type == "MODE") {
+			Editor::setUtf8Enabled(request.payload == "UTF8");
+			return true;
+		}
+
+		Session* session = editor->getCurrentSession();
+		if (request.type == "OPEN") {
+			if (session) {
+				session->rollbackTransaction();
+				if (isThereUnsavedData)
+					FilesManager::writeSessionData(session->getName(), *(editor->getCurrentTextSnapshot()));
+				isThereUnsavedData = false;
+			}
+
+			session = editor->getSessionsHistory()->getSessionByName(request.payload);
+			if (!session) {
+				session = new Session();
+				if (!session->setName(request.payload)) {
+					delete session;
+					return false;
+				}
+				FilesManager::createSessionFiles(session);
+				ReplicationLog::recordCreation(session->getName());
+				editor->getSessionsHistory()->addSessionToEnd(session);
+			}
+			editor->setCurrentSession(session);
+			return readDataFromFile();
+		}
+		if (!session || !editor->getCurrentText())
+			return false;
+
+		if (request.type == "LOAD") {
+			*(editor->getCurrentText()) = request.payload;
+			if (Editor::isUtf8Mode())
+				session->getUtf8Index()->rebuild(request.payload);
+			session->publishText(request.payload);
+			return FilesManager::writeSessionData(session->getName(), request.payload);
+		}
+
+		std::string result;
+		if (!CommandsManagerEngine::executeOnCurrentSession(editor, commandsManager, request, result))
+			return false;
+		if (session->isInTransaction() || request.type == "COPY" || request.type == "ROLLBACK")
+			return true;
+
+		if (commandsManager->isLastCommandCoalesced())
+			isThereUnsavedData = true;
+		else {
+			FilesManager::writeSessionData(session->getName(), *(editor->getCurrentTextSnapshot()));
+			isThereUnsavedData = false;
+		}
+		return true;
+	}
+	int executeWorkloadMode(const std::vector<CommandsRecorder::Request>& requests) {
+		//тест навантаження всього шляху запиту на чистих Data та Metadata з тими ж фоновими потоками, що й у меню;
+		//завершення (запис метаданих усіх сеансів) вимірюється окремо, а записані байти беруться з лічильників процесу;
+		//пік пам'яті процесу включав би модель генератора, тому робочий набір скидається перед відтворенням
+		//і далі вибирається кожні WORKLOAD_MEMORY_SAMPLING_INTERVAL запитів;
+		//відхилені запити (скасування на початку історії тощо) лише рахуються, бо так само відхиляються й моделлю генератора
+		std::error_code errorCode;
+		std::filesystem::remove_all(WORKLOAD_DIRECTORY, errorCode);
+		std::filesystem::create_directories(WORKLOAD_DIRECTORY, errorCode);
+		std::filesystem::path previousDirectory = std::filesystem::current_path();
+		std::filesystem::current_path(WORKLOAD_DIRECTORY, errorCode);
+		if (errorCode) {
+			std::cout << "Помилка: не вдалося створити директорію " << WORKLOAD_DIRECTORY << "!\n";
+			return 1;
+		}
+
+		IO_COUNTERS ioCountersAtStart = {}, ioCounters = {};
+		GetProcessIoCounters(GetCurrentProcess(), &ioCountersAtStart);
+		editor = new Editor();
+		editor->tryToLoadSessions();
+		//позиції потоку розраховані без об'єднання команд, яке залежить від часу між ними, тому тут воно вимкнене
+		commandsManager = new CommandsManager(editor);
+		commandsManager->setCoalescingEnabled(false);
+		historyCompactor.start(editor);
+		if (!FilesManager::isPackedStorageUsed())
+			dataWatcher.start(FilesManager::getSessionsDirectory());
+
+		PROCESS_MEMORY_COUNTERS memoryCounters = {};
+		SetProcessWorkingSetSize(GetCurrentProcess(), (SIZE_T)-1, (SIZE_T)-1);
+		GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters));
+		size_t workingSetAtStart = memoryCounters.WorkingSetSize, peakOfWorkingSet = workingSetAtStart;
+		auto sampleWorkingSet = [&]() {
+			GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters));
+			peakOfWorkingSet = std::max(peakOfWorkingSet, (size_t)memoryCounters.WorkingSetSize);
+		};
+
+		std::vector<long long> latenciesNs;
+		latenciesNs.reserve(requests.size());
+		int countOfRejected = 0, countOfOpens = 0;
+		bool isThereUnsavedData = false;
+		auto start = std::chrono::steady_clock::now();
+		for (const CommandsRecorder::Request& request : requests) {
+			auto startOfRequest = std::chrono::steady_clock::now();
+			if (!executeWorkloadRequest(request, isThereUnsavedData))
+				countOfRejected++;
+			latenciesNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startOfRequest).count());
+			countOfOpens += request.type == "OPEN";
+			if (latenciesNs.size() % WORKLOAD_MEMORY_SAMPLING_INTERVAL == 0)
+				sampleWorkingSet();
+		}
+		if (isThereUnsavedData)
+			FilesManager::writeSessionData(editor->getCurrentSession()->getName(), *(editor->getCurrentTextSnapshot()));
+		double durationInSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		sampleWorkingSet();
+
+		auto startOfShutdown = std::chrono::steady_clock::now();
+		historyCompactor.stop();
+		dataWatcher.stop();
+		int countOfSessions = editor->getSessionsHistory()->size();
+		editor->tryToUnloadSessions();
+		sampleWorkingSet();
+		editor->setCurrentText(nullptr);
+		buffersCache.clear();
+		delete commandsManager;
+		delete editor;
+		auto durationOfShutdownInMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startOfShutdown).count();
+
+		GetProcessIoCounters(GetCurrentProcess(), &ioCounters);
+		unsigned long long sizeOnDisk = 0;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(".", errorCode))
+			if (entry.is_regular_file(errorCode))
+				sizeOnDisk += entry.file_size(errorCode);
+		std::filesystem::current_path(previousDirectory, errorCode);
+
+		std::sort(latenciesNs.begin(), latenciesNs.end());
+		auto getPercentile = [&](double percentile) {
+			return latenciesNs.empty() ? 0 : latenciesNs[std::min(latenciesNs.size() - 1, (size_t)(latenciesNs.size() * percentile / 100.0))] / 1000.0;
+		};
+		std::cout << "\nЗапитів: " << requests.size() << " (відкриттів сеансів " << countOfOpens << ", відхилено " << countOfRejected
+			<< "), сеансів: " << countOfSessions;
+		std::cout << "\nПропускна здатність: " << (long long)(requests.size() / std::max(durationInSeconds, 1e-9)) << " запитів/с";
+		std::cout << "\nЗатримка запиту (мкс): p50 " << getPercentile(50) << ", p99 " << getPercentile(99) << ", p99.9 " << getPercentile(99.9)
+			<< ", макс. " << (latenciesNs.empty() ? 0 : latenciesNs.back() / 1000.0);
+		std::cout << "\nЗавершення (запис метаданих): " << durationOfShutdownInMs << " мс";
+		std::cout << "\nЗаписано на диск: " << ioCounters.WriteTransferCount - ioCountersAtStart.WriteTransferCount
+			<< " байт, займають файли " << WORKLOAD_DIRECTORY << ": " << sizeOnDisk << " байт";
+		std::cout << "\nПік робочого набору під час відтворення: " << peakOfWorkingSet / (1024 * 1024) << " МБ (на початку "
+			<< workingSetAtStart / (1024 * 1024) << " МБ, вибірка кожні " << WORKLOAD_MEMORY_SAMPLING_INTERVAL << " запитів)";
+		std::cout << "\nФонові потоки: стискання історії" << (FilesManager::isPackedStorageUsed() ? "" : ", стеження за директорією Data") << "\n";
+		return 0;
+	}
+	int executeServerMode(std::string socketPath) {
+		editor = new Editor();
+		editor->tryToLoadSessions();
+		if (!startReplication())
+			std::cout << "Помилка: не вдалося почати журнал реплікації в " << ReplicationLog::getStandbyDirectory() << "!\n";
+
+		std::cout << "Сервер редагування слухає " << socketPath << " (зупинити - запит SHUTDOWN)\n";
+		EditingServer* server = new EditingServer(editor);
+		historyCompactor.start(editor);
+		bool wasServerStarted = server->run(socketPath);
+		historyCompactor.stop();
+		delete server;
+		ReplicationLog::stop();
+
+		if (!wasServerStarted)
+			std::cout << "\nПомилка: не вдалося відкрити сокет " << socketPath << "!\n";
+		Profiler::printSummary();
+
+		editor->setCurrentText(nullptr);
+		editor->tryToUnloadSessions();
+		delete editor;
+		return wasServerStarted ? 0 : 1;
+	}
+
 public:
+	int executeCommandLineMode(int argc, char* argv[]) {
+		std::string mode = argv[1];
+
+		if (mode == "--packed") {
+			FilesManager::setPackedStorageEnabled(true);
+			if (argc == 2) {
+				executeMainMenu();
+				return 0;
+			}
+			return executeCommandLineMode(argc - 1, argv + 1);
+		}
+		if (mode == "--utf8") {
+			Editor::setUtf8Enabled(true);
+			SetConsoleCP(CP_UTF8);
+			SetConsoleOutputCP(CP_UTF8);
+			if (argc == 2) {
+				executeMainMenu();
+				return 0;
+			}
+			return executeCommandLineMode(argc - 1, argv + 1);
+		}
+
+		if (mode == "--retention" && argc > 4 && validateEnteredNumber(argv[2], 0, SHRT_MAX) &&
+			validateEnteredNumber(argv[3], 0, SHRT_MAX) && validateEnteredNumber(argv[4], 0, SHRT_MAX)) {
+			Session::setDefaultRetentionPolicy({ std::stoi(argv[2]), std::stoull(argv[3]) * 1024 * 1024, std::stoll(argv[4]) * 3600 });
+			if (argc == 5) {
+				executeMainMenu();
+				return 0;
+			}
+			return executeCommandLineMode(argc - 4, argv + 4);
+		}
+		if (mode == "--history-budget" && argc > 2 && validateEnteredNumber(argv[2], 0, SHRT_MAX)) {
+			Session::setHistoryMemoryBudget(std::stoull(argv[2]) * 1024 * 1024);
+			if (argc == 3) {
+				executeMainMenu();
+				return 0;
+			}
+			return executeCommandLineMode(argc - 2, argv + 2);
+		}
+		if (mode == "--replicate" && argc > 2) {
+			ReplicationLog::setStandbyDirectory(argv[2]);
+			if (argc == 3) {
+				executeMainMenu();
+				return 0;
+			}
+			return executeCommandLineMode(argc - 2, argv + 2);
+		}
+		if (mode == "--replica" && argc == 3)
+			return executeReplicaMode(argv[2]);
+		if (mode == "--record" && argc > 2) {
+			if (!CommandsRecorder::start(argv[2])) {
+				std::cout << "Помилка: не вдалося створити файл запису " << argv[2] << "!\n";
+				return 1;
+			}
+			if (argc == 3) {
+				executeMainMenu();
+				return 0;
+			}
+			return executeCommandLineMode(argc - 2, argv + 2);
+		}
+		if (mode == "--diff" && argc == 4)
+			return executeDiffMode(argv[2], argv[3]);
+		if (mode == "--replay" && argc == 3)
+			return executeReplayMode(argv[2]);
+		if (mode == "--fuzz" && (argc == 3 || argc == 4) && validateEnteredNumber(argv[2], 1, SHRT_MAX) &&
+			(argc == 3 || validateEnteredNumber(argv[3], 0, SHRT_MAX)))
+			return executeFuzzMode(std::stoi(argv[2]), argc == 4 ? std::stoi(argv[3]) : (unsigned int)time(nullptr));
+
+		if (mode == "--bench-workload" && argc == 3) {
+			std::vector<CommandsRecorder::Request> requests;
+			if (!ReplayHarness::readRecording(argv[2], requests)) {
+				std::cout << "Помилка: файл запису " << argv[2] << " не вдалося прочитати!\n";
+				return 1;
+			}
+			return executeWorkloadMode(requests);
+		}
+		if (mode == "--bench-workload" && (argc == 4 || argc == 5) && validateEnteredNumber(argv[2], 1, INT_MAX) &&
+			validateEnteredNumber(argv[3], 1, INT_MAX) && (argc == 4 || validateEnteredNumber(argv[4], 0, SHRT_MAX))) {
+			unsigned int seed = argc == 5 ? std::stoi(argv[4]) : (unsigned int)time(nullptr);
+			std::cout << "Навантаження: " << argv[2] << " сеансів, " << argv[3] << " правок, seed " << seed << "\n";
+			std::vector<CommandsRecorder::Request> requests = ReplayHarness::generateWorkload(std::stoi(argv[2]), std::stoi(argv[3]), seed, Editor::isUtf8Mode());
+			ReplayHarness::writeRecording(WORKLOAD_RECORDING_FILEPATH, requests);
+			return executeWorkloadMode(requests);
+		}
+
+		if (mode == "--server")
+			return executeServerMode(argc > 2 ? argv[2] : DEFAULT_SOCKET_PATH);
+		if (mode == "--load-client" && argc == 5 &&
+			validateEnteredNumber(argv[3], 1, SHRT_MAX) && validateEnteredNumber(argv[4], 1, SHRT_MAX))
+			return LoadGenerator::run(argv[2], std::stoi(argv[3]), std::stoi(argv[4])) ? 0 : 1;
+
+		printUsage();
+		return 1;
+	}
 
 	void executeMainMenu() {
 		int choice;
 		editor = new Editor();
 		editor->tryToLoadSessions();
+		historyCompactor.start(editor);
+		if (!FilesManager::isPackedStorageUsed())
+			dataWatcher.start(FilesManager::getSessionsDirectory());
+		if (!startReplication())
+			printNotification("error", "не вдалося почати журнал реплікації в " + ReplicationLog::getStandbyDirectory() + "!");
 
 		do
 		{
@@ -1226,7 +8652,13 @@ public:
 			{
 			case 0:
 				std::cout << "\nДо побачення!\n";
-				editor->tryToUnloadSessions();
+				historyCompactor.stop();
+				dataWatcher.stop();
+				ReplicationLog::stop();
+				if (!editor->tryToUnloadSessions())
+					printNotification("error", "не вдалося прочитати витіснені знімки історії, історію деяких сеансів не збережено!");
+				editor->setCurrentText(nullptr);
+				buffersCache.clear();
 				delete editor;
 				return;
 			case 1:
@@ -1240,17 +8672,42 @@ public:
 				if (doesAnySessionExist())
 					choice == 3 ? executeGettingSessionsMenu() :
 					executeDeletingSessionsMenu();
+				continue;
+			case 5:
+				executeProfilingMenu();
+				continue;
+			case 6:
+				if (doesAnySessionExist())
+					searchTextInAllSessions();
+				continue;
+			case 7:
+				if (doesAnySessionExist())
+					compareSessions();
 			}
 
 		} while (true);
 	}
 };
 
-int main()
+const std::string Program::PROFILE_FILEPATH = "profile.json",
+Program::TRACE_FILEPATH = "trace.json";
+const int Program::COUNT_OF_SEARCH_RESULTS = 10;
+const int Program::SIZE_OF_SESSIONS_PAGE = 20;
+const unsigned long long Program::STREAMING_MODE_THRESHOLD = 256ULL * 1024 * 1024;
+const size_t Program::SIZE_OF_STREAMING_PREVIEW = 1024;
+const std::string Program::DEFAULT_SOCKET_PATH = "editor.sock";
+const std::string Program::FUZZ_RECORDING_FILEPATH = "fuzz.replay";
+const std::string Program::WORKLOAD_RECORDING_FILEPATH = "workload.replay";
+const std::string Program::WORKLOAD_DIRECTORY = "Workload";
+const int Program::WORKLOAD_MEMORY_SAMPLING_INTERVAL = 1024;
+
+int main(int argc, char* argv[])
 {
 	SetConsoleCP(1251);
 	SetConsoleOutputCP(1251);
 
 	Program program;
+	if (argc > 1)
+		return program.executeCommandLineMode(argc, argv);
 	program.executeMainMenu();
 }
\ No newline at end of file